@@ -0,0 +1,295 @@
+#include "batch.h"
+
+#include "list_dir.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#ifdef _IMC_NIX
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+//stats are metadata latency bound, more of them in flight than cores still helps
+constexpr size_t min_preflight_threads = 4;
+constexpr size_t max_preflight_threads = 16;
+
+//what lstat says about a path
+struct status_t
+{
+    std::error_code ec;
+    bool            is_directory{false};
+    bool            is_regular_file{false};
+    uint64_t        size{0U};
+};
+
+status_t status_of(const fs::path& path)
+{
+    status_t status;
+#ifdef _IMC_NIX
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+        status.ec = std::error_code(errno, std::generic_category());
+        return status;
+    }
+    status.is_directory = S_ISDIR(st.st_mode);
+    status.is_regular_file = S_ISREG(st.st_mode);
+    if (status.is_regular_file)
+        status.size = static_cast<uint64_t>(st.st_size);
+#else
+    const auto st = fs::symlink_status(path, status.ec);
+    if (!status.ec && !fs::exists(st))
+        status.ec = std::make_error_code(std::errc::no_such_file_or_directory);
+    if (status.ec)
+        return status;
+    status.is_directory = fs::is_directory(st);
+    status.is_regular_file = fs::is_regular_file(st);
+    if (std::error_code size_ec; status.is_regular_file) {
+        const auto size = fs::file_size(path, size_ec);
+        status.size = size_ec ? 0U : size;
+    }
+#endif
+    return status;
+}
+
+//Every item is a task, every directory under one too. Counters only ever
+//grow, so threads add to them without a lock, the lists take the mutex.
+struct tree_preflight_t
+{
+    const std::vector<batch_item_t>&                items;
+    std::stop_token                                 stop;
+    work_stealing_pool_t                            pool;
+    std::vector<std::atomic<uint64_t>>              sizes;
+    //only the item's own task writes its slot
+    std::vector<uint64_t>                           own_sizes;
+    std::atomic<size_t>                             files{0U};
+    std::atomic<size_t>                             directories{0U};
+    std::atomic<size_t>                             inner_conflicts{0U};
+    std::atomic<size_t>                             unreadable{0U};
+
+    std::mutex                                      mutex;
+    std::vector<size_t>                             conflicts;
+    std::vector<std::pair<size_t, std::error_code>> errors;
+    std::set<std::pair<uint64_t, uint64_t>>         visited;
+
+    tree_preflight_t(const std::vector<batch_item_t>& items_, std::stop_token stop_, size_t threads)
+    : items(items_), stop(std::move(stop_)), pool(threads), sizes(items_.size()), own_sizes(items_.size(), 0U)
+    {
+    }
+
+    //false if the directory was already walked (bind mounts)
+    bool enter(const fs::path& dir)
+    {
+#ifdef _IMC_NIX
+        struct stat st;
+        if (lstat(dir.c_str(), &st) != 0)
+            return true;
+        std::lock_guard lock(mutex);
+        return visited.emplace(st.st_dev, st.st_ino).second;
+#else
+        (void)dir;
+        return true;
+#endif
+    }
+
+    void check_item(size_t worker, size_t index)
+    {
+        if (stop.stop_requested())
+            return;
+        const auto& item = items[index];
+        const auto status = status_of(item.src);
+        if (status.ec) {
+            std::lock_guard lock(mutex);
+            errors.emplace_back(index, status.ec);
+            return;
+        }
+        if (status.is_directory) {
+            directories++;
+        } else {
+            files++;
+            own_sizes[index] = status.size;
+            sizes[index] += status.size;
+        }
+        bool merges = false;
+        if (!item.dst.empty()) {
+            if (const auto there = status_of(item.dst); !there.ec) {
+                merges = status.is_directory && there.is_directory;
+                std::lock_guard lock(mutex);
+                conflicts.push_back(index);
+            }
+        }
+        if (status.is_directory)
+            walk(worker, index, item.src, merges ? item.dst : fs::path());
+    }
+
+    //dst is where src's counterpart already is, empty if there is none
+    void walk(size_t worker, size_t index, const fs::path& src, const fs::path& dst)
+    {
+        if (stop.stop_requested() || !enter(src))
+            return;
+        std::vector<std::string> subdirs;
+        //only kept to look them up in dst
+        std::vector<std::string> names;
+        uint64_t bytes = 0;
+        size_t file_count = 0;
+        auto ec = list_dir(src, [&](const table_row_data_t& row) {
+            //a symlink is recreated, what it points to isn't copied or deleted
+            if (row.is_directory && !row.is_symlink) {
+                subdirs.push_back(row.name + row.ext);
+                return;
+            }
+            file_count++;
+            if (row.is_regular_file && !row.is_symlink)
+                bytes += row.size;
+            if (!dst.empty())
+                names.push_back(row.name + row.ext);
+        }, stop);
+        if (ec && ec != std::errc::operation_canceled)
+            unreadable++;
+        files += file_count;
+        directories += subdirs.size();
+        sizes[index] += bytes;
+
+        //name -> whether it is a directory there, copying into one merges
+        std::unordered_map<std::string, bool> there;
+        if (!dst.empty()) {
+            ec = list_dir(dst, [&there](const table_row_data_t& row) {
+                there.emplace(row.name + row.ext, row.is_directory && !row.is_symlink);
+            }, stop);
+            if (ec && ec != std::errc::operation_canceled)
+                unreadable++;
+        }
+        size_t found = 0;
+        for(const auto& name : names)
+            found += there.contains(name) ? 1U : 0U;
+        for(auto& name : subdirs) {
+            fs::path into;
+            if (const auto it = there.find(name); it != there.end()) {
+                if (it->second)
+                    into = dst / name;
+                else
+                    found++;
+            }
+            pool.push(worker, [this, index, from = src / name, into = std::move(into)](size_t w) {
+                walk(w, index, from, into);
+            });
+        }
+        inner_conflicts += found;
+    }
+};
+
+const char* batch_verb(int kind)
+{
+    switch(kind) {
+        case batch_kind::Copy: return "Copy";
+        case batch_kind::Move: return "Move";
+        default: return "Delete";
+    }
+}
+
+//what fails inside a directory goes straight to the job's failures, the return is about the item itself
+std::error_code run_item(int kind, const batch_item_t& item, bool can_override, job_t& job)
+{
+    switch(kind) {
+        case batch_kind::Copy:
+            return copy(item.src, item.dst, can_override, job.progress, job.stop.get_token(), &job.failures);
+        case batch_kind::Move: {
+            const auto ec = move(item.src, item.dst, can_override, job.progress, job.stop.get_token(), &job.failures);
+            return ec.first ? ec.first : ec.second;
+        }
+        default:
+            return delete_(item.src, job.progress, job.stop.get_token(), &job.failures);
+    }
+}
+
+}
+
+preflight_t imc::backend::preflight(const std::vector<batch_item_t>& items, std::stop_token stop)
+{
+    const size_t threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_preflight_threads, max_preflight_threads);
+    tree_preflight_t tree(items, stop, threads);
+    tree.pool.run([&tree](size_t worker) {
+        for(size_t i = 0; i < tree.items.size(); i++)
+            tree.pool.push(worker, [&tree, i](size_t w) { tree.check_item(w, i); });
+    });
+
+    preflight_t result;
+    result.sizes.reserve(items.size());
+    for(const auto& size : tree.sizes) {
+        result.sizes.push_back(size.load());
+        result.total_bytes += result.sizes.back();
+    }
+    result.own_sizes = std::move(tree.own_sizes);
+    result.files = tree.files;
+    result.directories = tree.directories;
+    result.inner_conflicts = tree.inner_conflicts;
+    result.unreadable = tree.unreadable;
+    //the items were checked in whatever order the threads got to them
+    result.conflicts = std::move(tree.conflicts);
+    std::sort(result.conflicts.begin(), result.conflicts.end());
+    result.errors = std::move(tree.errors);
+    std::sort(result.errors.begin(), result.errors.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+    return result;
+}
+
+std::vector<batch_item_t> imc::backend::batch_items(const std::vector<fs::path>& sources, const fs::path& dir)
+{
+    std::vector<batch_item_t> items;
+    items.reserve(sources.size());
+    for(const auto& src : sources)
+        items.push_back({ src, dir.empty() ? fs::path() : dir / src.filename() });
+    return items;
+}
+
+JobPtr imc::backend::make_batch_job(int kind, std::vector<batch_item_t> items, bool can_override, uint64_t total_bytes)
+{
+    auto job = std::make_shared<job_t>();
+    job->description = fmt::format("{} {} items", batch_verb(kind), items.size());
+    if (!items.empty()) {
+        const auto& last = items.back();
+        job->description += fmt::format(" from {}", last.src.parent_path().generic_string());
+        if (!last.dst.empty())
+            job->description += fmt::format(" to {}", last.dst.parent_path().generic_string());
+    }
+
+    //a selection mostly shares one parent, only look each directory up once
+    std::set<fs::path> directories;
+    for(const auto& item : items) {
+        directories.insert(item.src.parent_path());
+        if (!item.dst.empty())
+            directories.insert(item.dst.parent_path());
+    }
+    for(const auto& dir : directories)
+        job->devices.push_back(device_of(dir));
+
+    job->progress.total = total_bytes;
+    job->progress.files_total = items.size();
+    job->run = [kind, items = std::move(items), can_override](job_t& j) {
+        for(const auto& item : items) {
+            //a file being copied waits inside the copy, everything else waits here
+            wait_while_paused(j.progress, j.stop.get_token());
+            if (j.stop.stop_requested())
+                return std::make_error_code(std::errc::operation_canceled);
+            auto ec = run_item(kind, item, can_override, j);
+            if (ec == std::errc::operation_canceled)
+                return ec;
+            if (ec)
+                j.failures.emplace_back(item.src, ec);
+            j.progress.files_done++;
+        }
+        return j.failures.empty() ? std::error_code() : j.failures.front().second;
+    };
+    return job;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <stop_token>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "job_queue.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    namespace batch_kind {
+        constexpr int Copy = 0;
+        constexpr int Move = 1;
+        constexpr int Delete = 2;
+    }
+
+    struct batch_item_t
+    {
+        fs::path    src;
+        // Empty for deletes.
+        fs::path    dst;
+    };
+
+    // What a batch is about to do, indices are into the items. The totals
+    // count what is under the selected directories too.
+    struct preflight_t
+    {
+        uint64_t                                        total_bytes{0U};
+        // bytes of every item, what is under a directory included
+        std::vector<uint64_t>                           sizes;
+        // bytes of every item's own entry, 0 for anything that isn't a regular
+        // file: what a batch job's total starts at, copy_tree adds the files
+        // under a directory to it as it finds them
+        std::vector<uint64_t>                           own_sizes;
+        size_t                                          files{0U};
+        size_t                                          directories{0U};
+        // items whose dst already exists
+        std::vector<size_t>                             conflicts;
+        // entries under those items that also exist under their dst, an
+        // overriding copy or move merges into it and replaces them
+        size_t                                          inner_conflicts{0U};
+        // items whose src couldn't be looked at
+        std::vector<std::pair<size_t, std::error_code>> errors;
+        // directories under the items that couldn't be listed, what is in them isn't counted
+        size_t                                          unreadable{0U};
+    };
+
+    // Stats every item and walks the selected directories (and, where the
+    // destination already has them, their counterparts there) in one sweep
+    // on a work-stealing pool. Symlinks aren't followed and a directory
+    // reached twice isn't walked again. A stop request ends it early, what
+    // it returns then is incomplete.
+    preflight_t preflight(const std::vector<batch_item_t>& items, std::stop_token stop = {});
+
+    // Destination of every src when they all go into dir.
+    std::vector<batch_item_t> batch_items(const std::vector<fs::path>& sources, const fs::path& dir);
+
+    // One job for the whole batch: combined progress (bytes and files),
+    // items that fail are collected in the job's failures and the rest carry on.
+    JobPtr make_batch_job(int kind, std::vector<batch_item_t> items, bool can_override, uint64_t total_bytes);
+}
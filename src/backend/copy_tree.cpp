@@ -0,0 +1,320 @@
+#include "copy_tree.h"
+
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#ifdef _IMC_NIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+//a task per this many files, so a huge flat directory still spreads over every thread
+constexpr size_t files_per_task = 64;
+//small files are latency bound, more of them in flight than cores still helps
+constexpr size_t min_tree_threads = 4;
+constexpr size_t max_tree_threads = 16;
+
+namespace entry_kind {
+    constexpr int File = 0;
+    constexpr int Directory = 1;
+    constexpr int Symlink = 2;
+    constexpr int Fifo = 3;
+    constexpr int Other = 4;
+}
+
+struct child_t
+{
+    std::string     name;
+    int             kind{entry_kind::Other};
+    uint32_t        mode{0U};
+    uint64_t        size{0U};
+    uint64_t        dev{0U};
+    uint64_t        ino{0U};
+    //it showed up in the listing but couldn't be looked at
+    std::error_code ec;
+};
+
+using identity_t = std::pair<uint64_t, uint64_t>;
+
+#ifdef _IMC_NIX
+std::error_code last_error()
+{
+    return std::error_code(errno, std::generic_category());
+}
+
+int kind_of(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return entry_kind::File;
+    if (S_ISDIR(mode))
+        return entry_kind::Directory;
+    if (S_ISLNK(mode))
+        return entry_kind::Symlink;
+    if (S_ISFIFO(mode))
+        return entry_kind::Fifo;
+    return entry_kind::Other;
+}
+#endif
+
+//the directory's entries except . and .., nothing followed
+std::error_code list_children(const fs::path& dir, std::vector<child_t>& children)
+{
+#ifdef _IMC_NIX
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return last_error();
+    DIR* d = fdopendir(fd);
+    if (d == nullptr) {
+        const auto ec = last_error();
+        close(fd);
+        return ec;
+    }
+    std::error_code ec;
+    for(;;) {
+        errno = 0;
+        const dirent* entry = readdir(d);
+        if (entry == nullptr) {
+            if (errno != 0)
+                ec = last_error();
+            break;
+        }
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+        auto& child = children.emplace_back();
+        child.name = entry->d_name;
+        struct stat st;
+        if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            child.ec = last_error();
+            continue;
+        }
+        child.kind = kind_of(st.st_mode);
+        child.mode = st.st_mode & 07777;
+        child.size = S_ISREG(st.st_mode) ? static_cast<uint64_t>(st.st_size) : 0U;
+        child.dev = st.st_dev;
+        child.ino = st.st_ino;
+    }
+    //closes fd too
+    closedir(d);
+    return ec;
+#else
+    std::error_code ec;
+    for(auto it = fs::directory_iterator(dir, ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        auto& child = children.emplace_back();
+        child.name = it->path().filename().string();
+        const auto status = it->symlink_status(child.ec);
+        if (child.ec)
+            continue;
+        if (fs::is_symlink(status))
+            child.kind = entry_kind::Symlink;
+        else if (fs::is_directory(status))
+            child.kind = entry_kind::Directory;
+        else if (fs::is_regular_file(status))
+            child.kind = entry_kind::File;
+        else if (fs::is_fifo(status))
+            child.kind = entry_kind::Fifo;
+        child.mode = static_cast<uint32_t>(status.permissions());
+        if (child.kind == entry_kind::File)
+            child.size = it->file_size(child.ec);
+    }
+    return ec;
+#endif
+}
+
+//dev/ino of path itself, zeros when unknown
+identity_t identity_of(const fs::path& path)
+{
+#ifdef _IMC_NIX
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0)
+        return { uint64_t{st.st_dev}, uint64_t{st.st_ino} };
+#endif
+    return { 0U, 0U };
+}
+
+struct tree_copy_t
+{
+    bool                    can_override;
+    copy_progress_t&        progress;
+    std::stop_token         stop;
+    failures_t&             failures;
+    work_stealing_pool_t    pool;
+
+    std::mutex              mutex;
+    std::set<identity_t>    visited;
+    //the copy itself, if it is inside src it mustn't get copied into itself
+    identity_t              dst_root;
+    //every directory created, to get its real permissions once it is filled
+    std::vector<std::pair<fs::path, uint32_t>> modes;
+
+    tree_copy_t(bool override_, copy_progress_t& progress_, std::stop_token stop_, failures_t& failures_, size_t threads)
+    : can_override(override_), progress(progress_), stop(std::move(stop_)), failures(failures_), pool(threads)
+    {
+    }
+
+    void fail(const fs::path& path, std::error_code ec)
+    {
+        std::lock_guard lock(mutex);
+        failures.emplace_back(path, ec);
+    }
+
+    //false if the directory was already walked
+    bool enter(const fs::path& path, identity_t id)
+    {
+        if (id == identity_t{0U, 0U})
+            return true;
+        std::lock_guard lock(mutex);
+        if (id == dst_root)
+            return false;
+        if (!visited.insert(id).second) {
+            failures.emplace_back(path, std::make_error_code(std::errc::too_many_symbolic_link_levels));
+            return false;
+        }
+        return true;
+    }
+
+    //it is created writable so it can be filled, mode is applied at the end
+    std::error_code make_dir(const fs::path& dst, uint32_t mode)
+    {
+        std::error_code ec;
+        if (!fs::create_directory(dst, ec) && !ec) {
+            //it was already there, copying into it is merging
+            if (!can_override || !fs::is_directory(fs::symlink_status(dst, ec)))
+                return std::make_error_code(std::errc::file_exists);
+        }
+        if (ec)
+            return ec;
+        std::lock_guard lock(mutex);
+        modes.emplace_back(dst, mode);
+        return {};
+    }
+
+    std::error_code copy_entry(const child_t& child, const fs::path& src, const fs::path& dst)
+    {
+        switch(child.kind) {
+            case entry_kind::File:
+                return copy(src, dst, can_override, progress, stop);
+            case entry_kind::Symlink:
+                return copy_symlink(src, dst, can_override);
+#ifdef _IMC_NIX
+            case entry_kind::Fifo:
+                if (mkfifo(dst.c_str(), child.mode) != 0)
+                    return last_error();
+                return {};
+#endif
+            default:
+                //sockets and devices aren't something a file manager should recreate
+                return std::make_error_code(std::errc::not_supported);
+        }
+    }
+
+    void copy_files(const fs::path& src, const fs::path& dst, const std::vector<child_t>& files, size_t first, size_t last)
+    {
+        for(size_t i = first; i < last; i++) {
+            wait_while_paused(progress, stop);
+            if (stop.stop_requested())
+                return;
+            const auto from = src / files[i].name;
+            const auto ec = copy_entry(files[i], from, dst / files[i].name);
+            if (ec && ec != std::errc::operation_canceled)
+                fail(from, ec);
+            progress.files_done++;
+        }
+    }
+
+    void copy_directory(size_t worker, const fs::path& src, const fs::path& dst)
+    {
+        wait_while_paused(progress, stop);
+        if (stop.stop_requested())
+            return;
+        std::vector<child_t> children;
+        if (const auto ec = list_children(src, children)) {
+            fail(src, ec);
+            //whatever was read before the error still gets copied
+        }
+
+        auto files = std::make_shared<std::vector<child_t>>();
+        uint64_t bytes = 0;
+        for(auto& child : children) {
+            if (child.ec) {
+                fail(src / child.name, child.ec);
+                continue;
+            }
+            if (child.kind != entry_kind::Directory) {
+                bytes += child.size;
+                files->push_back(std::move(child));
+                continue;
+            }
+            auto from = src / child.name;
+            auto to = dst / child.name;
+            if (!enter(from, { child.dev, child.ino }))
+                continue;
+            //children only get pushed once their directory exists
+            if (const auto ec = make_dir(to, child.mode)) {
+                fail(from, ec);
+                continue;
+            }
+            pool.push(worker, [this, from = std::move(from), to = std::move(to)](size_t w) {
+                copy_directory(w, from, to);
+            });
+        }
+        progress.files_total += files->size();
+        progress.total += bytes;
+
+        //all batches but the last go out for the taking, the last one is done right here
+        size_t first = 0;
+        for(; first + files_per_task < files->size(); first += files_per_task) {
+            pool.push(worker, [this, src, dst, files, first](size_t) {
+                copy_files(src, dst, *files, first, first + files_per_task);
+            });
+        }
+        copy_files(src, dst, *files, first, files->size());
+    }
+};
+
+}
+
+std::error_code imc::backend::copy_tree(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress,
+                                        std::stop_token stop, failures_t& failures, size_t threads)
+{
+    std::error_code ec;
+    const auto status = fs::symlink_status(src, ec);
+    if (ec)
+        return ec;
+    if (!fs::is_directory(status))
+        return std::make_error_code(std::errc::not_a_directory);
+    if (threads == 0)
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_tree_threads, max_tree_threads);
+
+    tree_copy_t tree(can_override, progress, stop, failures, threads);
+    if ((ec = tree.make_dir(dst, static_cast<uint32_t>(status.permissions()))))
+        return ec;
+    tree.dst_root = identity_of(dst);
+    tree.enter(src, identity_of(src));
+    tree.pool.run([&tree, &src, &dst](size_t worker) {
+        tree.copy_directory(worker, src, dst);
+    });
+
+    //children before their parents, a parent losing its write or search bit can't block them
+    for(auto it = tree.modes.rbegin(); it != tree.modes.rend(); ++it) {
+        fs::permissions(it->first, static_cast<fs::perms>(it->second), ec);
+        if (ec)
+            failures.emplace_back(it->first, ec);
+    }
+    if (stop.stop_requested())
+        return std::make_error_code(std::errc::operation_canceled);
+    return {};
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+#include <stop_token>
+#include <system_error>
+
+#include "file_operations.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // Copies the directory src to dst on a work-stealing pool of threads
+    // (0 picks a default). Every directory is created before anything goes
+    // in it, its files are copied in batches any thread can pick up and its
+    // subdirectories become tasks of their own. Symlinks are recreated, not
+    // followed, and a directory reached twice (bind mounts, dst inside src)
+    // isn't descended again. Entries that fail land in failures and the
+    // rest carry on; the return is for src/dst themselves or a cancel,
+    // which leaves what was copied so far. Files found are added to
+    // progress' totals as the walk goes.
+    std::error_code copy_tree(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress,
+                              std::stop_token stop, failures_t& failures, size_t threads = 0);
+}
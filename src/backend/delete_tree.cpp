@@ -0,0 +1,250 @@
+#include "delete_tree.h"
+
+#include "linux_dirent.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _IMC_NIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+//unlinks are metadata latency bound, more of them in flight than cores still helps
+constexpr size_t min_tree_threads = 4;
+constexpr size_t max_tree_threads = 16;
+
+#ifdef _IMC_NIX
+//smaller than list_dir's, there are a few of these per thread at once
+constexpr size_t dirent_buffer_size = 64 * 1024;
+
+std::error_code last_error()
+{
+    return std::error_code(errno, std::generic_category());
+}
+
+//one directory being emptied, opened and removed relative to its parent's fd so
+//a directory higher up swapped for a symlink meanwhile can't lead the delete elsewhere
+struct node_t
+{
+    std::string             name;
+    //for failures only, never opened
+    fs::path                path;
+    std::shared_ptr<node_t> parent;
+    //open until the last subdirectory is gone, they are opened and removed through it
+    int                     fd{-1};
+    //its own listing plus every subdirectory not removed yet
+    std::atomic<size_t>     pending{1U};
+    //something in it stays, so it has to stay too
+    std::atomic_bool        keep{false};
+};
+
+using NodePtr = std::shared_ptr<node_t>;
+
+struct tree_delete_t
+{
+    copy_progress_t&        progress;
+    std::stop_token         stop;
+    failures_t&             failures;
+    work_stealing_pool_t    pool;
+    dev_t                   device{0};
+    //the directory the tree's root is in
+    int                     root_parent_fd{-1};
+
+    std::mutex              mutex;
+
+    tree_delete_t(copy_progress_t& progress_, std::stop_token stop_, failures_t& failures_, size_t threads)
+    : progress(progress_), stop(std::move(stop_)), failures(failures_), pool(threads)
+    {
+    }
+
+    void fail(const fs::path& path, std::error_code ec)
+    {
+        std::lock_guard lock(mutex);
+        failures.emplace_back(path, ec);
+    }
+
+    int parent_fd(const node_t& node) const
+    {
+        return node.parent ? node.parent->fd : root_parent_fd;
+    }
+
+    //the last one out removes the directory, then maybe its parent
+    void finish(NodePtr node)
+    {
+        while (node && --node->pending == 0) {
+            if (node->fd != -1) {
+                close(node->fd);
+                node->fd = -1;
+            }
+            bool removed = false;
+            if (!node->keep && !stop.stop_requested()) {
+                if (unlinkat(parent_fd(*node), node->name.c_str(), AT_REMOVEDIR) == 0 || errno == ENOENT) {
+                    progress.files_done++;
+                    removed = true;
+                } else {
+                    fail(node->path, last_error());
+                }
+            }
+            if (!removed && node->parent)
+                node->parent->keep = true;
+            node = node->parent;
+        }
+    }
+
+    void unlink_entry(int dirfd, const NodePtr& node, const char* name)
+    {
+        if (unlinkat(dirfd, name, 0) == 0 || errno == ENOENT) {
+            progress.files_done++;
+            return;
+        }
+        fail(node->path / name, last_error());
+        node->keep = true;
+    }
+
+    void empty_directory(size_t worker, const NodePtr& node)
+    {
+        wait_while_paused(progress, stop);
+        if (stop.stop_requested()) {
+            finish(node);
+            return;
+        }
+        const int dirfd = openat(parent_fd(*node), node->name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (dirfd == -1) {
+            fail(node->path, last_error());
+            node->keep = true;
+            finish(node);
+            return;
+        }
+        //a mount point, whatever is mounted there isn't ours to delete
+        if (struct stat st; fstat(dirfd, &st) != 0 || st.st_dev != device) {
+            fail(node->path, std::make_error_code(std::errc::cross_device_link));
+            node->keep = true;
+            close(dirfd);
+            finish(node);
+            return;
+        }
+
+        //read it all before touching it, some filesystems skip entries when the directory changes under getdents
+        std::vector<std::pair<std::string, bool>> entries;
+        auto buffer = std::make_unique<char[]>(dirent_buffer_size);
+        for(;;) {
+            const long len = syscall(SYS_getdents64, dirfd, buffer.get(), dirent_buffer_size);
+            if (len < 0) {
+                fail(node->path, last_error());
+                node->keep = true;
+                break;
+            }
+            if (len == 0)
+                break;
+            for(long pos = 0; pos < len; ) {
+                const auto* entry = reinterpret_cast<const linux_dirent64*>(buffer.get() + pos);
+                pos += entry->d_reclen;
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                    continue;
+                bool is_directory = entry->d_type == DT_DIR;
+                //the filesystem didn't say, lstat does
+                if (struct stat st; entry->d_type == DT_UNKNOWN && fstatat(dirfd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                    is_directory = S_ISDIR(st.st_mode);
+                entries.emplace_back(entry->d_name, is_directory);
+            }
+        }
+        progress.files_total += entries.size();
+
+        node->fd = dirfd;
+        for(auto& [name, is_directory] : entries) {
+            wait_while_paused(progress, stop);
+            if (stop.stop_requested())
+                break;
+            if (!is_directory) {
+                unlink_entry(dirfd, node, name.c_str());
+                continue;
+            }
+            auto child = std::make_shared<node_t>();
+            child->path = node->path / name;
+            child->name = std::move(name);
+            child->parent = node;
+            node->pending++;
+            pool.push(worker, [this, child = std::move(child)](size_t w) {
+                empty_directory(w, child);
+            });
+        }
+        finish(node);
+    }
+};
+#endif
+
+}
+
+std::error_code imc::backend::delete_tree(const fs::path& dir, copy_progress_t& progress, std::stop_token stop, failures_t& failures, size_t threads)
+{
+#ifdef _IMC_NIX
+    //a trailing separator leaves no name to remove the directory by
+    auto root_path = dir.lexically_normal();
+    if (!root_path.has_filename())
+        root_path = root_path.parent_path();
+    if (!root_path.has_filename() || root_path.filename() == "." || root_path.filename() == "..")
+        return std::make_error_code(std::errc::invalid_argument);
+    const auto parent = root_path.has_parent_path() ? root_path.parent_path() : fs::path(".");
+    const int parent_fd = ::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (parent_fd == -1)
+        return last_error();
+    struct stat st;
+    if (fstatat(parent_fd, root_path.filename().c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        const auto ec = last_error();
+        close(parent_fd);
+        return ec;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        close(parent_fd);
+        return std::make_error_code(std::errc::not_a_directory);
+    }
+    if (threads == 0)
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_tree_threads, max_tree_threads);
+
+    tree_delete_t tree(progress, stop, failures, threads);
+    tree.device = st.st_dev;
+    tree.root_parent_fd = parent_fd;
+    auto root = std::make_shared<node_t>();
+    root->name = root_path.filename().string();
+    root->path = dir;
+    progress.files_total++;
+    tree.pool.run([&tree, &root](size_t worker) {
+        tree.empty_directory(worker, root);
+    });
+    close(parent_fd);
+    if (stop.stop_requested())
+        return std::make_error_code(std::errc::operation_canceled);
+    return {};
+#else
+    //no fds to walk here, std::filesystem does it in one go
+    (void)threads;
+    std::error_code ec;
+    if (stop.stop_requested())
+        return std::make_error_code(std::errc::operation_canceled);
+    const auto removed = fs::remove_all(dir, ec);
+    if (ec) {
+        failures.emplace_back(dir, ec);
+        return {};
+    }
+    progress.files_total += static_cast<size_t>(removed);
+    progress.files_done += static_cast<size_t>(removed);
+    return {};
+#endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include <stop_token>
+#include <system_error>
+
+#include "file_operations.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // Removes the directory dir and everything in it on a work-stealing
+    // pool of threads (0 picks a default). On linux every directory is
+    // opened and removed relative to its parent's fd, never by its path, so
+    // a directory above it swapped for a symlink can't lead the delete out
+    // of the tree. It is read with getdents64 and its entries unlinked
+    // relative to its own fd, it goes as soon as its last subdirectory is gone. Symlinks are
+    // removed, not followed, and nothing on another filesystem (a mount
+    // point inside dir) is touched. What fails lands in failures and the
+    // directories above it are left in place, everything else still goes.
+    // progress counts entries: files_total grows as they are found and
+    // files_done as they are removed. A cancel stops between entries, a
+    // pause (progress.paused) waits there.
+    std::error_code delete_tree(const fs::path& dir, copy_progress_t& progress, std::stop_token stop, failures_t& failures, size_t threads = 0);
+}
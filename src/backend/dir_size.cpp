@@ -0,0 +1,281 @@
+#include "dir_size.h"
+
+#include "io_executor.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <set>
+#include <thread>
+#include <utility>
+
+#ifdef _IMC_NIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+//stats are metadata latency bound, more of them in flight than cores still helps
+constexpr size_t min_size_threads = 4;
+constexpr size_t max_size_threads = 16;
+
+//one of the directories asked for, done when the last directory under it is
+struct tree_t
+{
+    std::string             name;
+    uint64_t                device{0U};
+    std::atomic<uint64_t>   bytes{0U};
+    //directories pushed but not done yet, the tree's own included
+    std::atomic<size_t>     pending{1U};
+    std::mutex              mutex;
+    //(device, inode) of the files with more than one link already counted
+    std::set<std::pair<uint64_t, uint64_t>> links;
+};
+
+using TreePtr = std::shared_ptr<tree_t>;
+
+struct tree_size_t
+{
+    dir_size_cache_t&                   cache;
+    dir_size_stats_t&                   stats;
+    std::stop_token                     stop;
+    std::mutex&                         mutex;
+    std::vector<dir_sizer_t::result_t>& results;
+    work_stealing_pool_t                pool;
+
+    tree_size_t(dir_size_cache_t& cache_, dir_size_stats_t& stats_, std::stop_token stop_,
+                std::mutex& mutex_, std::vector<dir_sizer_t::result_t>& results_, size_t threads)
+    : cache(cache_), stats(stats_), stop(std::move(stop_)), mutex(mutex_), results(results_), pool(threads)
+    {
+    }
+
+    void finish(tree_t& tree)
+    {
+        if (tree.pending.fetch_sub(1U, std::memory_order_acq_rel) != 1U || stop.stop_requested())
+            return;
+        stats.finished.fetch_add(1U, std::memory_order_relaxed);
+        std::lock_guard lock(mutex);
+        results.push_back({ tree.name, tree.bytes.load() });
+    }
+
+    void push(size_t worker, const TreePtr& tree, fs::path path)
+    {
+        tree->pending.fetch_add(1U, std::memory_order_relaxed);
+        pool.push(worker, [this, tree, path = std::move(path)](size_t w) {
+            size_directory(w, tree, path);
+        });
+    }
+
+#ifdef _IMC_NIX
+    //nullptr if it can't be read, an unreadable directory just adds nothing
+    dir_size_cache_t::EntryPtr list(const fs::path& path, dev_t device)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1)
+            return nullptr;
+        DIR* dir = fdopendir(fd);
+        if (dir == nullptr) {
+            close(fd);
+            return nullptr;
+        }
+        auto entry = std::make_shared<dir_size_cache_t::entry_t>();
+        while (const dirent* de = readdir(dir)) {
+            const char* name = de->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                continue;
+            //a subdirectory gets its stat when it is visited, that is where the device is checked
+            if (de->d_type == DT_DIR) {
+                entry->subdirs.emplace_back(name);
+                continue;
+            }
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            if (S_ISDIR(st.st_mode)) {
+                if (st.st_dev == device)
+                    entry->subdirs.emplace_back(name);
+                continue;
+            }
+            entry->files++;
+            if (st.st_nlink > 1)
+                entry->hardlinks.push_back({ uint64_t{st.st_dev}, uint64_t{st.st_ino}, static_cast<uint64_t>(st.st_size) });
+            else
+                entry->bytes += static_cast<uint64_t>(st.st_size);
+        }
+        closedir(dir);
+        stats.listed.fetch_add(1U, std::memory_order_relaxed);
+        return entry;
+    }
+
+    void add(size_t worker, const TreePtr& tree, const fs::path& path, const struct stat& st)
+    {
+        stats.directories.fetch_add(1U, std::memory_order_relaxed);
+        const int64_t mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        auto entry = cache.find(st.st_dev, st.st_ino, mtime);
+        if (!entry) {
+            entry = list(path, st.st_dev);
+            if (!entry)
+                return;
+            cache.insert(st.st_dev, st.st_ino, mtime, entry);
+        }
+        stats.files.fetch_add(entry->files, std::memory_order_relaxed);
+        uint64_t bytes = entry->bytes;
+        if (!entry->hardlinks.empty()) {
+            std::lock_guard lock(tree->mutex);
+            for(const auto& link : entry->hardlinks) {
+                if (tree->links.emplace(link.device, link.inode).second)
+                    bytes += link.size;
+            }
+        }
+        tree->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        for(const auto& subdir : entry->subdirs)
+            push(worker, tree, path / subdir);
+    }
+
+    //the directory asked for may be a symlink to one, the ones under it are never followed
+    void size_tree(size_t worker, const TreePtr& tree, const fs::path& path)
+    {
+        struct stat st;
+        if (!stop.stop_requested() && ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            tree->device = st.st_dev;
+            add(worker, tree, path, st);
+        }
+        finish(*tree);
+    }
+
+    void size_directory(size_t worker, const TreePtr& tree, const fs::path& path)
+    {
+        struct stat st;
+        if (!stop.stop_requested() && lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_dev == tree->device)
+            add(worker, tree, path, st);
+        finish(*tree);
+    }
+#else
+    //no inodes to key the cache with or to tell hardlinks apart, every directory gets listed
+    void size_directory(size_t worker, const TreePtr& tree, const fs::path& path)
+    {
+        if (!stop.stop_requested()) {
+            stats.directories.fetch_add(1U, std::memory_order_relaxed);
+            stats.listed.fetch_add(1U, std::memory_order_relaxed);
+            uint64_t bytes = 0;
+            std::error_code ec;
+            for(auto it = fs::directory_iterator(path, fs::directory_options::skip_permission_denied, ec);
+                !ec && it != fs::directory_iterator(); it.increment(ec)) {
+                std::error_code entry_ec;
+                if (it->is_symlink(entry_ec))
+                    continue;
+                if (it->is_directory(entry_ec)) {
+                    push(worker, tree, it->path());
+                } else if (it->is_regular_file(entry_ec)) {
+                    stats.files.fetch_add(1U, std::memory_order_relaxed);
+                    if (const auto size = it->file_size(entry_ec); !entry_ec)
+                        bytes += size;
+                }
+            }
+            tree->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        finish(*tree);
+    }
+
+    void size_tree(size_t worker, const TreePtr& tree, const fs::path& path)
+    {
+        size_directory(worker, tree, path);
+    }
+#endif
+};
+
+}
+
+imc::backend::dir_size_cache_t::EntryPtr imc::backend::dir_size_cache_t::find(uint64_t device, uint64_t inode, int64_t mtime) const
+{
+    std::lock_guard lock(mutex_);
+    const auto it = entries_.find(key_t{ device, inode, mtime });
+    return it == entries_.end() ? nullptr : it->second;
+}
+
+void imc::backend::dir_size_cache_t::insert(uint64_t device, uint64_t inode, int64_t mtime, EntryPtr entry)
+{
+    std::lock_guard lock(mutex_);
+    //whatever was cached for an older mtime of the directory just ages out with the rest
+    if (entries_.size() >= max_entries)
+        entries_.clear();
+    entries_.insert_or_assign(key_t{ device, inode, mtime }, std::move(entry));
+}
+
+size_t imc::backend::dir_size_cache_t::size() const
+{
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+imc::backend::dir_sizer_t::~dir_sizer_t()
+{
+    cancel();
+}
+
+void imc::backend::dir_sizer_t::start(const fs::path& parent, std::vector<std::string> names, dir_size_cache_t& cache, size_t threads)
+{
+    cancel();
+    if (threads == 0)
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_size_threads, max_size_threads);
+    sizing_ = std::make_shared<sizing_t>();
+    sizing_->stats.requested = names.size();
+    sizing_->started = std::chrono::steady_clock::now();
+    sizing_->running.store(true, std::memory_order_release);
+    stop_ = std::stop_source();
+    io_executor().submit([sizing = sizing_, parent, names = std::move(names), &cache, threads](std::stop_token stop) mutable {
+        run(stop, *sizing, parent, std::move(names), cache, threads);
+    }, stop_.get_token());
+}
+
+void imc::backend::dir_sizer_t::cancel()
+{
+    //a task that never started has nobody else to say it is done
+    stop_.request_stop();
+    if (sizing_->running)
+        sizing_->finish();
+}
+
+void imc::backend::dir_sizer_t::sizing_t::finish()
+{
+    auto none = std::chrono::steady_clock::rep{0};
+    finished.compare_exchange_strong(none, std::chrono::steady_clock::now().time_since_epoch().count());
+    running.store(false, std::memory_order_release);
+}
+
+void imc::backend::dir_sizer_t::run(std::stop_token stop, sizing_t& sizing, const fs::path& parent, std::vector<std::string> names, dir_size_cache_t& cache, size_t threads)
+{
+    if (!names.empty()) {
+        tree_size_t sizes(cache, sizing.stats, stop, sizing.mutex, sizing.results, threads);
+        sizes.pool.run([&sizes, &parent, &names](size_t worker) {
+            //every tree is its own task, the pool spreads them before their subdirectories
+            for(auto& name : names) {
+                auto tree = std::make_shared<tree_t>();
+                tree->name = std::move(name);
+                sizes.pool.push(worker, [&sizes, tree, path = parent / tree->name](size_t w) {
+                    sizes.size_tree(w, tree, path);
+                });
+            }
+        });
+    }
+    sizing.finish();
+}
+
+std::vector<dir_sizer_t::result_t> imc::backend::dir_sizer_t::take_results()
+{
+    std::lock_guard lock(sizing_->mutex);
+    return std::exchange(sizing_->results, {});
+}
+
+std::chrono::duration<double> imc::backend::dir_sizer_t::elapsed() const
+{
+    const auto finished = sizing_->finished.load();
+    const auto end = finished != 0 ?
+        std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(finished)) :
+        std::chrono::steady_clock::now();
+    return end - sizing_->started;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // What listing a directory told us, kept by (device, inode, mtime).
+    // A directory's mtime changes when anything is added to, removed from
+    // or renamed in it, so as long as it doesn't the directory isn't listed
+    // again: only its subdirectories are visited (a stat each), since a
+    // change deep down only touches the directory it happened in. A file
+    // rewritten in place doesn't change its directory, its new size shows
+    // once that directory is listed again.
+    class dir_size_cache_t
+    {
+    public:
+        // a file with more than one link, counted once per calculation
+        struct hardlink_t
+        {
+            uint64_t device;
+            uint64_t inode;
+            uint64_t size;
+        };
+
+        struct entry_t
+        {
+            // files with a single link
+            uint64_t                    bytes{0U};
+            uint64_t                    files{0U};
+            std::vector<hardlink_t>     hardlinks;
+            // only the ones on the directory's own device
+            std::vector<std::string>    subdirs;
+        };
+
+        using EntryPtr = std::shared_ptr<const entry_t>;
+
+        // Dropped all at once past this many directories.
+        static constexpr size_t max_entries = 1024 * 1024;
+
+        EntryPtr find(uint64_t device, uint64_t inode, int64_t mtime) const;
+        void insert(uint64_t device, uint64_t inode, int64_t mtime, EntryPtr entry);
+        size_t size() const;
+
+    private:
+        struct key_t
+        {
+            uint64_t device;
+            uint64_t inode;
+            int64_t  mtime;
+
+            bool operator==(const key_t&) const = default;
+        };
+
+        struct key_hash_t
+        {
+            size_t operator()(const key_t& key) const
+            {
+                return std::hash<uint64_t>{}(key.inode * 0x9e3779b97f4a7c15ULL ^ key.device ^ static_cast<uint64_t>(key.mtime));
+            }
+        };
+
+        mutable std::mutex                              mutex_;
+        std::unordered_map<key_t, EntryPtr, key_hash_t> entries_;
+    };
+
+    // Counters of a calculation, read by the ui while it runs.
+    struct dir_size_stats_t
+    {
+        // directories asked for, and how many of them are done
+        std::atomic<uint64_t> requested{0U};
+        std::atomic<uint64_t> finished{0U};
+        std::atomic<uint64_t> directories{0U};
+        // directories the cache didn't know (any more) and had to be listed
+        std::atomic<uint64_t> listed{0U};
+        std::atomic<uint64_t> files{0U};
+    };
+
+    // Total size of the files under some directories of a parent, like
+    // du -sbx for each: the trees are walked together on a work-stealing
+    // pool (every directory is a task), files with more than one link are
+    // counted once per tree, symlinks aren't followed and other file
+    // systems aren't entered. A directory's total comes out as soon as its
+    // whole tree is done. The calculation is a task on the shared
+    // io_executor_t, cancelling it doesn't wait for it.
+    class dir_sizer_t
+    {
+    public:
+        struct result_t
+        {
+            // as given to start
+            std::string name;
+            uint64_t    bytes;
+        };
+
+        dir_sizer_t() = default;
+        ~dir_sizer_t();
+        dir_sizer_t(const dir_sizer_t&) = delete;
+        dir_sizer_t& operator=(const dir_sizer_t&) = delete;
+
+        // Cancels a calculation still running first. names are relative to
+        // parent, cache has to outlive the calculation. 0 threads picks a default.
+        void start(const fs::path& parent, std::vector<std::string> names, dir_size_cache_t& cache, size_t threads = 0);
+        void cancel();
+        bool running() const { return sizing_->running.load(std::memory_order_acquire); }
+        // Directories finished since the last call.
+        std::vector<result_t> take_results();
+        const dir_size_stats_t& stats() const { return sizing_->stats; }
+        // How long it ran, or has been running.
+        std::chrono::duration<double> elapsed() const;
+
+    private:
+        // one calculation, a cancelled one keeps it until its task noticed
+        struct sizing_t
+        {
+            dir_size_stats_t                        stats;
+            std::mutex                              mutex;
+            std::vector<result_t>                   results;
+            std::atomic_bool                        running{false};
+            std::chrono::steady_clock::time_point   started;
+            std::atomic<std::chrono::steady_clock::rep> finished{0};
+
+            void finish();
+        };
+
+        static void run(std::stop_token stop, sizing_t& sizing, const fs::path& parent, std::vector<std::string> names, dir_size_cache_t& cache, size_t threads);
+
+        std::shared_ptr<sizing_t>   sizing_{std::make_shared<sizing_t>()};
+        std::stop_source            stop_;
+    };
+}
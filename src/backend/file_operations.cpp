@@ -4,11 +4,27 @@
 #include <shellapi.h>
 #endif
 
+#ifdef _IMC_NIX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
 #include <filesystem>
+#include <chrono>
 #include <cstdlib>
+#include <memory>
+#include <thread>
 
 #include <fmt/format.h>
 
+#include "copy_tree.h"
+#include "delete_tree.h"
 #include "types/errors.h"
 #include "utils/string_utils.h"
 
@@ -62,6 +78,226 @@ namespace {
 #endif
     }
 
+    //how much gets copied between progress updates and stop checks
+    constexpr size_t copy_chunk_size = 8 * 1024 * 1024;
+    constexpr size_t read_write_buffer_size = 1024 * 1024;
+
+    int64_t now_ticks()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    //bytes/s over everything copied into the progress since its first copy started, updated after every chunk.
+    //Copies running side by side share the progress, so each only adds what it did since its last update.
+    struct throughput_t
+    {
+        //what this copy already added to progress.copied
+        uint64_t reported{0U};
+
+        explicit throughput_t(imc::backend::copy_progress_t& progress)
+        {
+            int64_t not_started = 0;
+            progress.started.compare_exchange_strong(not_started, now_ticks());
+        }
+
+        void update(imc::backend::copy_progress_t& progress, uint64_t copied)
+        {
+            const uint64_t all = progress.copied += copied - reported;
+            reported = copied;
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::duration(now_ticks() - progress.started)).count();
+            if (elapsed > 0.0)
+                progress.bytes_per_second = static_cast<uint64_t>(static_cast<double>(all) / elapsed);
+        }
+
+        //takes back everything this copy added
+        void undo(imc::backend::copy_progress_t& progress)
+        {
+            progress.copied -= reported;
+            reported = 0;
+        }
+    };
+
+#ifdef _IMC_NIX
+    std::error_code last_error()
+    {
+        return std::error_code(errno, std::generic_category());
+    }
+
+    //errors that mean copy_file_range can't do this pair of files at all
+    bool copy_file_range_unsupported(int err)
+    {
+        return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP || err == EBADF;
+    }
+
+    //returns false and leaves ec clear if the kernel can't do it, read/write has to.
+    bool copy_with_copy_file_range(int src, int dst, uint64_t& copied, imc::backend::copy_progress_t& progress,
+                                   throughput_t& throughput, std::stop_token stop, std::error_code& ec)
+    {
+        for(;;) {
+            wait_while_paused(progress, stop);
+            if (stop.stop_requested()) {
+                ec = std::make_error_code(std::errc::operation_canceled);
+                return true;
+            }
+            const ssize_t len = copy_file_range(src, nullptr, dst, nullptr, copy_chunk_size, 0);
+            if (len < 0) {
+                if (errno == EINTR)
+                    continue;
+                //once something went through, failing halfway is a real error
+                if (copied == 0 && copy_file_range_unsupported(errno))
+                    return false;
+                ec = last_error();
+                return true;
+            }
+            if (len == 0)
+                return true;
+            copied += static_cast<uint64_t>(len);
+            throughput.update(progress, copied);
+        }
+    }
+
+    void copy_with_read_write(int src, int dst, uint64_t& copied, imc::backend::copy_progress_t& progress,
+                              throughput_t& throughput, std::stop_token stop, std::error_code& ec)
+    {
+        posix_fadvise(src, 0, 0, POSIX_FADV_SEQUENTIAL);
+        auto buffer = std::make_unique<char[]>(read_write_buffer_size);
+        size_t since_update = 0;
+        for(;;) {
+            wait_while_paused(progress, stop);
+            if (stop.stop_requested()) {
+                ec = std::make_error_code(std::errc::operation_canceled);
+                return;
+            }
+            const ssize_t len = read(src, buffer.get(), read_write_buffer_size);
+            if (len < 0) {
+                if (errno == EINTR)
+                    continue;
+                ec = last_error();
+                return;
+            }
+            if (len == 0)
+                break;
+            for(ssize_t written = 0; written < len;) {
+                const ssize_t w = write(dst, buffer.get() + written, static_cast<size_t>(len - written));
+                if (w < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    ec = last_error();
+                    return;
+                }
+                written += w;
+            }
+            copied += static_cast<uint64_t>(len);
+            since_update += static_cast<size_t>(len);
+            if (since_update >= copy_chunk_size) {
+                throughput.update(progress, copied);
+                since_update = 0;
+            }
+        }
+        throughput.update(progress, copied);
+    }
+
+    std::error_code copy_regular_file(const fs::path& src, const fs::path& dst, bool can_override,
+                                      imc::backend::copy_progress_t& progress, std::stop_token stop)
+    {
+        using namespace imc::backend;
+        //copy() handles links, one swapped in since isn't followed
+        const int sfd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (sfd == -1)
+            return last_error();
+        struct stat sst;
+        if (fstat(sfd, &sst) != 0) {
+            const auto ec = last_error();
+            close(sfd);
+            return ec;
+        }
+        if (!S_ISREG(sst.st_mode)) {
+            close(sfd);
+            return std::make_error_code(std::errc::not_supported);
+        }
+        //truncating src because it is also dst would lose it
+        if (struct stat dst_st; stat(dst.c_str(), &dst_st) == 0) {
+            if (!can_override || (dst_st.st_dev == sst.st_dev && dst_st.st_ino == sst.st_ino)) {
+                close(sfd);
+                return std::make_error_code(std::errc::file_exists);
+            }
+        }
+        const int dfd = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (can_override ? O_TRUNC : O_EXCL), sst.st_mode & 07777);
+        if (dfd == -1) {
+            const auto ec = last_error();
+            close(sfd);
+            return ec;
+        }
+
+        throughput_t throughput(progress);
+        //a batch set its total up front, a single copy is just this file
+        if (progress.files_total == 0)
+            progress.total = static_cast<uint64_t>(sst.st_size);
+        uint64_t copied = 0;
+        std::error_code ec;
+        if (ioctl(dfd, FICLONE, sfd) == 0) {
+            progress.method = copy_method::Reflink;
+            throughput.update(progress, static_cast<uint64_t>(sst.st_size));
+        } else {
+            progress.method = copy_method::CopyFileRange;
+            if (!copy_with_copy_file_range(sfd, dfd, copied, progress, throughput, stop, ec)) {
+                progress.method = copy_method::ReadWrite;
+                copy_with_read_write(sfd, dfd, copied, progress, throughput, stop, ec);
+            }
+        }
+        //open() went through the umask, the copy gets exactly src's permissions
+        if (!ec && fchmod(dfd, sst.st_mode & 07777) != 0)
+            ec = last_error();
+        if (close(dfd) != 0 && !ec)
+            ec = last_error();
+        close(sfd);
+        if (ec) {
+            unlink(dst.c_str());
+            throughput.undo(progress);
+        }
+        return ec;
+    }
+#endif
+
+    //true when it was renamed or failed for good, false if copy and remove have to do it
+    bool try_rename(const fs::path& src, const fs::path& dst, bool can_override, std::error_code& ec)
+    {
+#ifdef _IMC_NIX
+        if (renameat2(AT_FDCWD, src.c_str(), AT_FDCWD, dst.c_str(), can_override ? 0 : RENAME_NOREPLACE) == 0)
+            return true;
+        //some filesystems (older nfs, fuse) don't know the flag, kernels before 3.15 and some
+        //seccomp filters don't know the call at all (ENOSYS), check by hand then
+        if ((errno == EINVAL && !can_override) || errno == ENOSYS) {
+            if (struct stat st; !can_override && lstat(dst.c_str(), &st) == 0) {
+                ec = std::make_error_code(std::errc::file_exists);
+                return true;
+            }
+            if (::rename(src.c_str(), dst.c_str()) == 0)
+                return true;
+        }
+        const std::error_code failed(errno, std::generic_category());
+#else
+        if (!can_override && fs::exists(fs::symlink_status(dst, ec))) {
+            ec = std::make_error_code(std::errc::file_exists);
+            return true;
+        }
+        std::error_code failed;
+        fs::rename(src, dst, failed);
+        if (!failed)
+            return true;
+#endif
+        if (failed == std::errc::cross_device_link)
+            return false;
+        //a directory can't replace a non empty one, overriding merges into it instead
+        if (can_override && (failed == std::errc::directory_not_empty || failed == std::errc::file_exists) &&
+            fs::is_directory(fs::symlink_status(src, ec))) {
+            ec.clear();
+            return false;
+        }
+        ec = failed;
+        return true;
+    }
+
     int do_execute(const fs::path& file)
     {
 #if defined(_IMC_NIX) || defined(_IMC_MAC)
@@ -115,11 +351,68 @@ int imc::backend::open(const std::filesystem::path& file)
 #endif
 }
 
-std::error_code imc::backend::copy(const fs::path& src, const fs::path& dst, bool can_override)
+void imc::backend::wait_while_paused(copy_progress_t& progress, const std::stop_token& stop)
+{
+    if (!progress.paused)
+        return;
+    const auto paused_at = now_ticks();
+    while (progress.paused && !stop.stop_requested())
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    progress.started += now_ticks() - paused_at;
+}
+
+std::error_code imc::backend::copy(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress, std::stop_token stop,
+                                   failures_t* failures)
 {
-    //might use native if I have to
     std::error_code ec;
+    const auto status = fs::symlink_status(src, ec);
+    if (fs::is_directory(status)) {
+        failures_t inside;
+        ec = copy_tree(src, dst, can_override, progress, stop, failures ? *failures : inside);
+        return ec || inside.empty() ? ec : inside.front().second;
+    }
+    if (fs::is_symlink(status))
+        return copy_symlink(src, dst, can_override);
+#ifdef _IMC_NIX
+    return copy_regular_file(src, dst, can_override, progress, stop);
+#else
+    //no chunks here, std::filesystem copies it in one go
+    throughput_t throughput(progress);
+    progress.method = copy_method::None;
+    const uint64_t size = fs::file_size(src, ec);
+    if (ec)
+        return ec;
+    if (progress.files_total == 0)
+        progress.total = size;
+    if (stop.stop_requested())
+        return std::make_error_code(std::errc::operation_canceled);
     fs::copy_file(src, dst, can_override ? fs::copy_options::overwrite_existing : fs::copy_options::none, ec);
+    if (!ec)
+        throughput.update(progress, size);
+    return ec;
+#endif
+}
+
+std::error_code imc::backend::copy(const fs::path& src, const fs::path& dst, bool can_override)
+{
+    copy_progress_t progress;
+    return copy(src, dst, can_override, progress);
+}
+
+std::error_code imc::backend::copy_symlink(const fs::path& src, const fs::path& dst, bool can_override)
+{
+    std::error_code ec;
+    const auto target = fs::read_symlink(src, ec);
+    if (ec)
+        return ec;
+    if (fs::exists(fs::symlink_status(dst, ec))) {
+        if (!can_override)
+            return std::make_error_code(std::errc::file_exists);
+        fs::remove(dst, ec);
+        if (ec)
+            return ec;
+    }
+    fs::create_symlink(target, dst, ec);
     return ec;
 }
 
@@ -130,6 +423,16 @@ std::error_code imc::backend::delete_(const fs::path& src)
     return ec;
 }
 
+std::error_code imc::backend::delete_(const fs::path& src, copy_progress_t& progress, std::stop_token stop, failures_t* failures)
+{
+    if (std::error_code ec; fs::is_directory(fs::symlink_status(src, ec))) {
+        failures_t inside;
+        ec = delete_tree(src, progress, stop, failures ? *failures : inside);
+        return ec || inside.empty() ? ec : inside.front().second;
+    }
+    return delete_(src);
+}
+
 std::error_code imc::backend::make_directory(const fs::path& dir)
 {
     std::error_code ec;
@@ -137,20 +440,72 @@ std::error_code imc::backend::make_directory(const fs::path& dir)
     return ec;
 }
 
-std::pair<std::error_code, std::error_code> imc::backend::move(const fs::path& src, const fs::path& dst, bool can_override)
+std::pair<std::error_code, std::error_code> imc::backend::move(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress, std::stop_token stop,
+                                                               failures_t* failures)
 {
     std::pair<std::error_code, std::error_code> ec;
-    fs::copy_file(src, dst, ec.first);
-    if (ec.first) {
-        if (ec.first == std::errc::file_exists && can_override) {
-            fs::copy_file(src, dst, fs::copy_options::overwrite_existing, ec.first);
+    //what a batch counted for src, a rename has nothing to copy
+    uint64_t counted = 0;
+    if (std::error_code size_ec; progress.files_total > 0 && fs::is_regular_file(fs::symlink_status(src, size_ec))) {
+        const auto size = fs::file_size(src, size_ec);
+        counted = size_ec ? 0U : size;
+    }
+    if (try_rename(src, dst, can_override, ec.first)) {
+        if (!ec.first) {
+            progress.method = copy_method::Rename;
+            progress.total -= std::min<uint64_t>(counted, progress.total);
         }
-        if (ec.first)
-            return ec;
+        return ec;
+    }
+    ec.first.clear();
+    if (fs::is_directory(fs::symlink_status(src, ec.first))) {
+        //a partial copy leaves all of src, nothing is lost
+        failures_t inside;
+        auto& failed = failures ? *failures : inside;
+        const size_t before = failed.size();
+        ec.first = copy_tree(src, dst, can_override, progress, stop, failed);
+        if (!ec.first && failed.size() == before)
+            fs::remove_all(src, ec.second);
+        else if (!ec.first && !failures)
+            ec.first = inside.front().second;
+        return ec;
     }
+    ec.first = copy(src, dst, can_override, progress, stop);
+    if (ec.first)
+        return ec;
     fs::remove(src, ec.second);
     return ec;
 }
 
+std::pair<std::error_code, std::error_code> imc::backend::move(const fs::path& src, const fs::path& dst, bool can_override)
+{
+    copy_progress_t progress;
+    return move(src, dst, can_override, progress);
+}
 
-
+fs::path imc::backend::cache_directory()
+{
+    auto from_env = [](const char* name) {
+        const char* value = std::getenv(name);
+        return (value && *value) ? fs::path(value) : fs::path();
+    };
+#if defined(_IMC_WINDOWS)
+    fs::path base = from_env("LOCALAPPDATA");
+#elif defined(_IMC_MAC)
+    fs::path base = from_env("HOME");
+    if (!base.empty())
+        base /= "Library/Caches";
+#else
+    fs::path base = from_env("XDG_CACHE_HOME");
+    if (base.empty() && !(base = from_env("HOME")).empty())
+        base /= ".cache";
+#endif
+    if (base.empty())
+        return {};
+    const auto dir = base / "imcommander";
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+        return {};
+    return dir;
+}
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <stop_token>
 #include <system_error>
+#include <utility>
+#include <vector>
 
 namespace imc::backend {
     namespace fs = std::filesystem;
@@ -11,10 +16,71 @@ namespace imc::backend {
     // in windows it will use ShellExecute
     int open(const fs::path& file);
 
+    // Where imcommander keeps what it can always rebuild (indexes), created
+    // on first use: $XDG_CACHE_HOME or ~/.cache on linux, ~/Library/Caches
+    // on macos, %LOCALAPPDATA% on windows. Empty if there is no such place.
+    fs::path cache_directory();
+
+    // Paths that failed and why, for operations on more than one file.
+    using failures_t = std::vector<std::pair<fs::path, std::error_code>>;
+
+    namespace copy_method {
+        constexpr int None = 0;
+        // FICLONE, dst shares src's extents until either is written to
+        constexpr int Reflink = 1;
+        constexpr int CopyFileRange = 2;
+        constexpr int ReadWrite = 3;
+        // move() within one filesystem, nothing was copied
+        constexpr int Rename = 4;
+    }
+
+    // Safe to read from any thread. Copies add to it, also several at once,
+    // so one progress can cover a whole batch of files: set total (and
+    // files_total) up front and the throughput is over all of them. Only a
+    // lone copy, files_total still 0, sets total to its file's size.
+    struct copy_progress_t
+    {
+        std::atomic<uint64_t>   total{0U};
+        std::atomic<uint64_t>   copied{0U};
+        std::atomic<uint64_t>   bytes_per_second{0U};
+        std::atomic<int>        method{copy_method::None};
+        std::atomic<size_t>     files_total{0U};
+        std::atomic<size_t>     files_done{0U};
+        // steady_clock ticks of the first copy's start, pauses push it forward
+        std::atomic<int64_t>    started{0};
+        // Set from outside, the copy waits between chunks until it is cleared.
+        std::atomic_bool        paused{false};
+    };
+
+    // Blocks while progress is paused (or until stop), the pause doesn't
+    // count against the throughput. Every engine calls it between items.
+    void wait_while_paused(copy_progress_t& progress, const std::stop_token& stop);
+
+    // On linux this tries a reflink first, then copy_file_range in chunks
+    // (the kernel copies, possibly server side), then plain read/write.
+    // progress is updated after every chunk and stop is checked between them;
+    // a stopped or failed copy removes dst and a stopped one returns operation_canceled.
+    // A symlink is recreated pointing where it points, never followed.
+    // A directory is copied recursively by copy_tree(). Given failures,
+    // what fails inside it goes there and the return is about src itself,
+    // otherwise the first of them is returned.
+    std::error_code copy(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress, std::stop_token stop = {},
+                         failures_t* failures = nullptr);
     std::error_code copy(const fs::path& src, const fs::path& dst, bool can_override = true);
-    // This function operates in 2 steps, copy, then remove.
-    // return code, first is result of copy, second is result of remove.
+    // Makes dst a symlink with src's target, an existing dst is replaced
+    // only if it may override.
+    std::error_code copy_symlink(const fs::path& src, const fs::path& dst, bool can_override);
+    // Renames src when it can (renameat2 with RENAME_NOREPLACE unless it may
+    // override, progress' method says Rename). Across filesystems, or to
+    // merge a directory into an existing one, it operates in 2 steps, copy,
+    // then remove; a symlink moved that way is recreated, not its target. return code, first is result of the rename or copy,
+    // second is result of remove. A directory is only removed when all of it was copied.
+    std::pair<std::error_code, std::error_code> move(const fs::path& src, const fs::path& dst, bool can_override, copy_progress_t& progress, std::stop_token stop = {},
+                                                     failures_t* failures = nullptr);
     std::pair<std::error_code, std::error_code> move(const fs::path& src, const fs::path& dst, bool can_override = false);
     std::error_code delete_(const fs::path& src);
+    // A directory goes with everything in it, see delete_tree(). failures
+    // work like copy()'s, progress counts what was removed inside it.
+    std::error_code delete_(const fs::path& src, copy_progress_t& progress, std::stop_token stop = {}, failures_t* failures = nullptr);
     std::error_code make_directory(const fs::path& dir);
 }
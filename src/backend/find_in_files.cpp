@@ -0,0 +1,257 @@
+#include "find_in_files.h"
+
+#include "io_executor.h"
+#include "list_dir.h"
+#include "text_search.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _IMC_NIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+constexpr size_t files_per_task = 64;
+//big enough that a source file is one read, small enough to stay in cache
+constexpr size_t read_block_size = 256 * 1024;
+//same as grep and ripgrep: a NUL in the first block means binary
+constexpr size_t binary_sniff_size = 8 * 1024;
+//mostly small files, more of them in flight than cores still helps when they aren't cached
+constexpr size_t min_search_threads = 4;
+constexpr size_t max_search_threads = 16;
+
+namespace read_result {
+    constexpr int NoMatch = 0;
+    constexpr int Match = 1;
+    constexpr int Binary = 2;
+}
+
+//reads a file block by block, without stdio's buffer in the way
+class file_reader_t
+{
+public:
+    explicit file_reader_t(const fs::path& path)
+    {
+#ifdef _IMC_NIX
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY);
+#else
+        file_ = std::fopen(path.string().c_str(), "rb");
+        if (file_)
+            std::setvbuf(file_, nullptr, _IONBF, 0);
+#endif
+    }
+    ~file_reader_t()
+    {
+#ifdef _IMC_NIX
+        if (fd_ != -1)
+            close(fd_);
+#else
+        if (file_)
+            std::fclose(file_);
+#endif
+    }
+    file_reader_t(const file_reader_t&) = delete;
+    file_reader_t& operator=(const file_reader_t&) = delete;
+
+#ifdef _IMC_NIX
+    bool is_open() const { return fd_ != -1; }
+#else
+    bool is_open() const { return file_ != nullptr; }
+#endif
+
+    //0 at the end or on an error
+    size_t read(char* buffer, size_t size)
+    {
+#ifdef _IMC_NIX
+        for(;;) {
+            const ssize_t len = ::read(fd_, buffer, size);
+            if (len >= 0)
+                return static_cast<size_t>(len);
+            if (errno != EINTR)
+                return 0U;
+        }
+#else
+        return std::fread(buffer, 1, size, file_);
+#endif
+    }
+
+private:
+#ifdef _IMC_NIX
+    int         fd_{-1};
+#else
+    std::FILE*  file_{nullptr};
+#endif
+};
+
+struct tree_search_t
+{
+    text_finder_t           finder;
+    find_stats_t&           stats;
+    std::stop_token         stop;
+    std::mutex&             mutex;
+    TableRowDataVector&     results;
+    work_stealing_pool_t    pool;
+    //one read buffer per worker, the needle's length minus one is kept in front of every block
+    std::vector<std::unique_ptr<char[]>> buffers;
+
+    tree_search_t(text_finder_t finder_, find_stats_t& stats_, std::stop_token stop_,
+                  std::mutex& mutex_, TableRowDataVector& results_, size_t threads)
+    : finder(std::move(finder_)), stats(stats_), stop(std::move(stop_)), mutex(mutex_), results(results_), pool(threads)
+    {
+        for(size_t i = 0; i < pool.size(); i++)
+            buffers.push_back(std::make_unique<char[]>(read_block_size + finder.size()));
+    }
+
+    int search_file(size_t worker, const fs::path& path)
+    {
+        file_reader_t file(path);
+        if (!file.is_open())
+            return read_result::NoMatch;
+        char* buffer = buffers[worker].get();
+        const size_t keep = finder.size() - 1;
+        size_t kept = 0;
+        bool first = true;
+        for(;;) {
+            if (stop.stop_requested())
+                return read_result::NoMatch;
+            const size_t len = file.read(buffer + kept, read_block_size);
+            if (len == 0)
+                return read_result::NoMatch;
+            stats.bytes.fetch_add(len, std::memory_order_relaxed);
+            if (first && memchr(buffer, '\0', std::min(len, binary_sniff_size)) != nullptr)
+                return read_result::Binary;
+            first = false;
+            const std::string_view block(buffer, kept + len);
+            if (finder.find(block) != std::string_view::npos)
+                return read_result::Match;
+            //a match may start in the tail of this block and end in the next
+            kept = std::min(keep, block.size());
+            memmove(buffer, block.data() + block.size() - kept, kept);
+        }
+    }
+
+    void search_files(size_t worker, const std::string& prefix, const fs::path& dir, const TableRowDataVector& files, size_t first, size_t last)
+    {
+        for(size_t i = first; i < last; i++) {
+            if (stop.stop_requested())
+                return;
+            const auto& row = files[i];
+            const int result = search_file(worker, dir / (row.name + row.ext));
+            stats.files.fetch_add(1U, std::memory_order_relaxed);
+            if (result == read_result::Binary)
+                stats.binary.fetch_add(1U, std::memory_order_relaxed);
+            if (result != read_result::Match)
+                continue;
+            auto found = row;
+            found.name = prefix + row.name;
+            found.id = entry_id(found.name + found.ext);
+            std::lock_guard lock(mutex);
+            results.push_back(std::move(found));
+            stats.matched.fetch_add(1U, std::memory_order_relaxed);
+        }
+    }
+
+    //prefix is dir relative to the root, with a trailing separator
+    void search_directory(size_t worker, const std::string& prefix, const fs::path& dir)
+    {
+        if (stop.stop_requested())
+            return;
+        stats.directories.fetch_add(1U, std::memory_order_relaxed);
+        auto files = std::make_shared<TableRowDataVector>();
+        //an unreadable directory is just one that has nothing to find in it
+        list_dir(dir, [&](const table_row_data_t& row) {
+            if (row.is_symlink)
+                return;
+            if (row.is_directory) {
+                auto name = row.name;
+                pool.push(worker, [this, prefix = prefix + name + "/", path = dir / name](size_t w) {
+                    search_directory(w, prefix, path);
+                });
+            } else if (row.is_regular_file) {
+                files->push_back(row);
+            }
+        });
+
+        size_t first = 0;
+        for(; first + files_per_task < files->size(); first += files_per_task) {
+            pool.push(worker, [this, prefix, dir, files, first](size_t w) {
+                search_files(w, prefix, dir, *files, first, first + files_per_task);
+            });
+        }
+        search_files(worker, prefix, dir, *files, first, files->size());
+    }
+};
+
+}
+
+imc::backend::find_in_files_t::~find_in_files_t()
+{
+    cancel();
+}
+
+void imc::backend::find_in_files_t::start(const fs::path& root, const std::string& needle, bool ignore_case, size_t threads)
+{
+    cancel();
+    if (threads == 0)
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_search_threads, max_search_threads);
+    search_ = std::make_shared<search_t>();
+    search_->started = std::chrono::steady_clock::now();
+    search_->running.store(true, std::memory_order_release);
+    stop_ = std::stop_source();
+    io_executor().submit([search = search_, root, needle, ignore_case, threads](std::stop_token stop) {
+        run(stop, *search, root, needle, ignore_case, threads);
+    }, stop_.get_token());
+}
+
+void imc::backend::find_in_files_t::cancel()
+{
+    //a task that never started has nobody else to say it is done
+    stop_.request_stop();
+    if (search_->running)
+        search_->finish();
+}
+
+void imc::backend::find_in_files_t::search_t::finish()
+{
+    auto none = std::chrono::steady_clock::rep{0};
+    finished.compare_exchange_strong(none, std::chrono::steady_clock::now().time_since_epoch().count());
+    running.store(false, std::memory_order_release);
+}
+
+void imc::backend::find_in_files_t::run(std::stop_token stop, search_t& search, const fs::path& root, const std::string& needle, bool ignore_case, size_t threads)
+{
+    if (!needle.empty()) {
+        tree_search_t tree(text_finder_t(needle, ignore_case), search.stats, stop, search.mutex, search.results, threads);
+        tree.pool.run([&tree, &root](size_t worker) {
+            tree.search_directory(worker, std::string(), root);
+        });
+    }
+    search.finish();
+}
+
+TableRowDataVector imc::backend::find_in_files_t::take_results()
+{
+    std::lock_guard lock(search_->mutex);
+    return std::exchange(search_->results, {});
+}
+
+std::chrono::duration<double> imc::backend::find_in_files_t::elapsed() const
+{
+    const auto finished = search_->finished.load();
+    const auto end = finished != 0 ?
+        std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(finished)) :
+        std::chrono::steady_clock::now();
+    return end - search_->started;
+}
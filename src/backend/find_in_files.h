@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+
+#include "table_data.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // Counters of a search, read by the ui while it runs.
+    struct find_stats_t
+    {
+        std::atomic<uint64_t> directories{0U};
+        std::atomic<uint64_t> files{0U};
+        std::atomic<uint64_t> bytes{0U};
+        // files with a NUL in their first block, not searched any further
+        std::atomic<uint64_t> binary{0U};
+        std::atomic<uint64_t> matched{0U};
+    };
+
+    // Finds the files under a directory that contain a string. The tree is
+    // walked on a work-stealing pool (directories and batches of files are
+    // tasks), every file is read in large blocks and searched with
+    // text_finder_t until its first match. Symlinks aren't followed and
+    // binary files are skipped. Matching files come out as rows named
+    // relative to the root, so a dir_snapshot_t of them can be shown and
+    // used like a listing of the root. The search is a task on the shared
+    // io_executor_t, cancelling it doesn't wait for it.
+    class find_in_files_t
+    {
+    public:
+        find_in_files_t() = default;
+        ~find_in_files_t();
+        find_in_files_t(const find_in_files_t&) = delete;
+        find_in_files_t& operator=(const find_in_files_t&) = delete;
+
+        // Cancels a search still running first. 0 threads picks a default.
+        void start(const fs::path& root, const std::string& needle, bool ignore_case, size_t threads = 0);
+        void cancel();
+        bool running() const { return search_->running.load(std::memory_order_acquire); }
+        // Matches found since the last call.
+        TableRowDataVector take_results();
+        const find_stats_t& stats() const { return search_->stats; }
+        // How long it ran, or has been running.
+        std::chrono::duration<double> elapsed() const;
+
+    private:
+        // one search, a cancelled one keeps it until its task noticed
+        struct search_t
+        {
+            find_stats_t                            stats;
+            std::mutex                              mutex;
+            TableRowDataVector                      results;
+            std::atomic_bool                        running{false};
+            std::chrono::steady_clock::time_point   started;
+            std::atomic<std::chrono::steady_clock::rep> finished{0};
+
+            void finish();
+        };
+
+        static void run(std::stop_token stop, search_t& search, const fs::path& root, const std::string& needle, bool ignore_case, size_t threads);
+
+        std::shared_ptr<search_t>   search_{std::make_shared<search_t>()};
+        std::stop_source            stop_;
+    };
+}
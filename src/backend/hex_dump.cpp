@@ -0,0 +1,84 @@
+#include "hex_dump.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+
+namespace {
+    //a blank, "xx " per byte, one more blank in the middle and one before the ascii column
+    constexpr size_t hex_column_width = 1 + imc::backend::hex_bytes_per_row * 3 + 2;
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    //both digits of every byte value, next to each other
+    constexpr std::array<char, 512> hex_pairs = []() {
+        std::array<char, 512> table{};
+        for(size_t i = 0; i < 256; i++) {
+            table[i * 2] = hex_digits[i >> 4];
+            table[i * 2 + 1] = hex_digits[i & 0xf];
+        }
+        return table;
+    }();
+
+    //what the ascii column shows, a dot for anything that isn't printable
+    constexpr std::array<char, 256> printable = []() {
+        std::array<char, 256> table{};
+        for(size_t i = 0; i < 256; i++)
+            table[i] = (i >= 0x20 && i < 0x7f) ? static_cast<char>(i) : '.';
+        return table;
+    }();
+}
+
+int imc::backend::hex_offset_digits(uint64_t size)
+{
+    int digits = 8;
+    while (digits < 16 && (size >> (digits * 4)) != 0)
+        digits++;
+    return digits;
+}
+
+size_t imc::backend::format_hex_row(std::string_view bytes, uint64_t offset, int offset_digits, char* out)
+{
+    const size_t count = std::min(bytes.size(), hex_bytes_per_row);
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    char* pos = out;
+
+    for(int shift = (offset_digits - 1) * 4; shift >= 0; shift -= 4)
+        *pos++ = hex_digits[(offset >> shift) & 0xf];
+    *pos++ = ' ';
+
+    //every row has the same shape, short rows are padded with blanks
+    memset(pos, ' ', hex_column_width);
+    for(size_t i = 0; i < count; i++) {
+        char* cell = pos + 1 + i * 3 + (i >= hex_bytes_per_row / 2 ? 1 : 0);
+        memcpy(cell, &hex_pairs[data[i] * 2], 2);
+    }
+    pos += hex_column_width;
+
+    *pos++ = '|';
+    for(size_t i = 0; i < count; i++)
+        pos[i] = printable[data[i]];
+    pos += count;
+    *pos++ = '|';
+    return static_cast<size_t>(pos - out);
+}
+
+bool imc::backend::parse_offset(std::string_view text, uint64_t& offset)
+{
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    while (!text.empty() && text.back() == ' ')
+        text.remove_suffix(1);
+    int base = 10;
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+        base = 16;
+    } else if (text.size() > 1 && (text.back() == 'h' || text.back() == 'H')) {
+        text.remove_suffix(1);
+        base = 16;
+    }
+    if (text.empty())
+        return false;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), offset, base);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
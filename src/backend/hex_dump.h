@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace imc::backend {
+
+    constexpr size_t hex_bytes_per_row = 16;
+    // Up to 16 offset digits, two blanks, "xx " per byte, one blank in the
+    // middle and one more before "|ascii|".
+    constexpr size_t hex_row_capacity = 16 + 2 + hex_bytes_per_row * 3 + 2 + 1 + hex_bytes_per_row + 1;
+
+    // Hex digits an offset into size bytes needs, at least 8.
+    int hex_offset_digits(uint64_t size);
+
+    // One row of a hex dump of bytes (at most hex_bytes_per_row of them,
+    // a short last row is padded so the ascii column lines up):
+    //   00001230  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 0a 00 00 00  |Hello, world....|
+    // Every byte goes through two lookup tables, no branches, no printf.
+    // Writes at most hex_row_capacity chars to out, returns how many.
+    size_t format_hex_row(std::string_view bytes, uint64_t offset, int offset_digits, char* out);
+
+    // "0x1F40" or "1f40h" as hex, "8000" as decimal. False if it is neither.
+    bool parse_offset(std::string_view text, uint64_t& offset);
+}
@@ -0,0 +1,272 @@
+#include "io_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _IMC_NIX
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+#ifdef _IMC_NIX
+//linux/ioprio.h isn't always around
+constexpr int ioprio_who_process = 1;
+constexpr int ioprio_class_idle = 3;
+constexpr int ioprio_class_shift = 13;
+#endif
+
+//only the calling thread, whatever the panes do themselves goes first
+void lower_priority()
+{
+#ifdef _IMC_NIX
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 19);
+    syscall(SYS_ioprio_set, ioprio_who_process, 0, ioprio_class_idle << ioprio_class_shift);
+#endif
+}
+
+}
+
+imc::backend::io_executor_t::io_executor_t(size_t threads)
+{
+#ifdef _IMC_NIX
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    for(size_t i = 0; i < std::max<size_t>(threads, 1U); i++)
+        workers_.emplace_back([this](std::stop_token stop) { work(stop, queue_); });
+    idle_worker_ = std::jthread([this](std::stop_token stop) {
+        lower_priority();
+        work(stop, idle_queue_);
+    });
+    dispatcher_ = std::jthread([this](std::stop_token stop) { dispatch(stop); });
+}
+
+imc::backend::io_executor_t::~io_executor_t()
+{
+    //tasks still running were cancelled by their owners, they only have to notice
+    dispatcher_.request_stop();
+    wake_dispatcher();
+    dispatcher_.join();
+    idle_worker_.request_stop();
+    idle_worker_.join();
+    for(auto& worker : blocking_workers_)
+        worker.request_stop();
+    blocking_workers_.clear();
+    for(auto& worker : workers_)
+        worker.request_stop();
+    workers_.clear();
+#ifdef _IMC_NIX
+    if (wake_fd_ != -1)
+        close(wake_fd_);
+#endif
+}
+
+bool imc::backend::io_executor_t::later(const timed_job_t& lhs, const timed_job_t& rhs)
+{
+    return lhs.when != rhs.when ? lhs.when > rhs.when : lhs.sequence > rhs.sequence;
+}
+
+void imc::backend::io_executor_t::submit(FNTask task, std::stop_token stop)
+{
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back({ std::move(task), std::move(stop) });
+    }
+    //the idle worker waits on the same condition
+    work_.notify_all();
+}
+
+void imc::backend::io_executor_t::submit_idle(FNTask task, std::stop_token stop)
+{
+    {
+        std::lock_guard lock(mutex_);
+        idle_queue_.push_back({ std::move(task), std::move(stop) });
+    }
+    work_.notify_all();
+}
+
+void imc::backend::io_executor_t::submit_blocking(FNTask task, std::stop_token stop)
+{
+    {
+        std::lock_guard lock(mutex_);
+        queue_blocking({ std::move(task), std::move(stop) });
+    }
+    work_.notify_all();
+}
+
+void imc::backend::io_executor_t::queue_blocking(job_t job)
+{
+    blocking_queue_.push_back(std::move(job));
+    //the threads that are free take what is queued, a task nobody is free for gets a thread of its own
+    if (blocking_queue_.size() > blocking_idle_ && blocking_workers_.size() < max_blocking_threads)
+        blocking_workers_.emplace_back([this](std::stop_token stop) { work(stop, blocking_queue_, &blocking_idle_); });
+}
+
+void imc::backend::io_executor_t::submit_blocking_at(clock::time_point when, FNTask task, std::stop_token stop)
+{
+    {
+        std::lock_guard lock(mutex_);
+        timed_.push_back({ when, sequence_++, { std::move(task), std::move(stop) }, true });
+        std::push_heap(timed_.begin(), timed_.end(), &io_executor_t::later);
+    }
+    wake_dispatcher();
+}
+
+void imc::backend::io_executor_t::submit_at(clock::time_point when, FNTask task, std::stop_token stop)
+{
+    {
+        std::lock_guard lock(mutex_);
+        timed_.push_back({ when, sequence_++, { std::move(task), std::move(stop) } });
+        std::push_heap(timed_.begin(), timed_.end(), &io_executor_t::later);
+    }
+    wake_dispatcher();
+}
+
+void imc::backend::io_executor_t::watch_fd(int fd, std::function<void()> on_ready)
+{
+    {
+        std::lock_guard lock(mutex_);
+        fds_.push_back({ fd, std::move(on_ready) });
+    }
+    wake_dispatcher();
+}
+
+void imc::backend::io_executor_t::unwatch_fd(int fd)
+{
+    {
+        std::lock_guard lock(mutex_);
+        std::erase_if(fds_, [fd](const fd_watch_t& watch) { return watch.fd == fd; });
+    }
+    wake_dispatcher();
+}
+
+void imc::backend::io_executor_t::rearm(int fd)
+{
+    {
+        std::lock_guard lock(mutex_);
+        for(auto& watch : fds_) {
+            if (watch.fd == fd)
+                watch.armed = true;
+        }
+    }
+    wake_dispatcher();
+}
+
+void imc::backend::io_executor_t::wake_dispatcher()
+{
+#ifdef _IMC_NIX
+    if (wake_fd_ != -1) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
+        return;
+    }
+#endif
+    {
+        std::lock_guard lock(mutex_);
+        sequence_++;
+    }
+    dispatch_wake_.notify_all();
+}
+
+void imc::backend::io_executor_t::work(std::stop_token stop, std::deque<job_t>& queue, size_t* idle)
+{
+    std::unique_lock lock(mutex_);
+    for(;;) {
+        if (idle)
+            ++*idle;
+        const bool woken = work_.wait(lock, stop, [&queue] { return !queue.empty(); });
+        if (idle)
+            --*idle;
+        if (!woken)
+            return;
+        auto job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        if (!job.stop.stop_requested())
+            job.task(job.stop);
+        //whatever the task holds goes now, not with the next one
+        job = {};
+        lock.lock();
+    }
+}
+
+void imc::backend::io_executor_t::dispatch(std::stop_token stop)
+{
+#ifdef _IMC_NIX
+    std::vector<pollfd> polled;
+#endif
+    std::unique_lock lock(mutex_);
+    while (!stop.stop_requested()) {
+        const auto now = clock::now();
+        bool queued = false;
+        while (!timed_.empty() && timed_.front().when <= now) {
+            std::pop_heap(timed_.begin(), timed_.end(), &io_executor_t::later);
+            //one cancelled while it waited is dropped here already
+            if (auto& due = timed_.back(); !due.job.stop.stop_requested()) {
+                if (due.blocking)
+                    queue_blocking(std::move(due.job));
+                else
+                    queue_.push_back(std::move(due.job));
+            }
+            timed_.pop_back();
+            queued = true;
+        }
+        if (queued)
+            work_.notify_all();
+
+#ifdef _IMC_NIX
+        int timeout = -1;
+        if (!timed_.empty()) {
+            const auto wait = std::chrono::ceil<std::chrono::milliseconds>(timed_.front().when - now);
+            timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(wait.count(), 0));
+        }
+        polled.clear();
+        polled.push_back({ wake_fd_, POLLIN, 0 });
+        for(const auto& watch : fds_) {
+            if (watch.armed)
+                polled.push_back({ watch.fd, POLLIN, 0 });
+        }
+        lock.unlock();
+        const int ready = poll(polled.data(), polled.size(), timeout);
+        lock.lock();
+        if (ready <= 0)
+            continue;
+        if (polled[0].revents) {
+            uint64_t count;
+            [[maybe_unused]] auto got = read(wake_fd_, &count, sizeof(count));
+        }
+        for(size_t i = 1; i < polled.size(); i++) {
+            if (polled[i].revents == 0)
+                continue;
+            const auto it = std::find_if(fds_.begin(), fds_.end(), [fd = polled[i].fd](const fd_watch_t& watch) { return watch.fd == fd; });
+            if (it == fds_.end() || !it->armed)
+                continue;
+            it->armed = false;
+            queue_.push_back({ [this, fd = it->fd, on_ready = it->on_ready](std::stop_token) {
+                on_ready();
+                rearm(fd);
+            }, {} });
+            work_.notify_all();
+        }
+#else
+        const auto seen = sequence_;
+        if (timed_.empty())
+            dispatch_wake_.wait(lock, stop, [&] { return sequence_ != seen; });
+        else
+            dispatch_wake_.wait_until(lock, stop, timed_.front().when, [&] { return sequence_ != seen; });
+#endif
+    }
+}
+
+io_executor_t& imc::backend::io_executor()
+{
+    static io_executor_t executor;
+    return executor;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace imc::backend {
+
+    // The threads the panes' background i/o runs on: watching and listing
+    // directories, searches, size calculations, prefetches. Nothing ever
+    // waits for a task: a task is cancelled through the stop_token it was
+    // submitted with and is expected to notice soon, one cancelled before
+    // it started is dropped. Idle tasks (prefetches) have a thread of their
+    // own at idle cpu and io priority, so they never hold up the rest.
+    // Blocking tasks (passes over a directory that may sit on a dead mount)
+    // run on a lane of their own that gets another thread whenever none of
+    // its threads is free, so a stuck one never takes a shared thread.
+    // A dispatcher thread moves timed tasks to the queue when they are due
+    // and, on linux, submits the handler of a watched fd when it is readable.
+    class io_executor_t
+    {
+    public:
+        using FNTask = std::function<void(std::stop_token)>;
+        using clock = std::chrono::steady_clock;
+
+        static constexpr size_t default_threads = 4;
+        // the blocking lane stops growing here, then its tasks wait
+        static constexpr size_t max_blocking_threads = 64;
+
+        explicit io_executor_t(size_t threads = default_threads);
+        ~io_executor_t();
+        io_executor_t(const io_executor_t&) = delete;
+        io_executor_t& operator=(const io_executor_t&) = delete;
+
+        void submit(FNTask task, std::stop_token stop = {});
+        void submit_at(clock::time_point when, FNTask task, std::stop_token stop = {});
+        void submit_idle(FNTask task, std::stop_token stop = {});
+        void submit_blocking(FNTask task, std::stop_token stop = {});
+        void submit_blocking_at(clock::time_point when, FNTask task, std::stop_token stop = {});
+        // Submits on_ready whenever fd can be read, fd isn't polled again
+        // until it returned. Linux only, elsewhere nothing is ever ready.
+        void watch_fd(int fd, std::function<void()> on_ready);
+        void unwatch_fd(int fd);
+
+        size_t size() const { return workers_.size(); }
+
+    private:
+        struct job_t
+        {
+            FNTask          task;
+            std::stop_token stop;
+        };
+
+        struct timed_job_t
+        {
+            clock::time_point   when;
+            uint64_t            sequence;
+            job_t               job;
+            bool                blocking{false};
+        };
+
+        struct fd_watch_t
+        {
+            int                     fd;
+            std::function<void()>   on_ready;
+            bool                    armed{true};
+        };
+
+        // heap order of timed_, the earliest on top
+        static bool later(const timed_job_t& lhs, const timed_job_t& rhs);
+        // idle, if given, counts the threads of the queue waiting for a task
+        void work(std::stop_token stop, std::deque<job_t>& queue, size_t* idle = nullptr);
+        // with mutex_ held
+        void queue_blocking(job_t job);
+        void dispatch(std::stop_token stop);
+        void wake_dispatcher();
+        void rearm(int fd);
+
+        std::mutex                      mutex_;
+        std::condition_variable_any     work_;
+        std::deque<job_t>               queue_;
+        std::deque<job_t>               idle_queue_;
+        std::deque<job_t>               blocking_queue_;
+        size_t                          blocking_idle_{0U};
+        // a heap, the earliest first
+        std::vector<timed_job_t>        timed_;
+        uint64_t                        sequence_{0U};
+        std::vector<fd_watch_t>         fds_;
+        // wakes the dispatcher: an eventfd it polls on linux, a condition elsewhere
+        int                             wake_fd_{-1};
+        std::condition_variable_any     dispatch_wake_;
+
+        std::vector<std::jthread>       workers_;
+        std::jthread                    idle_worker_;
+        // only grows, a thread that is done waits for the next blocking task
+        std::vector<std::jthread>       blocking_workers_;
+        std::jthread                    dispatcher_;
+    };
+
+    // The one every pane uses.
+    io_executor_t& io_executor();
+}
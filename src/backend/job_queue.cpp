@@ -0,0 +1,229 @@
+#include "job_queue.h"
+
+#include <algorithm>
+
+#include <fmt/format.h>
+
+#ifdef _IMC_NIX
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+#ifdef _IMC_NIX
+//glibc has no wrapper for ioprio_set, these come from linux/ioprio.h
+constexpr int ioprio_who_process = 1;
+constexpr int ioprio_class_shift = 13;
+constexpr int ioprio_class_be = 2;
+constexpr int ioprio_lowest_level = 7;
+#endif
+
+//so a big copy doesn't make browsing the same disk crawl
+void lower_io_priority()
+{
+#ifdef _IMC_NIX
+    //who = 0 is the calling thread
+    syscall(SYS_ioprio_set, ioprio_who_process, 0, (ioprio_class_be << ioprio_class_shift) | ioprio_lowest_level);
+#endif
+}
+
+}
+
+double imc::backend::job_t::eta() const
+{
+    const uint64_t rate = progress.bytes_per_second;
+    const uint64_t total = progress.total;
+    const uint64_t copied = progress.copied;
+    if (rate == 0 || total < copied)
+        return -1.0;
+    return static_cast<double>(total - copied) / static_cast<double>(rate);
+}
+
+uint64_t imc::backend::device_of(const fs::path& path)
+{
+#ifdef _IMC_NIX
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 || stat(path.parent_path().c_str(), &st) == 0)
+        return st.st_dev;
+#endif
+    //unknown, everything counts as one device
+    return 0U;
+}
+
+JobPtr imc::backend::make_copy_job(const fs::path& src, const fs::path& dst, bool can_override)
+{
+    auto job = std::make_shared<job_t>();
+    job->description = fmt::format("Copy {} to {}", src.generic_string(), dst.generic_string());
+    job->devices = { device_of(src), device_of(dst) };
+    job->run = [src, dst, can_override](job_t& j) {
+        const auto ec = copy(src, dst, can_override, j.progress, j.stop.get_token(), &j.failures);
+        return ec || j.failures.empty() ? ec : j.failures.front().second;
+    };
+    return job;
+}
+
+JobPtr imc::backend::make_move_job(const fs::path& src, const fs::path& dst, bool can_override)
+{
+    auto job = std::make_shared<job_t>();
+    job->description = fmt::format("Move {} to {}", src.generic_string(), dst.generic_string());
+    job->devices = { device_of(src), device_of(dst) };
+    job->run = [src, dst, can_override](job_t& j) {
+        const auto ec = move(src, dst, can_override, j.progress, j.stop.get_token(), &j.failures);
+        if (ec.first || ec.second)
+            return ec.first ? ec.first : ec.second;
+        return j.failures.empty() ? std::error_code() : j.failures.front().second;
+    };
+    return job;
+}
+
+JobPtr imc::backend::make_delete_job(const fs::path& src)
+{
+    auto job = std::make_shared<job_t>();
+    job->description = fmt::format("Delete {}", src.generic_string());
+    job->devices = { device_of(src) };
+    job->run = [src](job_t& j) {
+        const auto ec = delete_(src, j.progress, j.stop.get_token(), &j.failures);
+        return ec || j.failures.empty() ? ec : j.failures.front().second;
+    };
+    return job;
+}
+
+imc::backend::job_queue_t::job_queue_t(size_t workers, size_t per_device)
+: per_device_(std::max<size_t>(per_device, 1U))
+{
+    for(size_t i = 0; i < workers; i++)
+        workers_.emplace_back([this](std::stop_token stop) { run(stop); });
+}
+
+imc::backend::job_queue_t::~job_queue_t()
+{
+    {
+        std::lock_guard lock(mutex_);
+        for(auto& job : jobs_) {
+            job->stop.request_stop();
+            job->progress.paused = false;
+        }
+    }
+    for(auto& worker : workers_)
+        worker.request_stop();
+    //the jthreads join on their way out
+}
+
+JobPtr imc::backend::job_queue_t::push(JobPtr job)
+{
+    {
+        std::lock_guard lock(mutex_);
+        job->id = next_id_++;
+        job->state = job_state::Queued;
+        //the same device twice would make the job wait for itself
+        std::sort(job->devices.begin(), job->devices.end());
+        job->devices.erase(std::unique(job->devices.begin(), job->devices.end()), job->devices.end());
+        jobs_.push_back(job);
+    }
+    wake_.notify_one();
+    return job;
+}
+
+void imc::backend::job_queue_t::pause(const JobPtr& job)
+{
+    std::lock_guard lock(mutex_);
+    if (job->finished())
+        return;
+    job->progress.paused = true;
+    job->state = job_state::Paused;
+}
+
+void imc::backend::job_queue_t::resume(const JobPtr& job)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (job->state != job_state::Paused)
+            return;
+        job->progress.paused = false;
+        //a job paused before it got a worker goes back in line
+        job->state = job->started ? job_state::Running : job_state::Queued;
+    }
+    wake_.notify_all();
+}
+
+void imc::backend::job_queue_t::cancel(const JobPtr& job)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (job->finished())
+            return;
+        job->stop.request_stop();
+        job->progress.paused = false;
+        if (!job->started) {
+            job->ec = std::make_error_code(std::errc::operation_canceled);
+            job->state = job_state::Canceled;
+        }
+    }
+    wake_.notify_all();
+}
+
+void imc::backend::job_queue_t::clear_finished()
+{
+    std::lock_guard lock(mutex_);
+    std::erase_if(jobs_, [](const JobPtr& job) { return job->finished(); });
+}
+
+std::vector<JobPtr> imc::backend::job_queue_t::jobs() const
+{
+    std::lock_guard lock(mutex_);
+    return jobs_;
+}
+
+//called with mutex_ held
+JobPtr imc::backend::job_queue_t::next_runnable()
+{
+    for(auto& job : jobs_) {
+        if (job->state != job_state::Queued)
+            continue;
+        const bool devices_free = std::all_of(job->devices.begin(), job->devices.end(), [this](uint64_t device) {
+            auto it = busy_devices_.find(device);
+            return it == busy_devices_.end() || it->second < per_device_;
+        });
+        if (devices_free)
+            return job;
+    }
+    return nullptr;
+}
+
+void imc::backend::job_queue_t::run(std::stop_token stop)
+{
+    lower_io_priority();
+    for(;;) {
+        JobPtr job;
+        {
+            std::unique_lock lock(mutex_);
+            if (!wake_.wait(lock, stop, [&]() { return (job = next_runnable()) != nullptr; }))
+                return;
+            job->state = job_state::Running;
+            job->started = true;
+            for(const auto device : job->devices)
+                busy_devices_[device]++;
+        }
+
+        const auto ec = job->run(*job);
+
+        {
+            std::lock_guard lock(mutex_);
+            for(const auto device : job->devices) {
+                if (--busy_devices_[device] == 0)
+                    busy_devices_.erase(device);
+            }
+            job->ec = ec;
+            if (ec == std::errc::operation_canceled)
+                job->state = job_state::Canceled;
+            else
+                job->state = ec ? job_state::Failed : job_state::Done;
+        }
+        //a device just freed up, maybe for a job another worker skipped
+        wake_.notify_all();
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file_operations.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    namespace job_state {
+        constexpr int Queued = 0;
+        constexpr int Running = 1;
+        constexpr int Paused = 2;
+        constexpr int Done = 3;
+        constexpr int Failed = 4;
+        constexpr int Canceled = 5;
+    }
+
+    // One file operation, shared by the queue, its worker and whoever shows it.
+    struct job_t
+    {
+        using FNRun = std::function<std::error_code(job_t&)>;
+
+        size_t                  id{0U};
+        std::string             description;
+        // st_dev of everything the job reads or writes, for the per device limit
+        std::vector<uint64_t>   devices;
+        FNRun                   run;
+
+        copy_progress_t         progress;
+        std::atomic<int>        state{job_state::Queued};
+        // A worker picked it up, guarded by the queue.
+        bool                    started{false};
+        std::stop_source        stop;
+        // Only valid once the job is Done, Failed or Canceled.
+        std::error_code         ec;
+        // Everything that went wrong in a batch or a directory, same rules as ec.
+        failures_t              failures;
+
+        bool finished() const { return state >= job_state::Done; }
+        // Seconds left at the current throughput, negative when unknown.
+        double eta() const;
+    };
+
+    using JobPtr = std::shared_ptr<job_t>;
+
+    // The device path lives on, or its parent's when it doesn't exist (yet).
+    uint64_t device_of(const fs::path& path);
+
+    JobPtr make_copy_job(const fs::path& src, const fs::path& dst, bool can_override);
+    JobPtr make_move_job(const fs::path& src, const fs::path& dst, bool can_override);
+    JobPtr make_delete_job(const fs::path& src);
+
+    // Runs jobs on a few worker threads in the order they were pushed,
+    // skipping over jobs whose devices are already busy with per_device
+    // others. The workers do their I/O at the lowest best-effort priority.
+    class job_queue_t
+    {
+    public:
+        explicit job_queue_t(size_t workers = 4, size_t per_device = 1);
+        ~job_queue_t();
+
+        JobPtr push(JobPtr job);
+        // A running job stops between chunks, a queued one isn't started.
+        void pause(const JobPtr& job);
+        void resume(const JobPtr& job);
+        void cancel(const JobPtr& job);
+        void clear_finished();
+        // Every job not cleared yet, in the order they were pushed.
+        std::vector<JobPtr> jobs() const;
+
+    private:
+        void run(std::stop_token stop);
+        JobPtr next_runnable();
+
+        mutable std::mutex                      mutex_;
+        std::condition_variable_any             wake_;
+        std::vector<JobPtr>                     jobs_;
+        std::unordered_map<uint64_t, size_t>    busy_devices_;
+        size_t                                  per_device_;
+        size_t                                  next_id_{1U};
+        std::vector<std::jthread>               workers_;
+    };
+}
@@ -0,0 +1,169 @@
+#include "line_index.h"
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr size_t lines_per_checkpoint = 64;
+    constexpr size_t checkpoints_per_block = 4096;
+    //how far a single memchr may run before the stop token is looked at again
+    constexpr size_t scan_chunk_size = 16 * 1024 * 1024;
+
+    //the line starting at pos, without \n or \r\n
+    std::string_view line_at(std::string_view data, size_t pos, size_t& next)
+    {
+        const char* begin = data.data() + pos;
+        const char* end = data.data() + data.size();
+        const auto* nl = static_cast<const char*>(memchr(begin, '\n', static_cast<size_t>(end - begin)));
+        const char* line_end = nl ? nl : end;
+        next = nl ? static_cast<size_t>(nl + 1 - data.data()) : data.size();
+        if (line_end > begin && line_end[-1] == '\r')
+            --line_end;
+        return { begin, static_cast<size_t>(line_end - begin) };
+    }
+}
+
+imc::backend::line_index_t::line_index_t(std::string_view data)
+: data_(data)
+{
+    start();
+}
+
+imc::backend::line_index_t::~line_index_t()
+{
+    //before the blocks go
+    stop();
+}
+
+void imc::backend::line_index_t::start()
+{
+    //there can't be more lines than bytes + 1
+    const size_t max_checkpoints = (data_.size() + 1) / lines_per_checkpoint + 1;
+    blocks_.resize(std::max(blocks_.size(), max_checkpoints / checkpoints_per_block + 1));
+    done_.store(false, std::memory_order_release);
+    worker_ = std::jthread([this](std::stop_token stop) { build(stop); });
+}
+
+void imc::backend::line_index_t::stop()
+{
+    worker_ = {};
+}
+
+void imc::backend::line_index_t::extend(std::string_view data)
+{
+    //nobody else reads while the worker is gone, the table may grow
+    stop();
+    data_ = data;
+    start();
+}
+
+uint64_t imc::backend::line_index_t::checkpoint(size_t index) const
+{
+    if (index == 0)
+        return 0U;
+    return blocks_[index / checkpoints_per_block][index % checkpoints_per_block];
+}
+
+void imc::backend::line_index_t::build(std::stop_token stop)
+{
+    const char* begin = data_.data();
+    const char* end = begin + data_.size();
+    //a previous run may have left off in the middle, its breaks are all published
+    size_t breaks = breaks_.load(std::memory_order_relaxed);
+    const char* pos = begin + scanned_;
+    bool ends_with_break = true;
+    //a truncated file ends the scan where it got to, the breaks found so far still count
+    const bool read = guarded_read([&]() {
+        while (pos < end) {
+            if (stop.stop_requested())
+                return;
+            const size_t span = std::min(static_cast<size_t>(end - pos), scan_chunk_size);
+            const auto* nl = static_cast<const char*>(memchr(pos, '\n', span));
+            if (nl == nullptr) {
+                //a very long line, keep going after checking the token
+                pos += span;
+                continue;
+            }
+            pos = nl + 1;
+            if (++breaks % lines_per_checkpoint != 0)
+                continue;
+            const size_t index = breaks / lines_per_checkpoint;
+            auto& block = blocks_[index / checkpoints_per_block];
+            if (!block)
+                block = std::make_unique<uint64_t[]>(checkpoints_per_block);
+            block[index % checkpoints_per_block] = static_cast<uint64_t>(pos - begin);
+            //the checkpoint is written before anyone can see the lines it covers
+            breaks_.store(breaks, std::memory_order_release);
+        }
+        ends_with_break = end == begin || end[-1] == '\n';
+    });
+    scanned_ = static_cast<size_t>(pos - begin);
+    breaks_.store(breaks, std::memory_order_release);
+    if (!read) {
+        truncated_.store(true, std::memory_order_release);
+        return;
+    }
+    if (pos == end) {
+        ends_with_break_ = ends_with_break;
+        done_.store(true, std::memory_order_release);
+    }
+}
+
+size_t imc::backend::line_index_t::lines() const
+{
+    const bool done = done_.load(std::memory_order_acquire);
+    const size_t breaks = breaks_.load(std::memory_order_acquire);
+    if (done && !ends_with_break_)
+        return breaks + 1;
+    return breaks;
+}
+
+void imc::backend::line_index_t::visit(size_t first, size_t last, const FNLine& fn) const
+{
+    last = std::min(last, lines());
+    if (first >= last)
+        return;
+    size_t pos = checkpoint(first / lines_per_checkpoint);
+    size_t next = pos;
+    for(size_t skip = first % lines_per_checkpoint; skip > 0; skip--) {
+        line_at(data_, pos, next);
+        pos = next;
+    }
+    for(size_t line = first; line < last; line++) {
+        if (!fn(line, line_at(data_, pos, next)))
+            return;
+        pos = next;
+    }
+}
+
+size_t imc::backend::line_index_t::line_of(uint64_t offset) const
+{
+    const bool done = done_.load(std::memory_order_acquire);
+    const size_t breaks = breaks_.load(std::memory_order_acquire);
+    if (offset >= data_.size())
+        return std::string_view::npos;
+    //the last checkpoint at or before offset
+    size_t low = 0;
+    size_t high = breaks / lines_per_checkpoint;
+    while (low < high) {
+        const size_t mid = (low + high + 1) / 2;
+        if (checkpoint(mid) <= offset)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    size_t line = low * lines_per_checkpoint;
+    const char* pos = data_.data() + checkpoint(low);
+    const char* target = data_.data() + offset;
+    //never further than the next checkpoint, past it nothing is published
+    for(size_t skipped = 0; skipped < lines_per_checkpoint; skipped++) {
+        const auto* nl = static_cast<const char*>(memchr(pos, '\n', static_cast<size_t>(target - pos)));
+        if (nl == nullptr)
+            return (line < breaks || done) ? line : std::string_view::npos;
+        pos = nl + 1;
+        line++;
+    }
+    return std::string_view::npos;
+}
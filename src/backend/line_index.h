@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace imc::backend {
+
+    // Where the lines of a (mapped) text are, found on a background thread
+    // so the text can be shown before all of it was read. Only every 64th
+    // line start is kept, a line is found by skipping forward from the one
+    // before it: a few MB of index for hundreds of millions of lines. The
+    // worker reads under guarded_read(), a truncated file stops it; callers
+    // of visit() and line_of() guard those themselves.
+    class line_index_t
+    {
+    public:
+        // Return false to stop visiting.
+        using FNLine = std::function<bool(size_t line, std::string_view text)>;
+
+        // Starts indexing right away, data has to outlive the index.
+        explicit line_index_t(std::string_view data);
+        ~line_index_t();
+        line_index_t(const line_index_t&) = delete;
+        line_index_t& operator=(const line_index_t&) = delete;
+
+        // Lines found so far. Once done, a last line without a line break counts too.
+        size_t lines() const;
+        bool done() const { return done_.load(std::memory_order_acquire); }
+        // The text shrank under the worker (a truncated file), it gave up.
+        bool truncated() const { return truncated_.load(std::memory_order_acquire); }
+        // Lines [first, last) that are found already, in order, without their line break.
+        void visit(size_t first, size_t last, const FNLine& fn) const;
+        // The line the byte at offset is on, npos while indexing hasn't got there.
+        size_t line_of(uint64_t offset) const;
+        // Stops indexing, needed before the data moves (a mapping that grows).
+        void stop();
+        // data is the same text with more behind it (possibly somewhere
+        // else in memory): only the new part gets indexed.
+        void extend(std::string_view data);
+
+    private:
+        void start();
+        void build(std::stop_token stop);
+        uint64_t checkpoint(size_t index) const;
+
+        std::string_view                        data_;
+        // offsets of lines 0, 64, 128... in blocks that never move, the
+        // table of them is sized for the worst case up front so reading
+        // needs no lock while it grows
+        std::vector<std::unique_ptr<uint64_t[]>> blocks_;
+        // line breaks found, published every checkpoint
+        std::atomic<size_t>                     breaks_{0U};
+        // how far the worker got, only touched while it runs or after it was joined
+        size_t                                  scanned_{0U};
+        // whether the text ends in a line break, set before done_
+        bool                                    ends_with_break_{true};
+        std::atomic_bool                        done_{false};
+        std::atomic_bool                        truncated_{false};
+        std::jthread                            worker_;
+    };
+}
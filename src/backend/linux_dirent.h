@@ -0,0 +1,19 @@
+#pragma once
+
+#ifdef _IMC_NIX
+#include <cstdint>
+
+namespace imc::backend {
+    // One record of what getdents64 fills its buffer with, glibc doesn't
+    // always expose the struct. d_name is NUL terminated and runs on past
+    // its declared size, up to d_reclen.
+    struct linux_dirent64
+    {
+        uint64_t        d_ino;
+        int64_t         d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+        char            d_name[1];
+    };
+}
+#endif
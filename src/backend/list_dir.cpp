@@ -0,0 +1,205 @@
+#include "list_dir.h"
+#include "linux_dirent.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#ifdef _IMC_NIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#endif
+
+namespace {
+
+using namespace imc::backend;
+
+//std::filesystem's stem/extension split, without building a path.
+void split_file_name(std::string_view file_name, bool is_directory, table_row_data_t& row)
+{
+    auto dot = file_name.rfind('.');
+    if (is_directory || dot == std::string_view::npos || dot == 0 || file_name == "..") {
+        row.name.assign(file_name);
+        row.ext.clear();
+    } else {
+        row.name.assign(file_name.substr(0, dot));
+        row.ext.assign(file_name.substr(dot));
+    }
+}
+
+#ifdef _IMC_NIX
+constexpr size_t dirent_buffer_size = 256 * 1024;
+
+file_time to_file_time(const timespec& ts)
+{
+    using namespace std::chrono;
+    return file_clock::from_sys(sys_time<nanoseconds>(seconds(ts.tv_sec) + nanoseconds(ts.tv_nsec)));
+}
+
+void set_type(table_row_data_t& row, mode_t mode)
+{
+    row.is_regular_file = S_ISREG(mode);
+    row.is_directory = S_ISDIR(mode);
+    row.is_block_file = S_ISBLK(mode);
+    row.is_character_file = S_ISCHR(mode);
+    row.is_fifo = S_ISFIFO(mode);
+    row.is_socket = S_ISSOCK(mode);
+    //std::filesystem::is_other: anything that exists and isn't a file, directory or symlink
+    row.is_other = !(row.is_regular_file || row.is_directory || S_ISLNK(mode));
+}
+
+//Size, time and permissions need a stat of every entry whatever d_type says.
+//What d_type saves is the lstat of a symlink it already reports: only the target
+//gets stat'ed, a linux symlink's own permissions are always 0777. When d_type is
+//DT_UNKNOWN (the filesystem doesn't fill it in) or the link dangles, lstat tells us.
+bool fill_row(int dirfd, const char* stat_name, std::string_view file_name, unsigned char d_type, table_row_data_t& row)
+{
+    struct stat st;
+    if (d_type == DT_LNK && fstatat(dirfd, stat_name, &st, 0) == 0) {
+        row.is_symlink = true;
+        row.permissions = static_cast<file_perm>(0777);
+    } else {
+        if (fstatat(dirfd, stat_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+            return false;
+        row.is_symlink = S_ISLNK(st.st_mode);
+        //symlinks keep their own permissions but show the type, size and time of their target
+        row.permissions = static_cast<file_perm>(st.st_mode & 07777);
+        if (row.is_symlink) {
+            struct stat target;
+            if (fstatat(dirfd, stat_name, &target, 0) == 0) {
+                st = target;
+            } else {
+                //dangling link
+                set_type(row, st.st_mode);
+                row.size = 0U;
+                row.modified = file_time{};
+                split_file_name(file_name, false, row);
+                return true;
+            }
+        }
+    }
+
+    set_type(row, st.st_mode);
+    row.size = S_ISREG(st.st_mode) ? static_cast<size_t>(st.st_size) : 0U;
+    row.modified = to_file_time(st.st_mtim);
+    split_file_name(file_name, row.is_directory, row);
+    return true;
+}
+#else
+void entry_to_table_row(const fs::directory_entry& entry, table_row_data_t& row_data)
+{
+    std::error_code ec;
+    row_data.is_regular_file = entry.is_regular_file(ec);
+    row_data.is_directory = entry.is_directory(ec);
+    row_data.is_block_file = entry.is_block_file(ec);
+    row_data.is_character_file = entry.is_character_file(ec);
+    row_data.is_fifo = entry.is_fifo(ec);
+    row_data.is_other = entry.is_other(ec);
+    row_data.is_socket = entry.is_socket(ec);
+    row_data.is_symlink = entry.is_symlink(ec);
+    row_data.size = 0U;
+    if (!row_data.is_directory) {
+        if (size_t try_size = entry.file_size(ec); !ec) {
+            row_data.size = try_size;
+        }
+    }
+    row_data.modified = file_time{};
+    if (auto try_last_write_time = entry.last_write_time(ec); !ec) {
+        row_data.modified = try_last_write_time;
+    }
+    if (row_data.is_symlink) {
+        row_data.permissions = entry.symlink_status(ec).permissions();
+    } else {
+        row_data.permissions = entry.status(ec).permissions();
+    }
+    split_file_name(entry.path().filename().generic_string(), row_data.is_directory, row_data);
+}
+#endif
+
+}
+
+std::error_code imc::backend::list_dir(const fs::path& dir, const FNEntry& onEntry, std::stop_token stop)
+{
+#ifdef _IMC_NIX
+    int dirfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+        return std::error_code(errno, std::generic_category());
+
+    auto buffer = std::make_unique<char[]>(dirent_buffer_size);
+    table_row_data_t row;
+    std::error_code ec;
+    for(;;) {
+        const long len = syscall(SYS_getdents64, dirfd, buffer.get(), dirent_buffer_size);
+        if (len < 0) {
+            ec = std::error_code(errno, std::generic_category());
+            break;
+        }
+        if (len == 0)
+            break;
+        for(long pos = 0; pos < len;) {
+            if (stop.stop_requested()) {
+                close(dirfd);
+                return std::make_error_code(std::errc::operation_canceled);
+            }
+            const auto* entry = reinterpret_cast<const linux_dirent64*>(buffer.get() + pos);
+            pos += entry->d_reclen;
+            const std::string_view file_name(entry->d_name);
+            if (file_name == "." || file_name == "..")
+                continue;
+            //it may be gone already, then it simply isn't listed
+            if (!fill_row(dirfd, entry->d_name, file_name, entry->d_type, row))
+                continue;
+            row.id = entry_id(file_name);
+            onEntry(row);
+        }
+    }
+    close(dirfd);
+    return ec;
+#else
+    std::error_code ec;
+    auto it = fs::directory_iterator(dir, ec);
+    if (ec)
+        return ec;
+    table_row_data_t row;
+    for(const auto& entry : it) {
+        if (stop.stop_requested())
+            return std::make_error_code(std::errc::operation_canceled);
+        entry_to_table_row(entry, row);
+        row.id = entry_id(entry.path().filename().generic_string());
+        onEntry(row);
+    }
+    return ec;
+#endif
+}
+
+bool imc::backend::stat_entry(const fs::path& dir, std::string_view name, table_row_data_t& row)
+{
+    std::error_code ec;
+    return stat_entry(dir, name, row, ec);
+}
+
+bool imc::backend::stat_entry(const fs::path& dir, std::string_view name, table_row_data_t& row, std::error_code& ec)
+{
+    ec.clear();
+#ifdef _IMC_NIX
+    const auto path = dir / name;
+    const bool found = fill_row(AT_FDCWD, path.c_str(), name, DT_UNKNOWN, row);
+    if (!found)
+        ec = std::error_code(errno, std::generic_category());
+#else
+    fs::directory_entry entry(dir / name, ec);
+    const bool found = !ec && fs::exists(entry.symlink_status(ec));
+    if (found)
+        entry_to_table_row(entry, row);
+    else if (!ec)
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+#endif
+    if (found)
+        row.id = entry_id(name);
+    return found;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+
+#include "table_data.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // The row is reused between calls, copy what you want to keep.
+    using FNEntry = std::function<void(const table_row_data_t&)>;
+
+    // Calls onEntry for every entry of dir except . and ..
+    // On linux the directory is read in large getdents64 batches and every
+    // entry is stat'ed relative to the directory fd (size, time and permissions
+    // need it). d_type only saves the extra lstat of a symlink, whose target is
+    // stat'ed straight away. Elsewhere std::filesystem is used.
+    // A stop request ends it early with operation_canceled.
+    std::error_code list_dir(const fs::path& dir, const FNEntry& onEntry, std::stop_token stop = {});
+
+    // Fills row for the single entry name of dir, false if it doesn't exist.
+    bool stat_entry(const fs::path& dir, std::string_view name, table_row_data_t& row);
+    // Same, ec says why it failed: no_such_file_or_directory or not_a_directory
+    // if the entry is gone, anything else if it couldn't be looked at.
+    bool stat_entry(const fs::path& dir, std::string_view name, table_row_data_t& row, std::error_code& ec);
+}
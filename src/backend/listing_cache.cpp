@@ -0,0 +1,60 @@
+#include "listing_cache.h"
+
+#include <utility>
+
+namespace {
+
+//"/a/b/" and "/a/./b" are the same directory as "/a/b"
+std::string key_of(const std::filesystem::path& dir)
+{
+    auto path = dir.lexically_normal();
+    if (!path.has_filename() && path.has_relative_path())
+        path = path.parent_path();
+    return path.generic_string();
+}
+
+}
+
+imc::backend::listing_cache_t::listing_cache_t(size_t budget)
+: budget_(budget)
+{
+}
+
+void imc::backend::listing_cache_t::put(cached_listing_t cached)
+{
+    if (!cached.listing)
+        return;
+    auto key = key_of(cached.listing->directory);
+    if (auto it = index_.find(key); it != index_.end())
+        erase(it->second);
+    const size_t memory = cached.listing->memory_usage() + cached.sorter.memory_usage();
+    if (memory > budget_)
+        return;
+    while (used_ + memory > budget_ && !lru_.empty())
+        erase(std::prev(lru_.end()));
+    lru_.push_front({ key, std::move(cached), memory });
+    index_.emplace(std::move(key), lru_.begin());
+    used_ += memory;
+}
+
+std::optional<imc::backend::cached_listing_t> imc::backend::listing_cache_t::take(const fs::path& dir)
+{
+    const auto it = index_.find(key_of(dir));
+    if (it == index_.end())
+        return std::nullopt;
+    auto cached = std::move(it->second->cached);
+    erase(it->second);
+    return cached;
+}
+
+bool imc::backend::listing_cache_t::contains(const fs::path& dir) const
+{
+    return index_.contains(key_of(dir));
+}
+
+void imc::backend::listing_cache_t::erase(EntryList::iterator it)
+{
+    used_ -= it->memory;
+    index_.erase(it->key);
+    lru_.erase(it);
+}
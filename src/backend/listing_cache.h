@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "table_data.h"
+#include "table_sort.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // A listing as a pane left it, with the orderings it was sorted in.
+    struct cached_listing_t
+    {
+        DirSnapshotPtr  listing;
+        table_sorter_t  sorter;
+    };
+
+    // Listings of directories a pane left, so going back to one shows it
+    // right away (sorting included) while its watcher brings it up to date
+    // in the background. A listing is handed over, not copied: it leaves
+    // the cache again when a pane takes it. The least recently left ones
+    // go first once the listings take more memory than the budget. Only
+    // used by the ui thread.
+    class listing_cache_t
+    {
+    public:
+        static constexpr size_t default_budget = 256 * 1024 * 1024;
+
+        explicit listing_cache_t(size_t budget = default_budget);
+
+        // Replaces a listing of the same directory, one bigger than the budget isn't kept.
+        void put(cached_listing_t cached);
+        // The listing of dir, if there is one.
+        std::optional<cached_listing_t> take(const fs::path& dir);
+        bool contains(const fs::path& dir) const;
+        size_t size() const { return lru_.size(); }
+        size_t memory_usage() const { return used_; }
+
+    private:
+        struct entry_t
+        {
+            std::string         key;
+            cached_listing_t    cached;
+            size_t              memory;
+        };
+
+        using EntryList = std::list<entry_t>;
+
+        void erase(EntryList::iterator it);
+
+        // most recently put first
+        EntryList                                           lru_;
+        std::unordered_map<std::string, EntryList::iterator> index_;
+        size_t                                              used_{0U};
+        size_t                                              budget_;
+    };
+}
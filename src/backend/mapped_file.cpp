@@ -0,0 +1,175 @@
+#include "mapped_file.h"
+
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csetjmp>
+#include <csignal>
+#include <mutex>
+#endif
+
+#ifdef _IMC_WINDOWS
+#include <windows.h>
+#endif
+
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+namespace {
+    //the guard of the read running on this thread, if any
+    thread_local sigjmp_buf* read_guard = nullptr;
+    struct sigaction previous_sigbus;
+
+    void on_sigbus(int, siginfo_t*, void*)
+    {
+        if (read_guard != nullptr)
+            siglongjmp(*read_guard, 1);
+        //not a guarded read: the fault happens again once we return, for whoever had it before (by default it kills us)
+        sigaction(SIGBUS, &previous_sigbus, nullptr);
+    }
+
+    void install_sigbus_handler()
+    {
+        static std::once_flag installed;
+        std::call_once(installed, []() {
+            struct sigaction action{};
+            action.sa_sigaction = on_sigbus;
+            //not blocked while the handler runs, nothing has to restore the mask after the jump
+            action.sa_flags = SA_SIGINFO | SA_NODEFER;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGBUS, &action, &previous_sigbus);
+        });
+    }
+}
+#endif
+
+imc::backend::mapped_file_t::~mapped_file_t()
+{
+    close();
+}
+
+std::error_code imc::backend::mapped_file_t::open(const fs::path& file)
+{
+    close();
+    path_ = file;
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+    const int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return std::error_code(errno, std::generic_category());
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        const std::error_code ec(errno, std::generic_category());
+        ::close(fd);
+        return ec;
+    }
+    if (st.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            const std::error_code ec(errno, std::generic_category());
+            ::close(fd);
+            return ec;
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<uint64_t>(st.st_size);
+    }
+    //the mapping keeps the file alive on its own
+    ::close(fd);
+    return {};
+#endif
+#ifdef _IMC_WINDOWS
+    HANDLE handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return std::error_code(static_cast<int>(GetLastError()), std::system_category());
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        const std::error_code ec(static_cast<int>(GetLastError()), std::system_category());
+        CloseHandle(handle);
+        return ec;
+    }
+    if (size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (data == nullptr) {
+            const std::error_code ec(static_cast<int>(GetLastError()), std::system_category());
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(handle);
+            return ec;
+        }
+        mapping_ = mapping;
+        data_ = static_cast<const char*>(data);
+        size_ = static_cast<uint64_t>(size.QuadPart);
+    }
+    CloseHandle(handle);
+    return {};
+#endif
+}
+
+std::error_code imc::backend::mapped_file_t::grow(uint64_t size)
+{
+    if (size <= size_)
+        return {};
+#ifdef _IMC_NIX
+    //nothing was mapped for an empty file, mremap needs something to start from
+    if (data_ != nullptr) {
+        void* data = mremap(const_cast<char*>(data_), size_, size, MREMAP_MAYMOVE);
+        if (data == MAP_FAILED)
+            return std::error_code(errno, std::generic_category());
+        data_ = static_cast<const char*>(data);
+        size_ = size;
+        return {};
+    }
+#endif
+    const auto file = path_;
+    return open(file);
+}
+
+void imc::backend::mapped_file_t::close()
+{
+    if (data_ != nullptr) {
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+        munmap(const_cast<char*>(data_), size_);
+#endif
+#ifdef _IMC_WINDOWS
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        mapping_ = nullptr;
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0U;
+}
+
+void imc::backend::mapped_file_t::advise_sequential(bool sequential) const
+{
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+    if (data_ != nullptr)
+        madvise(const_cast<char*>(data_), static_cast<size_t>(size_), sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+#else
+    (void)sequential;
+#endif
+}
+
+bool imc::backend::run_guarded_read(void (*read)(void*), void* context)
+{
+#if defined(_IMC_NIX) || defined(_IMC_MAC)
+    install_sigbus_handler();
+    sigjmp_buf guard;
+    sigjmp_buf* const outer = read_guard;
+    //the mask isn't saved, a syscall per read would cost more than most reads
+    if (sigsetjmp(guard, 0) != 0) {
+        read_guard = outer;
+        return false;
+    }
+    read_guard = &guard;
+    read(context);
+    read_guard = outer;
+    return true;
+#else
+    //a mapped file can't be truncated on windows
+    read(context);
+    return true;
+#endif
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // A read-only mapping of a whole file, pages come in as they are touched.
+    // If another process truncates the file the pages past its new end are
+    // gone: reading them is a SIGBUS on posix, so whatever reads a file that
+    // may shrink does it under guarded_read() and remaps after a change.
+    class mapped_file_t
+    {
+    public:
+        mapped_file_t() = default;
+        ~mapped_file_t();
+        mapped_file_t(const mapped_file_t&) = delete;
+        mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+        // Drops any previous mapping first. An empty file maps to empty data.
+        std::error_code open(const fs::path& file);
+        // The file got longer, map size bytes of it. On linux the mapping is
+        // extended (it may move), elsewhere the file is mapped again.
+        std::error_code grow(uint64_t size);
+        void close();
+
+        std::string_view data() const { return { data_, static_cast<size_t>(size_) }; }
+        uint64_t size() const { return size_; }
+        // Tells the kernel the data is about to be read front to back (read
+        // ahead aggressively, drop behind), or that it is back to random access.
+        void advise_sequential(bool sequential) const;
+
+    private:
+        fs::path    path_;
+        const char* data_{nullptr};
+        uint64_t    size_{0U};
+#ifdef _IMC_WINDOWS
+        void*       mapping_{nullptr};
+#endif
+    };
+
+    // What guarded_read() runs read through.
+    bool run_guarded_read(void (*read)(void*), void* context);
+
+    // Runs read(), which reads a mapping. A page gone with a truncation
+    // (SIGBUS on posix) cuts read() short right there and this returns
+    // false, instead of the process going down. Nothing read() was in the
+    // middle of gets unwound, so while it touches the mapping it must not
+    // own anything with a destructor or hold a lock.
+    template<typename FNRead>
+    bool guarded_read(FNRead&& read)
+    {
+        using read_t = std::remove_reference_t<FNRead>;
+        return run_guarded_read([](void* context) { (*static_cast<read_t*>(context))(); },
+                                const_cast<void*>(static_cast<const void*>(std::addressof(read))));
+    }
+}
@@ -0,0 +1,729 @@
+#include "name_index.h"
+
+#include "file_operations.h"
+#include "io_executor.h"
+#include "list_dir.h"
+#include "text_search.h"
+#include "work_stealing_pool.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+#ifdef _IMC_NIX
+#include <sys/stat.h>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+constexpr char index_magic[8] = { 'I', 'M', 'C', 'N', 'A', 'M', 'E', 'S' };
+constexpr uint32_t index_version = 1;
+//an index this old gets rebuilt when it is loaded
+constexpr auto max_index_age = std::chrono::hours(24);
+//past this many changes on the side a fresh index is cheaper to query
+constexpr size_t max_changes = 64 * 1024;
+//intersecting with a list this many times longer than the candidates costs more than checking them
+constexpr size_t max_list_ratio = 16;
+constexpr size_t min_build_threads = 4;
+constexpr size_t max_build_threads = 16;
+constexpr const char* roots_file_name = "name_index_roots";
+//rows of a name search go to the pane this many at a time
+constexpr size_t name_rows_per_batch = 256;
+
+//everything is little endian and 8 byte aligned, sections follow the header
+struct header_t
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reserved;
+    int64_t     built;
+    uint64_t    root_offset, root_size;
+    uint64_t    dirs_offset, dir_count;
+    uint64_t    entries_offset, entry_count;
+    uint64_t    names_offset, names_size;
+    uint64_t    trigrams_offset, trigram_count;
+    uint64_t    postings_offset, postings_size;
+};
+
+//a directory's path relative to the root, in the names section ("" for the root)
+struct dir_record_t
+{
+    uint32_t    path_offset;
+    uint32_t    path_size;
+};
+
+struct entry_record_t
+{
+    uint32_t    dir;
+    uint32_t    name_offset;
+    uint32_t    name_size;
+};
+
+struct trigram_record_t
+{
+    uint32_t    key;
+    uint32_t    count;
+    uint64_t    offset;
+};
+
+template<typename T>
+T read_record(const char* section, size_t index)
+{
+    T record;
+    memcpy(&record, section + index * sizeof(T), sizeof(T));
+    return record;
+}
+
+unsigned char lower(char c)
+{
+    const auto u = static_cast<unsigned char>(c);
+    return (u >= 'A' && u <= 'Z') ? static_cast<unsigned char>(u - 'A' + 'a') : u;
+}
+
+//every distinct trigram of name, lower cased
+void trigrams_of(std::string_view name, std::vector<uint32_t>& keys)
+{
+    keys.clear();
+    for(size_t i = 0; i + 3 <= name.size(); i++)
+        keys.push_back((uint32_t(lower(name[i])) << 16) | (uint32_t(lower(name[i + 1])) << 8) | uint32_t(lower(name[i + 2])));
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+void put_varint(std::string& out, uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint32_t get_varint(const char*& pos)
+{
+    uint32_t value = 0;
+    for(int shift = 0;; shift += 7) {
+        const auto byte = static_cast<unsigned char>(*pos++);
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+//a posting list being read, ids come out in increasing order
+struct posting_cursor_t
+{
+    const char* pos;
+    uint32_t    left;
+    uint32_t    id{0U};
+    bool        first{true};
+
+    bool next(uint32_t& out)
+    {
+        if (left == 0)
+            return false;
+        left--;
+        const uint32_t delta = get_varint(pos);
+        id = first ? delta : id + delta;
+        first = false;
+        out = id;
+        return true;
+    }
+};
+
+//what a pane's watcher reports is keyed by the directory and the id of the name in it
+size_t change_key(std::string_view dir, size_t name_id)
+{
+    return entry_id(dir) ^ (name_id * static_cast<size_t>(0x9e3779b97f4a7c15ULL));
+}
+
+//stable across runs and platforms, unlike std::hash
+uint64_t fnv1a(std::string_view text)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+//"" for root itself, the path with '/' otherwise; false if path isn't under root
+bool relative_to(const fs::path& root, const fs::path& path, std::string& relative)
+{
+    const auto rel = path.lexically_relative(root);
+    if (rel.empty() || *rel.begin() == "..")
+        return false;
+    relative = rel == "." ? std::string() : rel.generic_string();
+    return true;
+}
+
+struct listing_t
+{
+    std::string                 path;
+    std::vector<std::string>    names;
+};
+
+struct tree_walk_t
+{
+    std::stop_token         stop;
+    work_stealing_pool_t    pool;
+    //one list per worker, no lock while walking
+    std::vector<std::vector<listing_t>> listings;
+    uint64_t                device{0U};
+
+    tree_walk_t(std::stop_token stop_, size_t threads)
+    : stop(std::move(stop_)), pool(threads), listings(pool.size())
+    {
+    }
+
+    //like find -xdev: /proc, network mounts and the like aren't part of the tree
+    bool same_device(const fs::path& dir) const
+    {
+#ifdef _IMC_NIX
+        struct stat st;
+        return lstat(dir.c_str(), &st) == 0 && st.st_dev == device;
+#else
+        (void)dir;
+        return true;
+#endif
+    }
+
+    void walk(size_t worker, const std::string& relative, const fs::path& dir)
+    {
+        if (stop.stop_requested())
+            return;
+        listing_t listing{ relative, {} };
+        list_dir(dir, [&](const table_row_data_t& row) {
+            auto name = row.name + row.ext;
+            if (row.is_directory && !row.is_symlink) {
+                auto path = dir / name;
+                if (same_device(path)) {
+                    pool.push(worker, [this, relative = relative.empty() ? name : relative + "/" + name, path](size_t w) {
+                        walk(w, relative, path);
+                    });
+                }
+            }
+            listing.names.push_back(std::move(name));
+        });
+        listings[worker].push_back(std::move(listing));
+    }
+};
+
+struct posting_builder_t
+{
+    uint32_t    last{0U};
+    uint32_t    count{0U};
+    std::string bytes;
+};
+
+void align(std::string& out)
+{
+    out.resize((out.size() + 7) & ~size_t(7), '\0');
+}
+
+}
+
+std::error_code imc::backend::name_index_t::build(const fs::path& root, const fs::path& file, std::stop_token stop, size_t threads)
+{
+    std::error_code ec;
+    if (!fs::is_directory(root, ec))
+        return ec ? ec : std::make_error_code(std::errc::not_a_directory);
+    if (threads == 0)
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency(), min_build_threads, max_build_threads);
+
+    tree_walk_t walk(stop, threads);
+#ifdef _IMC_NIX
+    struct stat st;
+    if (stat(root.c_str(), &st) == 0)
+        walk.device = st.st_dev;
+#endif
+    walk.pool.run([&walk, &root](size_t worker) {
+        walk.walk(worker, std::string(), root);
+    });
+    if (stop.stop_requested())
+        return std::make_error_code(std::errc::operation_canceled);
+
+    //sorted by path the file is the same every time the tree is
+    std::vector<listing_t> listings;
+    for(auto& worker : walk.listings)
+        std::move(worker.begin(), worker.end(), std::back_inserter(listings));
+    std::sort(listings.begin(), listings.end(), [](const listing_t& lhs, const listing_t& rhs) { return lhs.path < rhs.path; });
+
+    std::string names;
+    std::vector<dir_record_t> dirs;
+    std::vector<entry_record_t> entries;
+    std::unordered_map<uint32_t, posting_builder_t> postings;
+    std::vector<uint32_t> keys;
+    auto add_name = [&names](std::string_view name) {
+        const auto offset = static_cast<uint32_t>(names.size());
+        names.append(name);
+        return offset;
+    };
+    for(auto& listing : listings) {
+        const auto dir = static_cast<uint32_t>(dirs.size());
+        dirs.push_back({ add_name(listing.path), static_cast<uint32_t>(listing.path.size()) });
+        std::sort(listing.names.begin(), listing.names.end());
+        for(const auto& name : listing.names) {
+            const auto id = static_cast<uint32_t>(entries.size());
+            entries.push_back({ dir, add_name(name), static_cast<uint32_t>(name.size()) });
+            trigrams_of(name, keys);
+            for(const auto key : keys) {
+                auto& list = postings[key];
+                put_varint(list.bytes, list.count == 0 ? id : id - list.last);
+                list.last = id;
+                list.count++;
+            }
+        }
+        //offsets are 32 bit, that is a few hundred million names
+        if (names.size() > UINT32_MAX || entries.size() > UINT32_MAX)
+            return std::make_error_code(std::errc::file_too_large);
+        listing.names = {};
+    }
+
+    std::vector<uint32_t> trigram_keys;
+    trigram_keys.reserve(postings.size());
+    for(const auto& [key, list] : postings)
+        trigram_keys.push_back(key);
+    std::sort(trigram_keys.begin(), trigram_keys.end());
+
+    header_t header{};
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.version = index_version;
+    header.built = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string out(sizeof(header_t), '\0');
+    auto section = [&out](const void* data, size_t size, uint64_t& offset) {
+        offset = out.size();
+        out.append(static_cast<const char*>(data), size);
+        align(out);
+    };
+    const auto root_text = root.generic_string();
+    section(root_text.data(), root_text.size(), header.root_offset);
+    header.root_size = root_text.size();
+    section(dirs.data(), dirs.size() * sizeof(dir_record_t), header.dirs_offset);
+    header.dir_count = dirs.size();
+    section(entries.data(), entries.size() * sizeof(entry_record_t), header.entries_offset);
+    header.entry_count = entries.size();
+    section(names.data(), names.size(), header.names_offset);
+    header.names_size = names.size();
+
+    std::vector<trigram_record_t> trigrams;
+    trigrams.reserve(trigram_keys.size());
+    std::string posting_bytes;
+    for(const auto key : trigram_keys) {
+        auto& list = postings[key];
+        trigrams.push_back({ key, list.count, posting_bytes.size() });
+        posting_bytes += list.bytes;
+        list.bytes = {};
+    }
+    section(trigrams.data(), trigrams.size() * sizeof(trigram_record_t), header.trigrams_offset);
+    header.trigram_count = trigrams.size();
+    section(posting_bytes.data(), posting_bytes.size(), header.postings_offset);
+    header.postings_size = posting_bytes.size();
+    memcpy(out.data(), &header, sizeof(header));
+
+    std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+    if (!stream)
+        return std::make_error_code(std::errc::permission_denied);
+    stream.write(out.data(), static_cast<std::streamsize>(out.size()));
+    stream.close();
+    if (!stream)
+        return std::make_error_code(std::errc::io_error);
+    return {};
+}
+
+std::error_code imc::backend::name_index_t::open(const fs::path& file)
+{
+    if (auto ec = file_.open(file))
+        return ec;
+    const auto data = file_.data();
+    header_t header;
+    if (data.size() < sizeof(header))
+        return std::make_error_code(std::errc::invalid_argument);
+    memcpy(&header, data.data(), sizeof(header));
+    auto fits = [&data](uint64_t offset, uint64_t size) {
+        return offset <= data.size() && size <= data.size() - offset;
+    };
+    if (memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 || header.version != index_version ||
+        !fits(header.root_offset, header.root_size) ||
+        !fits(header.dirs_offset, header.dir_count * sizeof(dir_record_t)) ||
+        !fits(header.entries_offset, header.entry_count * sizeof(entry_record_t)) ||
+        !fits(header.names_offset, header.names_size) ||
+        !fits(header.trigrams_offset, header.trigram_count * sizeof(trigram_record_t)) ||
+        !fits(header.postings_offset, header.postings_size)) {
+        file_.close();
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+    root_ = fs::path(std::string(data.substr(header.root_offset, header.root_size)));
+    built_ = std::chrono::system_clock::time_point(std::chrono::seconds(header.built));
+    entry_count_ = header.entry_count;
+    trigram_count_ = header.trigram_count;
+    dirs_ = data.data() + header.dirs_offset;
+    entries_ = data.data() + header.entries_offset;
+    trigrams_ = data.data() + header.trigrams_offset;
+    names_ = data.substr(header.names_offset, header.names_size);
+    postings_ = data.substr(header.postings_offset, header.postings_size);
+    return {};
+}
+
+size_t imc::backend::name_index_t::changes() const
+{
+    std::lock_guard lock(mutex_);
+    return added_.size() + removed_.size();
+}
+
+std::string_view imc::backend::name_index_t::name(size_t entry) const
+{
+    const auto record = read_record<entry_record_t>(entries_, entry);
+    return names_.substr(record.name_offset, record.name_size);
+}
+
+std::string_view imc::backend::name_index_t::directory(size_t entry) const
+{
+    const auto record = read_record<dir_record_t>(dirs_, read_record<entry_record_t>(entries_, entry).dir);
+    return names_.substr(record.path_offset, record.path_size);
+}
+
+std::vector<std::string> imc::backend::name_index_t::find(std::string_view query, size_t max) const
+{
+    std::vector<std::string> found;
+    if (query.empty() || max == 0)
+        return found;
+    const auto slash = query.rfind('/');
+    const auto name_query = slash == std::string_view::npos ? query : query.substr(slash + 1);
+    const text_finder_t name_finder(name_query, true);
+    const text_finder_t path_finder(query, true);
+    const bool whole_path = slash != std::string_view::npos;
+
+    std::string path;
+    auto check = [&](std::string_view dir, std::string_view name) {
+        if (!name_query.empty() && name_finder.find(name) == std::string_view::npos)
+            return;
+        path.assign(dir);
+        if (!path.empty())
+            path.push_back('/');
+        path.append(name);
+        if (whole_path && path_finder.find(path) == std::string_view::npos)
+            return;
+        found.push_back(path);
+    };
+
+    //what changed is copied out, apply() on the watcher threads doesn't wait for a scan of the whole file
+    std::vector<added_t> added_names;
+    std::unordered_set<size_t> removed_keys;
+    {
+        std::lock_guard lock(mutex_);
+        added_names = added_;
+        removed_keys = removed_;
+    }
+    auto removed = [&removed_keys](std::string_view dir, std::string_view name) {
+        return !removed_keys.empty() && removed_keys.contains(change_key(dir, entry_id(name)));
+    };
+
+    if (name_query.size() < 3) {
+        //no trigram to narrow it down, every name gets looked at
+        for(size_t entry = 0; entry < entry_count_ && found.size() < max; entry++) {
+            const auto entry_name = name(entry);
+            if (!removed(directory(entry), entry_name))
+                check(directory(entry), entry_name);
+        }
+    } else {
+        std::vector<uint32_t> keys;
+        trigrams_of(name_query, keys);
+        std::vector<trigram_record_t> lists;
+        for(const auto key : keys) {
+            size_t low = 0;
+            size_t high = trigram_count_;
+            while (low < high) {
+                const size_t mid = (low + high) / 2;
+                if (read_record<trigram_record_t>(trigrams_, mid).key < key)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            if (low == trigram_count_ || read_record<trigram_record_t>(trigrams_, low).key != key) {
+                lists.clear();
+                break;
+            }
+            lists.push_back(read_record<trigram_record_t>(trigrams_, low));
+        }
+        //shortest list first, every other one can only make it shorter
+        std::sort(lists.begin(), lists.end(), [](const trigram_record_t& lhs, const trigram_record_t& rhs) { return lhs.count < rhs.count; });
+        std::vector<uint32_t> candidates;
+        for(size_t i = 0; i < lists.size(); i++) {
+            posting_cursor_t cursor{ postings_.data() + lists[i].offset, lists[i].count };
+            uint32_t id = 0;
+            if (i == 0) {
+                candidates.reserve(lists[i].count);
+                while (cursor.next(id))
+                    candidates.push_back(id);
+                continue;
+            }
+            if (candidates.empty() || candidates.size() * max_list_ratio < lists[i].count)
+                break;
+            size_t kept = 0;
+            bool more = cursor.next(id);
+            for(size_t c = 0; c < candidates.size() && more; c++) {
+                while (more && id < candidates[c])
+                    more = cursor.next(id);
+                if (more && id == candidates[c])
+                    candidates[kept++] = candidates[c];
+            }
+            candidates.resize(kept);
+        }
+        for(size_t c = 0; c < candidates.size() && found.size() < max; c++) {
+            const auto entry_name = name(candidates[c]);
+            if (!removed(directory(candidates[c]), entry_name))
+                check(directory(candidates[c]), entry_name);
+        }
+    }
+    for(size_t a = 0; a < added_names.size() && found.size() < max; a++) {
+        const std::string_view added = added_names[a].path;
+        const auto last = added.rfind('/');
+        check(last == std::string_view::npos ? std::string_view() : added.substr(0, last),
+              last == std::string_view::npos ? added : added.substr(last + 1));
+    }
+    return found;
+}
+
+void imc::backend::name_index_t::apply(const fs::path& dir, const table_delta_t& delta)
+{
+    std::string relative;
+    if (!relative_to(root_, dir, relative))
+        return;
+    std::lock_guard lock(mutex_);
+    for(const auto id : delta.removed) {
+        const auto key = change_key(relative, id);
+        removed_.insert(key);
+        std::erase_if(added_, [key](const added_t& added) { return added.key == key; });
+    }
+    for(const auto& row : delta.added) {
+        const auto name = row.name + row.ext;
+        const auto key = change_key(relative, entry_id(name));
+        if (std::any_of(added_.begin(), added_.end(), [key](const added_t& added) { return added.key == key; }))
+            continue;
+        //hides the name in the file, if it is there, so it doesn't show up twice
+        removed_.insert(key);
+        added_.push_back({ relative.empty() ? name : relative + "/" + name, key });
+    }
+}
+
+imc::backend::name_search_t::~name_search_t()
+{
+    cancel();
+}
+
+void imc::backend::name_search_t::start(std::shared_ptr<name_index_t> index, const std::string& query, size_t max)
+{
+    cancel();
+    search_ = std::make_shared<search_t>();
+    search_->running.store(true, std::memory_order_release);
+    stop_ = std::stop_source();
+    io_executor().submit([search = search_, index = std::move(index), query, max](std::stop_token stop) {
+        run(stop, *search, *index, query, max);
+    }, stop_.get_token());
+}
+
+void imc::backend::name_search_t::cancel()
+{
+    stop_.request_stop();
+    search_->running.store(false, std::memory_order_release);
+}
+
+void imc::backend::name_search_t::run(std::stop_token stop, search_t& search, const name_index_t& index, const std::string& query, size_t max)
+{
+    const auto started = std::chrono::steady_clock::now();
+    const auto paths = index.find(query, max);
+    search.searched = (std::chrono::steady_clock::now() - started).count();
+    search.matches = paths.size();
+
+    TableRowDataVector rows;
+    table_row_data_t row;
+    auto deliver = [&search, &rows]() {
+        std::lock_guard lock(search.mutex);
+        search.results.insert(search.results.end(), std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+        rows.clear();
+    };
+    for(const auto& path : paths) {
+        if (stop.stop_requested())
+            break;
+        const fs::path relative(path);
+        if (!stat_entry(index.root() / relative.parent_path(), relative.filename().generic_string(), row))
+            continue;
+        if (const auto dir = relative.parent_path().generic_string(); !dir.empty())
+            row.name = dir + "/" + row.name;
+        row.id = entry_id(path);
+        rows.push_back(row);
+        if (rows.size() == name_rows_per_batch)
+            deliver();
+    }
+    deliver();
+    search.running.store(false, std::memory_order_release);
+}
+
+TableRowDataVector imc::backend::name_search_t::take_results()
+{
+    std::lock_guard lock(search_->mutex);
+    return std::exchange(search_->results, {});
+}
+
+std::chrono::duration<double, std::milli> imc::backend::name_search_t::searched() const
+{
+    return std::chrono::steady_clock::duration(search_->searched.load());
+}
+
+imc::backend::name_indexes_t::~name_indexes_t()
+{
+    //builders may still want the lock to swap their index in
+    decltype(roots_) roots;
+    {
+        std::lock_guard lock(mutex_);
+        roots.swap(roots_);
+    }
+}
+
+void imc::backend::name_indexes_t::load()
+{
+    std::lock_guard lock(mutex_);
+    directory_ = cache_directory();
+    if (directory_.empty())
+        return;
+    std::ifstream stream(directory_ / roots_file_name);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty() || std::any_of(roots_.begin(), roots_.end(), [&line](const auto& root) { return root->path == line; }))
+            continue;
+        auto& root = *roots_.emplace_back(std::make_unique<root_t>());
+        root.path = line;
+        root.file = directory_ / fmt::format("names-{:016x}.idx", fnv1a(root.path.generic_string()));
+        auto index = std::make_shared<name_index_t>();
+        const bool usable = !index->open(root.file) && index->root() == root.path;
+        if (usable)
+            root.index = index;
+        if (!usable || std::chrono::system_clock::now() - index->built() > max_index_age)
+            start_build(root);
+    }
+}
+
+void imc::backend::name_indexes_t::rebuild(const fs::path& path)
+{
+    std::error_code ec;
+    auto absolute = fs::absolute(path, ec).lexically_normal();
+    if (ec)
+        return;
+    //"/a/b/" and "/a/b" are the same root
+    if (!absolute.has_filename() && absolute.has_relative_path())
+        absolute = absolute.parent_path();
+    std::lock_guard lock(mutex_);
+    if (directory_.empty())
+        directory_ = cache_directory();
+    if (directory_.empty())
+        return;
+    auto it = std::find_if(roots_.begin(), roots_.end(), [&absolute](const auto& root) { return root->path == absolute; });
+    if (it == roots_.end()) {
+        auto& root = *roots_.emplace_back(std::make_unique<root_t>());
+        root.path = absolute;
+        root.file = directory_ / fmt::format("names-{:016x}.idx", fnv1a(root.path.generic_string()));
+        save_roots();
+        it = roots_.end() - 1;
+    }
+    start_build(**it);
+}
+
+imc::backend::name_indexes_t::root_t* imc::backend::name_indexes_t::find_root(const fs::path& path) const
+{
+    //the deepest root wins
+    root_t* best = nullptr;
+    std::string relative;
+    for(const auto& root : roots_) {
+        if (relative_to(root->path, path, relative) && (!best || root->path.native().size() > best->path.native().size()))
+            best = root.get();
+    }
+    return best;
+}
+
+fs::path imc::backend::name_indexes_t::root_of(const fs::path& path) const
+{
+    std::lock_guard lock(mutex_);
+    const auto* root = find_root(path);
+    return root ? root->path : fs::path();
+}
+
+std::shared_ptr<name_index_t> imc::backend::name_indexes_t::index(const fs::path& root) const
+{
+    std::lock_guard lock(mutex_);
+    for(const auto& r : roots_) {
+        if (r->path == root)
+            return r->index;
+    }
+    return nullptr;
+}
+
+bool imc::backend::name_indexes_t::building(const fs::path& root) const
+{
+    std::lock_guard lock(mutex_);
+    for(const auto& r : roots_) {
+        if (r->path == root)
+            return r->building;
+    }
+    return false;
+}
+
+void imc::backend::name_indexes_t::apply(const fs::path& dir, const table_delta_t& delta)
+{
+    std::lock_guard lock(mutex_);
+    auto* root = find_root(dir);
+    if (!root)
+        return;
+    if (root->building)
+        root->seen_while_building.emplace_back(dir, delta);
+    if (!root->index)
+        return;
+    root->index->apply(dir, delta);
+    if (root->index->changes() > max_changes)
+        start_build(*root);
+}
+
+void imc::backend::name_indexes_t::start_build(root_t& root)
+{
+    if (root.building)
+        return;
+    root.building = true;
+    //the previous builder is done, this only joins it
+    root.builder = std::jthread([this, &root](std::stop_token stop) {
+        auto temporary = root.file;
+        temporary += ".tmp";
+        std::error_code ec = name_index_t::build(root.path, temporary, stop);
+        if (!ec) {
+            //a mapping of the old file stays valid, it is just unlinked
+            fs::rename(temporary, root.file, ec);
+        }
+        std::shared_ptr<name_index_t> index;
+        if (ec) {
+            fs::remove(temporary, ec);
+        } else if (index = std::make_shared<name_index_t>(); index->open(root.file)) {
+            index.reset();
+        }
+        std::lock_guard lock(mutex_);
+        if (index) {
+            for(const auto& [dir, delta] : root.seen_while_building)
+                index->apply(dir, delta);
+            root.index = index;
+        }
+        root.seen_while_building.clear();
+        root.building = false;
+    });
+}
+
+void imc::backend::name_indexes_t::save_roots() const
+{
+    std::ofstream stream(directory_ / roots_file_name, std::ios::trunc);
+    for(const auto& root : roots_)
+        stream << root->path.generic_string() << '\n';
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
+#include "table_data.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // Every name under a root, in a file that is mapped instead of read:
+    // the names, the directory each one is in, and for every trigram (three
+    // lower cased bytes) of the names the delta/varint coded list of names
+    // that have it. A query only decodes the lists of its own trigrams and
+    // checks what is in all of them. What panes see change after the file
+    // was written is kept on the side (names added, names removed) and
+    // taken into account by every query.
+    class name_index_t
+    {
+    public:
+        // Walks root on a work-stealing pool with list_dir and writes the index to file.
+        static std::error_code build(const fs::path& root, const fs::path& file, std::stop_token stop, size_t threads = 0);
+
+        name_index_t() = default;
+        name_index_t(const name_index_t&) = delete;
+        name_index_t& operator=(const name_index_t&) = delete;
+
+        std::error_code open(const fs::path& file);
+        const fs::path& root() const { return root_; }
+        // Names in the file, what changed since isn't counted.
+        size_t size() const { return entry_count_; }
+        std::chrono::system_clock::time_point built() const { return built_; }
+        // Names and removals seen since the file was written.
+        size_t changes() const;
+
+        // Paths relative to the root whose name contains query, ignoring
+        // (ascii) case. A query with a '/' in it has to match the path
+        // from there on, its last part the name. At most max of them.
+        std::vector<std::string> find(std::string_view query, size_t max) const;
+        // A pane's watcher saw these changes to dir, somewhere under the root.
+        void apply(const fs::path& dir, const table_delta_t& delta);
+
+    private:
+        struct added_t
+        {
+            std::string path;
+            size_t      key;
+        };
+
+        std::string_view name(size_t entry) const;
+        std::string_view directory(size_t entry) const;
+
+        mapped_file_t                           file_;
+        fs::path                                root_;
+        std::chrono::system_clock::time_point   built_;
+        size_t                                  entry_count_{0U};
+        size_t                                  trigram_count_{0U};
+        const char*                             dirs_{nullptr};
+        const char*                             entries_{nullptr};
+        const char*                             trigrams_{nullptr};
+        std::string_view                        names_;
+        std::string_view                        postings_;
+
+        //only held to change or copy these, never for a scan
+        mutable std::mutex                      mutex_;
+        std::vector<added_t>                    added_;
+        std::unordered_set<size_t>              removed_;
+    };
+
+    // A query of a name_index_t and a stat of every path it answers with, as
+    // a task on the shared io_executor_t: indexed roots are the big and often
+    // remote trees, none of it may run on the ui thread. What is gone since the
+    // index was written doesn't come out. Rows are named relative to the root
+    // and come in batches, like find_in_files_t's. Cancelling doesn't wait.
+    class name_search_t
+    {
+    public:
+        name_search_t() = default;
+        ~name_search_t();
+        name_search_t(const name_search_t&) = delete;
+        name_search_t& operator=(const name_search_t&) = delete;
+
+        // Cancels a search still running first.
+        void start(std::shared_ptr<name_index_t> index, const std::string& query, size_t max);
+        void cancel();
+        bool running() const { return search_->running.load(std::memory_order_acquire); }
+        // Rows found since the last call.
+        TableRowDataVector take_results();
+        // How many paths the index answered with and how long that took, 0 until it did.
+        size_t matches() const { return search_->matches.load(); }
+        std::chrono::duration<double, std::milli> searched() const;
+
+    private:
+        // one search, a cancelled one keeps it until its task noticed
+        struct search_t
+        {
+            std::mutex                  mutex;
+            TableRowDataVector          results;
+            std::atomic_bool            running{false};
+            std::atomic<size_t>         matches{0U};
+            std::atomic<std::chrono::steady_clock::rep> searched{0};
+        };
+
+        static void run(std::stop_token stop, search_t& search, const name_index_t& index, const std::string& query, size_t max);
+
+        std::shared_ptr<search_t>   search_{std::make_shared<search_t>()};
+        std::stop_source            stop_;
+    };
+
+    // The roots the user asked to index, each with its index in the cache
+    // directory. Missing or day old indexes, or ones that saw too many
+    // changes, are rebuilt in the background and swapped in when done,
+    // together with the changes seen while the walk was going on.
+    class name_indexes_t
+    {
+    public:
+        name_indexes_t() = default;
+        ~name_indexes_t();
+        name_indexes_t(const name_indexes_t&) = delete;
+        name_indexes_t& operator=(const name_indexes_t&) = delete;
+
+        // Reads the list of roots and maps their indexes.
+        void load();
+        // Adds root if it is new and indexes it (again) in the background.
+        void rebuild(const fs::path& root);
+        // The root path is in or under, empty if it isn't indexed.
+        fs::path root_of(const fs::path& path) const;
+        // Its index, nullptr until there is one.
+        std::shared_ptr<name_index_t> index(const fs::path& root) const;
+        bool building(const fs::path& root) const;
+        // Hands changes a pane saw to the index covering dir, from any thread.
+        void apply(const fs::path& dir, const table_delta_t& delta);
+
+    private:
+        struct root_t
+        {
+            fs::path                        path;
+            fs::path                        file;
+            std::shared_ptr<name_index_t>   index;
+            std::atomic_bool                building{false};
+            // what apply() got since the build started, the walk may already have passed there
+            std::vector<std::pair<fs::path, table_delta_t>> seen_while_building;
+            std::jthread                    builder;
+        };
+
+        root_t* find_root(const fs::path& path) const;
+        void start_build(root_t& root);
+        void save_roots() const;
+
+        fs::path                                directory_;
+        mutable std::mutex                      mutex_;
+        std::vector<std::unique_ptr<root_t>>    roots_;
+    };
+}
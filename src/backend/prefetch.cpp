@@ -0,0 +1,42 @@
+#include "prefetch.h"
+
+#include "io_executor.h"
+#include "watch_dir.h"
+
+#include <utility>
+
+imc::backend::listing_prefetcher_t::~listing_prefetcher_t()
+{
+    drop();
+}
+
+void imc::backend::listing_prefetcher_t::want(const fs::path& dir, const table_sort_specs_t& specs)
+{
+    if (dir == wanted_)
+        return;
+    cancel_.request_stop();
+    cancel_ = std::stop_source();
+    wanted_ = dir;
+    io_executor().submit_idle([ready = ready_, dir, specs](std::stop_token stop) {
+        cached_listing_t cached;
+        cached.listing = read_listing(dir, stop);
+        if (!cached.listing)
+            return;
+        cached.sorter.sorted(*cached.listing, specs);
+        std::lock_guard lock(ready->mutex);
+        if (!stop.stop_requested())
+            ready->listing = std::move(cached);
+    }, cancel_.get_token());
+}
+
+void imc::backend::listing_prefetcher_t::drop()
+{
+    cancel_.request_stop();
+    wanted_.clear();
+}
+
+std::optional<imc::backend::cached_listing_t> imc::backend::listing_prefetcher_t::take()
+{
+    std::lock_guard lock(ready_->mutex);
+    return std::exchange(ready_->listing, std::nullopt);
+}
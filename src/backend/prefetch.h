@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+
+#include "listing_cache.h"
+#include "table_sort.h"
+
+namespace imc::backend {
+    namespace fs = std::filesystem;
+
+    // Lists the directory the user looks like going into next (the mouse
+    // or the cursor rests on it) as an idle task of the io_executor_t, at
+    // idle cpu and io priority, and sorts it, so entering it only has to
+    // take the result. Asking for another directory, or dropping, stops
+    // the listing under way right where it is.
+    class listing_prefetcher_t
+    {
+    public:
+        listing_prefetcher_t() = default;
+        ~listing_prefetcher_t();
+        listing_prefetcher_t(const listing_prefetcher_t&) = delete;
+        listing_prefetcher_t& operator=(const listing_prefetcher_t&) = delete;
+
+        // Lists dir sorted as specs asks, unless it is what was asked for last.
+        void want(const fs::path& dir, const table_sort_specs_t& specs);
+        void drop();
+        // A listing finished since the last call.
+        std::optional<cached_listing_t> take();
+
+    private:
+        // outlives the prefetcher for a task that hasn't noticed it was stopped
+        struct ready_t
+        {
+            std::mutex                      mutex;
+            std::optional<cached_listing_t> listing;
+        };
+
+        fs::path                    wanted_;
+        // stops the listing of wanted_
+        std::stop_source            cancel_;
+        std::shared_ptr<ready_t>    ready_{std::make_shared<ready_t>()};
+    };
+}
@@ -0,0 +1,135 @@
+#include "row_display.h"
+
+#include <fmt/format.h>
+
+#include "timestamp_format.h"
+#include "utils/string_utils.h"
+
+namespace fs = std::filesystem;
+
+using namespace imc::string_utils;
+
+namespace {
+
+imc::backend::timestamp_formatter_t& modified_formatter()
+{
+    static imc::backend::timestamp_formatter_t formatter;
+    return formatter;
+}
+
+}
+
+std::string imc::backend::format_size(size_t size, bool is_directory)
+{
+    if (is_directory)
+        return fmt::format("{:>10}", "<DIR>");
+    return size_to_display(size);
+}
+
+std::string imc::backend::format_modified(file_time modified)
+{
+    return modified_formatter()(modified);
+}
+
+void imc::backend::set_modified_format(std::string_view format)
+{
+    modified_formatter() = timestamp_formatter_t(format);
+}
+
+const std::string& imc::backend::modified_format()
+{
+    return modified_formatter().format();
+}
+
+std::string imc::backend::format_permissions(file_perm p)
+{
+    return fmt::format("{}{}{}{}{}{}{}{}{}",
+        ((p & fs::perms::owner_read) != fs::perms::none ? "r" : "-"),
+        ((p & fs::perms::owner_write) != fs::perms::none ? "w" : "-"),
+        ((p & fs::perms::owner_exec) != fs::perms::none ? "x" : "-"),
+        ((p & fs::perms::group_read) != fs::perms::none ? "r" : "-"),
+        ((p & fs::perms::group_write) != fs::perms::none ? "w" : "-"),
+        ((p & fs::perms::group_exec) != fs::perms::none ? "x" : "-"),
+        ((p & fs::perms::others_read) != fs::perms::none ? "r" : "-"),
+        ((p & fs::perms::others_write) != fs::perms::none ? "w" : "-"),
+        ((p & fs::perms::others_exec) != fs::perms::none ? "x" : "-")
+    );
+}
+
+imc::backend::row_display_cache_t::row_display_cache_t(size_t capacity)
+: capacity_(capacity)
+{
+    entries_.reserve(capacity);
+}
+
+void imc::backend::row_display_cache_t::new_frame()
+{
+    frame_++;
+}
+
+void imc::backend::row_display_cache_t::clear()
+{
+    entries_.clear();
+}
+
+std::string_view imc::backend::row_display_cache_t::get_column(const dir_snapshot_t& data, size_t index, int col_id)
+{
+    if (data.is_imaginary(index) && col_id != sortable_columns::Name && col_id != sortable_columns::Size)
+        return {};
+    switch(col_id)
+    {
+        using namespace sortable_columns;
+        case Name:
+            return data.name(index);
+        case Ext:
+            return data.ext(index);
+        case Size:
+            return get_entry(data, index).size_display;
+        case Modified:
+            return get_entry(data, index).modified_display;
+        case Permissions:
+            return get_entry(data, index).permissions_display;
+        default:
+            return {};
+    }
+}
+
+imc::backend::row_display_cache_t::entry_t& imc::backend::row_display_cache_t::get_entry(const dir_snapshot_t& data, size_t index)
+{
+    const auto id = data.ids[index];
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+        if (entries_.size() >= capacity_)
+            evict();
+        it = entries_.emplace(id, entry_t{}).first;
+    }
+
+    auto& entry = it->second;
+    const auto size = data.sizes[index];
+    //a directory with its size calculated shows it like a file would
+    const bool is_directory = data.is_directory(index) && !data.has(index, entry_flags::SizeKnown);
+    //first use, or the row changed since it was formatted
+    if (entry.last_used == 0 || entry.size != size || entry.is_directory != is_directory) {
+        entry.size = size;
+        entry.is_directory = is_directory;
+        entry.size_display = format_size(size, is_directory);
+    }
+    if (entry.last_used == 0 || entry.modified != data.modified[index]) {
+        entry.modified = data.modified[index];
+        entry.modified_display = format_modified(entry.modified);
+    }
+    if (entry.last_used == 0 || entry.permissions != data.permissions[index]) {
+        entry.permissions = data.permissions[index];
+        entry.permissions_display = format_permissions(entry.permissions);
+    }
+    entry.last_used = frame_;
+    return entry;
+}
+
+void imc::backend::row_display_cache_t::evict()
+{
+    //whatever wasn't drawn this frame can go, drawn rows have to stay valid until the next frame.
+    std::erase_if(entries_, [this](const auto& item) {
+        return item.second.last_used != frame_;
+    });
+}
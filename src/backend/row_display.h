@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "table_data.h"
+
+namespace imc::backend {
+    std::string format_size(size_t size, bool is_directory);
+    // The ui thread's, format is strftime like (see timestamp_formatter_t).
+    std::string format_modified(file_time modified);
+    void set_modified_format(std::string_view format);
+    const std::string& modified_format();
+    std::string format_permissions(file_perm permissions);
+
+    // Display text is only formatted for rows that actually get drawn,
+    // and kept while they stay on screen.
+    class row_display_cache_t
+    {
+    public:
+        explicit row_display_cache_t(size_t capacity = 1024);
+
+        // Rows not drawn since the previous frame become evictable.
+        void new_frame();
+        void clear();
+        // Valid until the next new_frame().
+        std::string_view get_column(const dir_snapshot_t& data, size_t index, int col_id);
+
+    private:
+        struct entry_t
+        {
+            size_t          size{0U};
+            file_time       modified;
+            file_perm       permissions{file_perm::none};
+            bool            is_directory{false};
+            std::string     size_display;
+            std::string     modified_display;
+            std::string     permissions_display;
+            uint64_t        last_used{0};
+        };
+
+        entry_t& get_entry(const dir_snapshot_t& data, size_t index);
+        void evict();
+
+        std::unordered_map<size_t, entry_t> entries_;
+        size_t capacity_;
+        uint64_t frame_{1};
+    };
+}
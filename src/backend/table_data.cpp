@@ -0,0 +1,213 @@
+#include "table_data.h"
+
+#include <algorithm>
+#include <bit>
+
+using namespace imc::backend;
+
+namespace {
+    constexpr uint32_t empty_slot = UINT32_MAX;
+    //a row left, probing has to go on past it
+    constexpr uint32_t dead_slot = UINT32_MAX - 1;
+}
+
+uint16_t imc::backend::table_row_data_t::flags() const
+{
+    using namespace entry_flags;
+    uint16_t f = 0;
+    if (is_directory) f |= Directory;
+    if (is_block_file) f |= BlockFile;
+    if (is_character_file) f |= CharacterFile;
+    if (is_fifo) f |= Fifo;
+    if (is_other) f |= Other;
+    if (is_socket) f |= Socket;
+    if (is_symlink) f |= Symlink;
+    if (is_regular_file) f |= RegularFile;
+    if (is_imaginary) f |= Imaginary;
+    return f;
+}
+
+void imc::backend::dir_snapshot_t::reserve(size_t count)
+{
+    ids.reserve(count);
+    sizes.reserve(count);
+    modified.reserve(count);
+    permissions.reserve(count);
+    flags.reserve(count);
+    name_offsets.reserve(count);
+    name_lengths.reserve(count);
+    ext_lengths.reserve(count);
+    if (row_slots.size() < count * 2)
+        rehash(std::max(count, live_size()));
+    //file names average out somewhere around here
+    names.reserve(count * 24);
+}
+
+size_t imc::backend::dir_snapshot_t::push_back(const table_row_data_t& row)
+{
+    const size_t index = ids.size();
+    ids.push_back(row.id);
+    sizes.push_back(row.size);
+    modified.push_back(row.modified);
+    permissions.push_back(row.permissions);
+    flags.push_back(row.flags());
+    name_offsets.push_back(0);
+    name_lengths.push_back(0);
+    ext_lengths.push_back(0);
+    set_file_name(index, row.name, row.ext);
+    index_row(index);
+    return index;
+}
+
+void imc::backend::dir_snapshot_t::update(size_t index, const table_row_data_t& row)
+{
+    if (ids[index] != row.id) {
+        unindex_row(index);
+        ids[index] = row.id;
+        index_row(index);
+    }
+    sizes[index] = row.size;
+    modified[index] = row.modified;
+    permissions[index] = row.permissions;
+    flags[index] = row.flags();
+    if (name(index) != row.name || ext(index) != row.ext)
+        set_file_name(index, row.name, row.ext);
+}
+
+void imc::backend::dir_snapshot_t::remove(size_t index)
+{
+    if (is_removed(index))
+        return;
+    flags[index] |= entry_flags::Removed;
+    removed++;
+    unindex_row(index);
+}
+
+void imc::backend::dir_snapshot_t::set_file_name(size_t index, std::string_view name, std::string_view ext)
+{
+    //the old name (if any) stays in the arena until the next compact
+    name_offsets[index] = static_cast<uint32_t>(names.size());
+    name_lengths[index] = static_cast<uint16_t>(name.size());
+    ext_lengths[index] = static_cast<uint16_t>(ext.size());
+    names.append(name);
+    names.append(ext);
+}
+
+std::vector<uint32_t> imc::backend::dir_snapshot_t::compact()
+{
+    std::vector<uint32_t> remap(size(), static_cast<uint32_t>(npos));
+    dir_snapshot_t out;
+    out.directory = directory;
+    out.reserve(live_size());
+    for(size_t i = 0; i < size(); i++) {
+        if (is_removed(i))
+            continue;
+        const auto index = out.ids.size();
+        out.ids.push_back(ids[i]);
+        out.sizes.push_back(sizes[i]);
+        out.modified.push_back(modified[i]);
+        out.permissions.push_back(permissions[i]);
+        out.flags.push_back(flags[i]);
+        out.name_offsets.push_back(0);
+        out.name_lengths.push_back(0);
+        out.ext_lengths.push_back(0);
+        out.set_file_name(index, name(i), ext(i));
+        out.index_row(index);
+        remap[i] = static_cast<uint32_t>(index);
+    }
+    out.names.shrink_to_fit();
+    *this = std::move(out);
+    return remap;
+}
+
+std::filesystem::path imc::backend::dir_snapshot_t::absolute_path(size_t index) const
+{
+    if (is_imaginary(index))
+        return directory.parent_path();
+    return directory / file_name(index);
+}
+
+void imc::backend::dir_snapshot_t::index_row(size_t index)
+{
+    //at most half full, counting the dead, so probes stay short and end
+    if ((row_slots_used + 1) * 2 > row_slots.size())
+        rehash(live_size());
+    const size_t mask = row_slots.size() - 1;
+    size_t reuse = npos;
+    for(size_t i = ids[index] & mask; ; i = (i + 1) & mask) {
+        const uint32_t slot = row_slots[i];
+        if (slot == empty_slot) {
+            if (reuse == npos) {
+                reuse = i;
+                row_slots_used++;
+            }
+            break;
+        }
+        if (slot == dead_slot) {
+            if (reuse == npos)
+                reuse = i;
+            continue;
+        }
+        //the id is back, the new row takes over
+        if (ids[slot] == ids[index]) {
+            reuse = i;
+            break;
+        }
+    }
+    row_slots[reuse] = static_cast<uint32_t>(index);
+}
+
+void imc::backend::dir_snapshot_t::unindex_row(size_t index)
+{
+    if (row_slots.empty())
+        return;
+    const size_t mask = row_slots.size() - 1;
+    for(size_t i = ids[index] & mask; row_slots[i] != empty_slot; i = (i + 1) & mask) {
+        const uint32_t slot = row_slots[i];
+        if (slot == dead_slot || ids[slot] != ids[index])
+            continue;
+        //a row added back under the same id already took its place
+        if (slot == index)
+            row_slots[i] = dead_slot;
+        return;
+    }
+}
+
+void imc::backend::dir_snapshot_t::rehash(size_t count)
+{
+    auto old = std::move(row_slots);
+    row_slots.assign(std::bit_ceil(std::max<size_t>(count, 8) * 2), empty_slot);
+    row_slots_used = 0;
+    for(const uint32_t slot : old) {
+        if (slot != empty_slot && slot != dead_slot)
+            index_row(slot);
+    }
+}
+
+size_t imc::backend::dir_snapshot_t::find(size_t id) const
+{
+    if (row_slots.empty())
+        return npos;
+    const size_t mask = row_slots.size() - 1;
+    for(size_t i = id & mask; row_slots[i] != empty_slot; i = (i + 1) & mask) {
+        const uint32_t slot = row_slots[i];
+        if (slot != dead_slot && ids[slot] == id)
+            return slot;
+    }
+    return npos;
+}
+
+size_t imc::backend::dir_snapshot_t::memory_usage() const
+{
+    return sizeof(*this) +
+        ids.capacity() * sizeof(size_t) +
+        sizes.capacity() * sizeof(uint64_t) +
+        modified.capacity() * sizeof(file_time) +
+        permissions.capacity() * sizeof(file_perm) +
+        flags.capacity() * sizeof(uint16_t) +
+        name_offsets.capacity() * sizeof(uint32_t) +
+        name_lengths.capacity() * sizeof(uint16_t) +
+        ext_lengths.capacity() * sizeof(uint16_t) +
+        names.capacity() +
+        row_slots.capacity() * sizeof(uint32_t);
+}
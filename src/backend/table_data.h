@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace imc::backend {
@@ -17,18 +20,38 @@ namespace imc::backend {
         constexpr int Permissions = 4;
     }
 
+    namespace entry_flags {
+        constexpr uint16_t Directory        = 1 << 0;
+        constexpr uint16_t BlockFile        = 1 << 1;
+        constexpr uint16_t CharacterFile    = 1 << 2;
+        constexpr uint16_t Fifo             = 1 << 3;
+        constexpr uint16_t Other            = 1 << 4;
+        constexpr uint16_t Socket           = 1 << 5;
+        constexpr uint16_t Symlink          = 1 << 6;
+        constexpr uint16_t RegularFile      = 1 << 7;
+        constexpr uint16_t Imaginary        = 1 << 8;
+        //slot is dead until the snapshot gets compacted
+        constexpr uint16_t Removed          = 1 << 9;
+        //a directory whose size is the total of what is under it, not just <DIR>
+        constexpr uint16_t SizeKnown        = 1 << 10;
+    }
+
+    // Ids only have to be unique within one snapshot, so the name relative
+    // to the snapshot's directory is all that gets hashed.
+    inline size_t entry_id(std::string_view name)
+    {
+        return std::hash<std::string_view>{}(name);
+    }
+
+    // One entry as the enumerator sees it, the snapshot keeps it column by column.
     struct table_row_data_t
     {
         size_t          id;
         std::string     name;
         std::string     ext;
         size_t          size{0U};
-        std::string     size_display;
         file_time       modified;
-        std::string     modified_display;
         file_perm       permissions;
-        std::string     permissions_display;
-        std::string     absolute_path;
         bool            is_directory{false};
         bool            is_block_file{false};
         bool            is_character_file{false};
@@ -38,28 +61,92 @@ namespace imc::backend {
         bool            is_symlink{false};
         bool            is_regular_file{false};
         bool            is_imaginary{false};
-        std::string get_column(int col_id) const
+
+        uint16_t flags() const;
+    };
+
+    using TableRowDataVector = std::vector<table_row_data_t>;
+
+    // A directory listing stored as columns: one contiguous array per field
+    // and one arena holding every file name, so the whole listing is a
+    // handful of allocations and gets freed in one go.
+    // Row i is name(i), ext(i), sizes[i], ... ; ext immediately follows the
+    // name in the arena so file_name(i) is the two together.
+    struct dir_snapshot_t
+    {
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        std::filesystem::path   directory;
+        std::vector<size_t>     ids;
+        std::vector<uint64_t>   sizes;
+        std::vector<file_time>  modified;
+        std::vector<file_perm>  permissions;
+        std::vector<uint16_t>   flags;
+        std::vector<uint32_t>   name_offsets;
+        std::vector<uint16_t>   name_lengths;
+        std::vector<uint16_t>   ext_lengths;
+        std::string             names;
+        size_t                  removed{0U};
+        // id -> index of its live row as an open addressing table, kept by
+        // push_back, update, remove and compact so find() doesn't have to look
+        // through the rows. A slot only holds the row index, the id is ids[row].
+        std::vector<uint32_t>   row_slots;
+        // slots that aren't empty, dead ones included
+        size_t                  row_slots_used{0U};
+
+        size_t size() const { return ids.size(); }
+        size_t live_size() const { return ids.size() - removed; }
+        void reserve(size_t count);
+
+        size_t push_back(const table_row_data_t& row);
+        // The row keeps its index, so whatever points at it stays valid.
+        void update(size_t index, const table_row_data_t& row);
+        void remove(size_t index);
+        void set_file_name(size_t index, std::string_view name, std::string_view ext);
+        // Drops removed rows, remap[old index] is the new index (or npos).
+        std::vector<uint32_t> compact();
+
+        bool has(size_t index, uint16_t flag) const { return (flags[index] & flag) != 0; }
+        bool is_directory(size_t index) const { return has(index, entry_flags::Directory); }
+        bool is_imaginary(size_t index) const { return has(index, entry_flags::Imaginary); }
+        bool is_removed(size_t index) const { return has(index, entry_flags::Removed); }
+
+        std::string_view name(size_t index) const
+        {
+            return std::string_view(names).substr(name_offsets[index], name_lengths[index]);
+        }
+        std::string_view ext(size_t index) const
         {
-            switch(col_id)
-            {
-                using namespace sortable_columns;
-                case Name:
-                    return name;
-                case Ext:
-                    return ext;
-                case Size:
-                    return size_display;
-                case Modified:
-                    return modified_display;
-                case Permissions:
-                    return permissions_display;
-                default:
-                    return "";
-            }
+            return std::string_view(names).substr(name_offsets[index] + name_lengths[index], ext_lengths[index]);
         }
+        std::string_view file_name(size_t index) const
+        {
+            return std::string_view(names).substr(name_offsets[index], name_lengths[index] + ext_lengths[index]);
+        }
+        std::filesystem::path absolute_path(size_t index) const;
+
+        size_t find(size_t id) const;
+        // Bytes held by the snapshot, capacity included.
+        size_t memory_usage() const;
+
+    private:
+        void index_row(size_t index);
+        void unindex_row(size_t index);
+        void rehash(size_t count);
     };
 
-    using TableRowData = std::unique_ptr<table_row_data_t>;
-    using TableRowDataVector = std::vector<TableRowData>;
-    using TableRowDataVectorPtr = std::shared_ptr<TableRowDataVector>;
-}
\ No newline at end of file
+    using DirSnapshotPtr = std::shared_ptr<dir_snapshot_t>;
+
+    // Changes between two listings of the same directory, rows are keyed by id.
+    struct table_delta_t
+    {
+        TableRowDataVector  added;
+        TableRowDataVector  modified;
+        std::vector<size_t> removed;
+
+        bool empty() const
+        {
+            return added.empty() && modified.empty() && removed.empty();
+        }
+    };
+}
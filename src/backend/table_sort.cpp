@@ -0,0 +1,304 @@
+#include "table_sort.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace imc::backend;
+
+namespace {
+
+//below this a single thread sorts the names faster than starting the others
+constexpr size_t parallel_sort_threshold = 64 * 1024;
+//orderings kept per snapshot, one per column and direction covers the usual clicking around
+constexpr size_t max_cached_orderings = 10;
+
+char fold(char ch)
+{
+    return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+}
+
+//case insensitive (ascii only) and byte wise, so utf-8 names sort after ascii ones
+int fold_compare(std::string_view lhs, std::string_view rhs)
+{
+    const size_t len = std::min(lhs.size(), rhs.size());
+    for(size_t i = 0; i < len; i++) {
+        const auto l = static_cast<unsigned char>(fold(lhs[i]));
+        const auto r = static_cast<unsigned char>(fold(rhs[i]));
+        if (l != r)
+            return l < r ? -1 : +1;
+    }
+    if (lhs.size() == rhs.size())
+        return 0;
+    return lhs.size() < rhs.size() ? -1 : +1;
+}
+
+uint8_t type_rank(const dir_snapshot_t& data, size_t index, bool dirs_first)
+{
+    if (data.is_imaginary(index))
+        return 0;
+    if (dirs_first && data.is_directory(index))
+        return 1;
+    return 2;
+}
+
+bool size_known(const dir_snapshot_t& data, size_t index)
+{
+    return data.has(index, entry_flags::SizeKnown);
+}
+
+uint32_t perms_key(file_perm perms)
+{
+    //same order as comparing the rwx strings, a set bit sorts after '-'
+    return static_cast<uint32_t>(perms & file_perm::all);
+}
+
+uint64_t time_key(file_time time)
+{
+    //flip the sign bit so the signed tick count orders as unsigned
+    return static_cast<uint64_t>(time.time_since_epoch().count()) ^ (uint64_t{1} << 63);
+}
+
+//The rank of every row's folded string, rows with the same folded string get the same rank.
+//get(i) is the string of row i, only rows in rows are ranked.
+template<typename FNGet>
+void rank_strings(const std::vector<uint32_t>& rows, FNGet get, std::vector<uint32_t>& rank)
+{
+    //folding once up front turns every comparison into a memcmp
+    std::string folded;
+    {
+        size_t total = 0;
+        for(const auto row : rows)
+            total += get(row).size();
+        folded.reserve(total);
+    }
+    std::vector<uint32_t> start(rank.size(), 0), length(rank.size(), 0);
+    for(const auto row : rows) {
+        const auto s = get(row);
+        start[row] = static_cast<uint32_t>(folded.size());
+        length[row] = static_cast<uint32_t>(s.size());
+        for(const char ch : s)
+            folded.push_back(fold(ch));
+    }
+    auto folded_of = [&](uint32_t row) {
+        return std::string_view(folded).substr(start[row], length[row]);
+    };
+    auto less = [&](uint32_t lhs, uint32_t rhs) {
+        return folded_of(lhs) < folded_of(rhs);
+    };
+
+    std::vector<uint32_t> sorted(rows);
+    const size_t threads = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), 8);
+    if (sorted.size() < parallel_sort_threshold || threads < 2) {
+        std::sort(sorted.begin(), sorted.end(), less);
+    } else {
+        //sort equal slices on their own threads, then merge them pairwise
+        std::vector<std::ptrdiff_t> bounds(threads + 1);
+        for(size_t t = 0; t <= threads; t++)
+            bounds[t] = static_cast<std::ptrdiff_t>(sorted.size() * t / threads);
+        {
+            std::vector<std::jthread> workers;
+            for(size_t t = 0; t < threads; t++)
+                workers.emplace_back([&, t]() {
+                    std::sort(sorted.begin() + bounds[t], sorted.begin() + bounds[t + 1], less);
+                });
+        }
+        for(size_t width = 1; width < threads; width *= 2) {
+            std::vector<std::jthread> workers;
+            for(size_t t = 0; t + width < threads; t += 2 * width) {
+                const auto first = sorted.begin() + bounds[t];
+                const auto middle = sorted.begin() + bounds[t + width];
+                const auto last = sorted.begin() + bounds[std::min(t + 2 * width, threads)];
+                workers.emplace_back([=]() { std::inplace_merge(first, middle, last, less); });
+            }
+        }
+    }
+
+    uint32_t current = 0;
+    for(size_t i = 0; i < sorted.size(); i++) {
+        if (i > 0 && folded_of(sorted[i - 1]) != folded_of(sorted[i]))
+            current++;
+        rank[sorted[i]] = current;
+    }
+}
+
+//Stable LSD radix sort of order by keys[row], a byte at a time. Bytes that are
+//the same in every key don't change anything and are skipped.
+void radix_sort(std::vector<uint32_t>& order, const std::vector<uint64_t>& keys, std::vector<uint32_t>& scratch)
+{
+    if (order.size() < 2)
+        return;
+    uint64_t differs = 0;
+    const uint64_t first = keys[order[0]];
+    for(const auto row : order)
+        differs |= keys[row] ^ first;
+
+    scratch.resize(order.size());
+    for(int shift = 0; shift < 64; shift += 8) {
+        if (((differs >> shift) & 0xff) == 0)
+            continue;
+        std::array<size_t, 256> counts{};
+        for(const auto row : order)
+            counts[(keys[row] >> shift) & 0xff]++;
+        size_t sum = 0;
+        for(auto& count : counts) {
+            const size_t c = count;
+            count = sum;
+            sum += c;
+        }
+        for(const auto row : order)
+            scratch[counts[(keys[row] >> shift) & 0xff]++] = row;
+        order.swap(scratch);
+    }
+}
+
+}
+
+bool imc::backend::row_less(const dir_snapshot_t& data, const table_sort_specs_t& specs, uint32_t lhs, uint32_t rhs)
+{
+    const auto lhs_rank = type_rank(data, lhs, specs.dirs_first);
+    const auto rhs_rank = type_rank(data, rhs, specs.dirs_first);
+    if (lhs_rank != rhs_rank)
+        return lhs_rank < rhs_rank;
+    //within a rank either both or neither are directories when that matters
+    const bool by_name = specs.dirs_first && lhs_rank == 1;
+
+    for(const auto& spec : specs.columns) {
+        int delta = 0;
+        switch(spec.column) {
+            using namespace sortable_columns;
+            case Name:
+                delta = fold_compare(data.name(lhs), data.name(rhs));
+                break;
+            case Ext:
+                delta = by_name ? fold_compare(data.name(lhs), data.name(rhs)) : fold_compare(data.ext(lhs), data.ext(rhs));
+                break;
+            case Size:
+                //directories without a calculated size by name, ahead of the ones with one
+                if (by_name && size_known(data, lhs) != size_known(data, rhs))
+                    delta = size_known(data, lhs) ? +1 : -1;
+                else if (by_name && !size_known(data, lhs))
+                    delta = fold_compare(data.name(lhs), data.name(rhs));
+                else if (data.sizes[lhs] != data.sizes[rhs])
+                    delta = data.sizes[lhs] < data.sizes[rhs] ? -1 : +1;
+                break;
+            case Modified:
+                if (data.modified[lhs] != data.modified[rhs])
+                    delta = data.modified[lhs] < data.modified[rhs] ? -1 : +1;
+                break;
+            case Permissions:
+                if (perms_key(data.permissions[lhs]) != perms_key(data.permissions[rhs]))
+                    delta = perms_key(data.permissions[lhs]) < perms_key(data.permissions[rhs]) ? -1 : +1;
+                break;
+            default:
+                break;
+        }
+        if (delta != 0)
+            return spec.ascending ? delta < 0 : delta > 0;
+    }
+    if (const int delta = fold_compare(data.name(lhs), data.name(rhs)); delta != 0)
+        return delta < 0;
+    return lhs < rhs;
+}
+
+void imc::backend::table_sorter_t::invalidate()
+{
+    keys_valid_ = false;
+    orderings_.clear();
+}
+
+size_t imc::backend::table_sorter_t::memory_usage() const
+{
+    size_t memory = sizeof(*this) +
+        type_rank_.capacity() * sizeof(uint8_t) +
+        name_rank_.capacity() * sizeof(uint32_t) +
+        ext_rank_.capacity() * sizeof(uint32_t);
+    for(const auto& [specs, order] : orderings_)
+        memory += order.capacity() * sizeof(uint32_t);
+    return memory;
+}
+
+void imc::backend::table_sorter_t::build_keys(const dir_snapshot_t& data)
+{
+    std::vector<uint32_t> live;
+    live.reserve(data.live_size());
+    for(size_t i = 0; i < data.size(); i++) {
+        if (!data.is_removed(i))
+            live.push_back(static_cast<uint32_t>(i));
+    }
+    name_rank_.assign(data.size(), 0);
+    ext_rank_.assign(data.size(), 0);
+    rank_strings(live, [&](uint32_t row) { return data.name(row); }, name_rank_);
+    rank_strings(live, [&](uint32_t row) { return data.ext(row); }, ext_rank_);
+    keys_valid_ = true;
+}
+
+//Directories with a calculated size rank by it, after the others (by name) in
+//ascending order, the top bit keeps the two apart.
+uint64_t imc::backend::table_sorter_t::size_key(const dir_snapshot_t& data, size_t index) const
+{
+    if (!size_known(data, index))
+        return name_rank_[index];
+    return (uint64_t{1} << 63) | data.sizes[index];
+}
+
+void imc::backend::table_sorter_t::column_keys(const dir_snapshot_t& data, const table_sort_specs_t& specs, const sort_spec_t& spec, std::vector<uint64_t>& keys) const
+{
+    keys.resize(data.size());
+    for(size_t i = 0; i < data.size(); i++) {
+        //directories sort by name under the columns they have no value for
+        const bool by_name = specs.dirs_first && data.is_directory(i) && !data.is_imaginary(i);
+        uint64_t key = 0;
+        switch(spec.column) {
+            using namespace sortable_columns;
+            case Name: key = name_rank_[i]; break;
+            case Ext: key = by_name ? name_rank_[i] : ext_rank_[i]; break;
+            case Size: key = by_name ? size_key(data, i) : data.sizes[i]; break;
+            case Modified: key = time_key(data.modified[i]); break;
+            case Permissions: key = perms_key(data.permissions[i]); break;
+            default: break;
+        }
+        keys[i] = spec.ascending ? key : ~key;
+    }
+}
+
+const std::vector<uint32_t>& imc::backend::table_sorter_t::sorted(const dir_snapshot_t& data, const table_sort_specs_t& specs)
+{
+    for(const auto& [cached_specs, order] : orderings_) {
+        if (cached_specs == specs)
+            return order;
+    }
+
+    if (!keys_valid_)
+        build_keys(data);
+
+    std::vector<uint32_t> order;
+    order.reserve(data.live_size());
+    for(size_t i = 0; i < data.size(); i++) {
+        if (!data.is_removed(i))
+            order.push_back(static_cast<uint32_t>(i));
+    }
+
+    //least significant first: name, then the specs from last to first, then the type rank.
+    //every pass is stable so equal keys keep the order of the passes before.
+    std::vector<uint64_t> keys(data.size());
+    std::vector<uint32_t> scratch;
+    for(size_t i = 0; i < data.size(); i++)
+        keys[i] = name_rank_[i];
+    radix_sort(order, keys, scratch);
+    for(auto spec = specs.columns.rbegin(); spec != specs.columns.rend(); ++spec) {
+        column_keys(data, specs, *spec, keys);
+        radix_sort(order, keys, scratch);
+    }
+    for(size_t i = 0; i < data.size(); i++)
+        keys[i] = type_rank(data, i, specs.dirs_first);
+    radix_sort(order, keys, scratch);
+
+    if (orderings_.size() >= max_cached_orderings)
+        orderings_.erase(orderings_.begin());
+    orderings_.emplace_back(specs, std::move(order));
+    return orderings_.back().second;
+}
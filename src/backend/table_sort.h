@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "table_data.h"
+
+namespace imc::backend {
+
+    struct sort_spec_t
+    {
+        int     column{sortable_columns::Name};
+        bool    ascending{true};
+        bool operator==(const sort_spec_t&) const = default;
+    };
+
+    struct table_sort_specs_t
+    {
+        std::vector<sort_spec_t> columns;
+        // ".." always comes first, this keeps directories right after it.
+        bool dirs_first{true};
+        bool operator==(const table_sort_specs_t&) const = default;
+    };
+
+    // The order sorted() produces, for merging a handful of rows into it.
+    bool row_less(const dir_snapshot_t& data, const table_sort_specs_t& specs, uint32_t lhs, uint32_t rhs);
+
+    // Sorts the rows of one snapshot. The keys (case folded name/ext ranks,
+    // type rank) are computed once, every ordering is a few stable radix
+    // passes over integer keys and is kept per spec, so going back to a
+    // column is a lookup. invalidate() when the snapshot's rows change.
+    class table_sorter_t
+    {
+    public:
+        void invalidate();
+        // Live rows of data in the order specs asks for, valid until the next call.
+        const std::vector<uint32_t>& sorted(const dir_snapshot_t& data, const table_sort_specs_t& specs);
+        // Bytes held by the keys and the kept orderings.
+        size_t memory_usage() const;
+
+    private:
+        void build_keys(const dir_snapshot_t& data);
+        void column_keys(const dir_snapshot_t& data, const table_sort_specs_t& specs, const sort_spec_t& spec, std::vector<uint64_t>& keys) const;
+        uint64_t size_key(const dir_snapshot_t& data, size_t index) const;
+
+        //0 for "..", 1 for directories (when they go first), 2 for the rest
+        std::vector<uint8_t>    type_rank_;
+        //position of the case folded name/extension among all of them, equal names share one
+        std::vector<uint32_t>   name_rank_;
+        std::vector<uint32_t>   ext_rank_;
+        bool                    keys_valid_{false};
+        std::vector<std::pair<table_sort_specs_t, std::vector<uint32_t>>> orderings_;
+    };
+}
@@ -0,0 +1,210 @@
+#include "text_search.h"
+
+#include "mapped_file.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    constexpr size_t offsets_per_block = 4096;
+    //how far a single search may run before the stop token is looked at again
+    constexpr size_t scan_chunk_size = 16 * 1024 * 1024;
+    constexpr size_t npos = std::string_view::npos;
+    //how far ahead the two cursors of a case insensitive search look at first, and at most
+    constexpr size_t min_window = 256;
+    constexpr size_t max_window = 64 * 1024;
+
+    constexpr unsigned char to_lower(unsigned char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+    }
+
+    constexpr bool is_letter(unsigned char c)
+    {
+        return to_lower(c) >= 'a' && to_lower(c) <= 'z';
+    }
+
+    constexpr std::array<unsigned char, 256> lower_table = []() {
+        std::array<unsigned char, 256> table{};
+        for(size_t i = 0; i < 256; i++)
+            table[i] = to_lower(static_cast<unsigned char>(i));
+        return table;
+    }();
+
+    //roughly how rare a byte is in text and logs, higher is rarer: the
+    //rarer the byte memchr looks for, the fewer candidates to compare
+    constexpr std::array<unsigned char, 256> rarity = []() {
+        std::array<unsigned char, 256> table{};
+        for(size_t i = 0; i < 256; i++)
+            table[i] = (i < 0x20 || i >= 0x7f) ? 200 : 150;
+        constexpr char common_punctuation[] = "\n\t.,:;/-_=\"'()[]";
+        for(char c : common_punctuation)
+            table[static_cast<unsigned char>(c)] = 100;
+        for(char c = '0'; c <= '9'; c++)
+            table[static_cast<unsigned char>(c)] = 80;
+        constexpr char by_frequency[] = "etaoinshrdlcumwfgypbvkjxqz";
+        for(size_t i = 0; i < 26; i++) {
+            table[static_cast<unsigned char>(by_frequency[i])] = static_cast<unsigned char>(10 + i);
+            table[static_cast<unsigned char>(by_frequency[i] - 'a' + 'A')] = static_cast<unsigned char>(40 + i);
+        }
+        table[' '] = 0;
+        return table;
+    }();
+}
+
+imc::backend::text_finder_t::text_finder_t(std::string_view needle, bool ignore_case)
+: needle_(needle)
+, ignore_case_(ignore_case)
+{
+    if (ignore_case_) {
+        for(auto& c : needle_)
+            c = static_cast<char>(lower_table[static_cast<unsigned char>(c)]);
+    }
+    int best = -1;
+    for(size_t i = 0; i < needle_.size(); i++) {
+        const auto c = static_cast<unsigned char>(needle_[i]);
+        //a letter in both cases takes two scans, half as good
+        const int score = (ignore_case_ && is_letter(c)) ? rarity[c] / 2 : rarity[c];
+        if (score > best) {
+            best = score;
+            filter_pos_ = i;
+        }
+    }
+    if (!needle_.empty()) {
+        const auto c = static_cast<unsigned char>(needle_[filter_pos_]);
+        filter_[0] = static_cast<char>(c);
+        filter_[1] = (ignore_case_ && is_letter(c)) ? static_cast<char>(c - 'a' + 'A') : static_cast<char>(c);
+    }
+}
+
+bool imc::backend::text_finder_t::matches(const char* at) const
+{
+    if (!ignore_case_)
+        return memcmp(at, needle_.data(), needle_.size()) == 0;
+    const auto* text = reinterpret_cast<const unsigned char*>(at);
+    const auto* needle = reinterpret_cast<const unsigned char*>(needle_.data());
+    for(size_t i = 0; i < needle_.size(); i++) {
+        if (lower_table[text[i]] != needle[i])
+            return false;
+    }
+    return true;
+}
+
+size_t imc::backend::text_finder_t::find(std::string_view data, size_t from) const
+{
+    const size_t n = needle_.size();
+    if (n == 0 || data.size() < n || from > data.size() - n)
+        return npos;
+    //the filter byte of a candidate starting at pos is at pos + filter_pos_
+    const char* begin = data.data();
+    const char* cursor = begin + from + filter_pos_;
+    const char* end = begin + (data.size() - n) + filter_pos_ + 1;
+
+    auto scan = [](const char* at, const char* to, char c) {
+        const auto* hit = static_cast<const char*>(memchr(at, c, static_cast<size_t>(to - at)));
+        return hit ? hit : to;
+    };
+    if (filter_[0] == filter_[1]) {
+        for(const char* hit = scan(cursor, end, filter_[0]); hit != end; hit = scan(hit + 1, end, filter_[0])) {
+            if (matches(hit - filter_pos_))
+                return static_cast<size_t>(hit - filter_pos_ - begin);
+        }
+        return npos;
+    }
+    //one cursor per case, only the one that was used up moves on. Both
+    //look no further than a window that doubles as long as nothing is
+    //found: a case that never occurs mustn't be looked for up to the end
+    //of the data on every call
+    for(size_t window = min_window; cursor < end; window = std::min(window * 2, max_window)) {
+        const char* window_end = end - cursor > static_cast<ptrdiff_t>(window) ? cursor + window : end;
+        const char* lower = scan(cursor, window_end, filter_[0]);
+        const char* upper = scan(cursor, window_end, filter_[1]);
+        while (lower != window_end || upper != window_end) {
+            const char* hit = std::min(lower, upper);
+            if (matches(hit - filter_pos_))
+                return static_cast<size_t>(hit - filter_pos_ - begin);
+            if (hit == lower)
+                lower = scan(hit + 1, window_end, filter_[0]);
+            else
+                upper = scan(hit + 1, window_end, filter_[1]);
+        }
+        cursor = window_end;
+    }
+    return npos;
+}
+
+imc::backend::match_index_t::match_index_t(std::string_view data, std::string_view needle, bool ignore_case)
+: data_(data)
+, finder_(needle, ignore_case)
+, blocks_(max_stored_matches / offsets_per_block)
+{
+    start();
+}
+
+imc::backend::match_index_t::~match_index_t()
+{
+    //before the blocks go
+    stop();
+}
+
+void imc::backend::match_index_t::start()
+{
+    done_.store(false, std::memory_order_release);
+    worker_ = std::jthread([this](std::stop_token stop) { search(stop); });
+}
+
+void imc::backend::match_index_t::stop()
+{
+    worker_ = {};
+}
+
+void imc::backend::match_index_t::extend(std::string_view data)
+{
+    stop();
+    data_ = data;
+    start();
+}
+
+uint64_t imc::backend::match_index_t::offset(size_t n) const
+{
+    return blocks_[n / offsets_per_block][n % offsets_per_block];
+}
+
+void imc::backend::match_index_t::search(std::stop_token stop)
+{
+    const size_t n = finder_.size();
+    size_t count = count_.load(std::memory_order_relaxed);
+    size_t pos = scanned_;
+    while (n > 0 && pos + n <= data_.size()) {
+        if (stop.stop_requested()) {
+            scanned_ = pos;
+            return;
+        }
+        //a match has to start in this chunk, it may end past it
+        const size_t chunk_end = std::min(data_.size(), pos + scan_chunk_size + n - 1);
+        const auto chunk = data_.substr(0, chunk_end);
+        //a truncated file ends the search, the matches found so far still count
+        const bool read = guarded_read([&]() {
+            for(size_t hit = finder_.find(chunk, pos); hit != npos; hit = finder_.find(chunk, hit + n)) {
+                if (count < max_stored_matches) {
+                    auto& block = blocks_[count / offsets_per_block];
+                    if (!block)
+                        block = std::make_unique<uint64_t[]>(offsets_per_block);
+                    block[count % offsets_per_block] = hit;
+                }
+                //the offset is written before anyone can see it
+                count_.store(++count, std::memory_order_release);
+                pos = hit + n;
+            }
+        });
+        if (!read) {
+            scanned_ = pos;
+            truncated_.store(true, std::memory_order_release);
+            return;
+        }
+        pos = std::max(pos, chunk_end - n + 1);
+    }
+    scanned_ = pos;
+    done_.store(true, std::memory_order_release);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace imc::backend {
+
+    // Finds a fixed string in a text. Candidates are found with memchr for
+    // the needle's least common byte (vectorised by the C library), only
+    // those get compared in full. Ignoring case is ASCII only: a letter is
+    // looked for in both cases with two memchr cursors.
+    class text_finder_t
+    {
+    public:
+        text_finder_t(std::string_view needle, bool ignore_case);
+
+        // Where the needle starts at or after from, npos if it doesn't.
+        // An empty needle is never found.
+        size_t find(std::string_view data, size_t from = 0) const;
+        size_t size() const { return needle_.size(); }
+
+    private:
+        bool matches(const char* at) const;
+
+        std::string needle_;
+        bool        ignore_case_;
+        // the byte memchr looks for (in both cases) and where it is in the needle
+        size_t      filter_pos_{0U};
+        char        filter_[2]{};
+    };
+
+    // Offsets of every match of a needle in a (mapped) text, found on a
+    // background thread so the first one can be shown while the rest is
+    // still searched. Offsets live in fixed blocks behind a table sized up
+    // front, read without a lock like line_index_t's checkpoints; past
+    // max_stored_matches they are only counted. The text is read under
+    // guarded_read(), a truncated file stops the search.
+    class match_index_t
+    {
+    public:
+        static constexpr size_t max_stored_matches = 16 * 1024 * 1024;
+
+        // Starts searching right away, data has to outlive the index.
+        match_index_t(std::string_view data, std::string_view needle, bool ignore_case);
+        ~match_index_t();
+        match_index_t(const match_index_t&) = delete;
+        match_index_t& operator=(const match_index_t&) = delete;
+
+        // Matches found so far, all of them once done.
+        size_t count() const { return count_.load(std::memory_order_acquire); }
+        // Matches that can be looked up, at most max_stored_matches.
+        size_t stored() const { return std::min(count(), max_stored_matches); }
+        bool done() const { return done_.load(std::memory_order_acquire); }
+        // The text shrank under the worker (a truncated file), it gave up.
+        bool truncated() const { return truncated_.load(std::memory_order_acquire); }
+        // Offset of match n < stored(), in order.
+        uint64_t offset(size_t n) const;
+        size_t needle_size() const { return finder_.size(); }
+        // Stops searching, needed before the data moves (a mapping that grows).
+        void stop();
+        // data is the same text with more behind it: only the new part is searched.
+        void extend(std::string_view data);
+
+    private:
+        void start();
+        void search(std::stop_token stop);
+
+        std::string_view                        data_;
+        text_finder_t                           finder_;
+        std::vector<std::unique_ptr<uint64_t[]>> blocks_;
+        std::atomic<size_t>                     count_{0U};
+        // first offset a match may start at that wasn't looked at yet
+        size_t                                  scanned_{0U};
+        std::atomic_bool                        done_{false};
+        std::atomic_bool                        truncated_{false};
+        std::jthread                            worker_;
+    };
+}
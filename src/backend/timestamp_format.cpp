@@ -0,0 +1,188 @@
+#include "timestamp_format.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+#include <fmt/format.h>
+#include <fmt/chrono.h>
+
+#ifndef _IMC_MAC
+#include <date/tz.h>
+#endif
+
+using namespace imc::backend;
+
+namespace {
+
+//"00" to "99", two characters each
+constexpr auto two_digits = [] {
+    std::array<char, 200> digits{};
+    for(int i = 0; i < 100; i++) {
+        digits[i * 2] = static_cast<char>('0' + i / 10);
+        digits[i * 2 + 1] = static_cast<char>('0' + i % 10);
+    }
+    return digits;
+}();
+
+void put_two_digits(std::string& text, uint32_t offset, unsigned value)
+{
+    text[offset] = two_digits[value * 2];
+    text[offset + 1] = two_digits[value * 2 + 1];
+}
+
+//0 for the ones left to date::format
+size_t field_width(char spec)
+{
+    switch (spec) {
+    case 'Y':
+        return 4;
+    case 'y': case 'm': case 'd': case 'H': case 'I': case 'M': case 'S': case 'p':
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+bool is_time_field(char spec)
+{
+    return spec == 'H' || spec == 'I' || spec == 'M' || spec == 'S' || spec == 'p';
+}
+
+#ifndef _IMC_MAC
+//looked up once, a zone changed while we run shows after a restart
+const date::time_zone* local_zone()
+{
+    static const auto* zone = date::current_zone();
+    return zone;
+}
+#endif
+
+}
+
+imc::backend::timestamp_formatter_t::timestamp_formatter_t(std::string_view format)
+: format_(format)
+{
+    for(size_t i = 0; i < format_.size(); i++) {
+        if (format_[i] != '%' || i + 1 == format_.size()) {
+            pattern_ += format_[i];
+            continue;
+        }
+        const char spec = format_[++i];
+        if (spec == '%') {
+            pattern_ += '%';
+            continue;
+        }
+        const size_t width = field_width(spec);
+        if (width == 0) {
+            fast_ = false;
+            continue;
+        }
+        auto& fields = is_time_field(spec) ? time_fields_ : date_fields_;
+        fields.push_back({ spec, static_cast<uint32_t>(pattern_.size()) });
+        pattern_.append(width, ' ');
+    }
+}
+
+std::string imc::backend::timestamp_formatter_t::operator()(file_time time)
+{
+    using namespace std::chrono;
+    if (!fast_)
+        return format_slow(time);
+    const auto utc = floor<seconds>(file_clock::to_sys(time));
+    const auto local = local_seconds((utc + utc_offset(utc)).time_since_epoch());
+    const auto day = floor<days>(local);
+    auto text = day_text(day);
+    //a year that doesn't fit in four digits
+    if (text.empty())
+        return format_slow(time);
+    const hh_mm_ss tod(local - day);
+    const auto hour = static_cast<unsigned>(tod.hours().count());
+    for(const auto& field : time_fields_) {
+        switch (field.spec) {
+        case 'H':
+            put_two_digits(text, field.offset, hour);
+            break;
+        case 'I':
+            put_two_digits(text, field.offset, hour % 12 == 0 ? 12 : hour % 12);
+            break;
+        case 'M':
+            put_two_digits(text, field.offset, static_cast<unsigned>(tod.minutes().count()));
+            break;
+        case 'S':
+            put_two_digits(text, field.offset, static_cast<unsigned>(tod.seconds().count()));
+            break;
+        case 'p':
+            text[field.offset] = hour < 12 ? 'A' : 'P';
+            text[field.offset + 1] = 'M';
+            break;
+        }
+    }
+    return text;
+}
+
+std::chrono::seconds imc::backend::timestamp_formatter_t::utc_offset(std::chrono::sys_seconds time)
+{
+#ifdef _IMC_MAC
+    //for now utc only on macs..
+    (void)time;
+    return std::chrono::seconds(0);
+#else
+    auto it = std::upper_bound(periods_.begin(), periods_.end(), time, [](std::chrono::sys_seconds t, const period_t& period) {
+        return t < period.begin;
+    });
+    if (it != periods_.begin() && time < std::prev(it)->end)
+        return std::prev(it)->offset;
+    if (periods_.size() >= max_periods) {
+        periods_.clear();
+        it = periods_.end();
+    }
+    const auto info = local_zone()->get_info(time);
+    periods_.insert(it, { info.begin, info.end, info.offset });
+    return info.offset;
+#endif
+}
+
+const std::string& imc::backend::timestamp_formatter_t::day_text(std::chrono::local_days day)
+{
+    const auto key = static_cast<int32_t>(day.time_since_epoch().count());
+    if (const auto it = days_.find(key); it != days_.end())
+        return it->second;
+    if (days_.size() >= max_days)
+        days_.clear();
+    auto& text = days_[key];
+    const std::chrono::year_month_day ymd(day);
+    const int year = static_cast<int>(ymd.year());
+    //left empty, the caller formats those the slow way
+    if (year < 0 || year > 9999)
+        return text;
+    text = pattern_;
+    for(const auto& field : date_fields_) {
+        switch (field.spec) {
+        case 'Y':
+            put_two_digits(text, field.offset, static_cast<unsigned>(year / 100));
+            put_two_digits(text, field.offset + 2, static_cast<unsigned>(year % 100));
+            break;
+        case 'y':
+            put_two_digits(text, field.offset, static_cast<unsigned>(year % 100));
+            break;
+        case 'm':
+            put_two_digits(text, field.offset, static_cast<unsigned>(ymd.month()));
+            break;
+        case 'd':
+            put_two_digits(text, field.offset, static_cast<unsigned>(ymd.day()));
+            break;
+        }
+    }
+    return text;
+}
+
+std::string imc::backend::timestamp_formatter_t::format_slow(file_time time) const
+{
+    const auto utc = std::chrono::floor<std::chrono::seconds>(std::chrono::file_clock::to_sys(time));
+#ifdef _IMC_MAC
+    return fmt::format(fmt::runtime("{:" + format_ + "}"), utc);
+#else
+    return date::format(format_.c_str(), date::make_zoned(local_zone(), utc));
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "table_data.h"
+
+namespace imc::backend {
+
+    // Formats file times in the local time zone, strftime style, for the
+    // Modified column. The zone is looked up once and the periods of its
+    // utc offsets are kept as they come up, the date part of the text is
+    // made once per day and the time of day is written into a copy of it
+    // from a digit table. %Y %y %m %d %H %I %M %S %p and %% are done that
+    // way, a format with anything else goes through date::format.
+    // Not thread safe.
+    class timestamp_formatter_t
+    {
+    public:
+        static constexpr std::string_view default_format = "%m-%d-%y %I:%M %p";
+
+        explicit timestamp_formatter_t(std::string_view format = default_format);
+
+        const std::string& format() const { return format_; }
+        std::string operator()(file_time time);
+
+    private:
+        struct field_t
+        {
+            char        spec;
+            uint32_t    offset;
+        };
+
+        // one utc offset of the zone, from begin up to end
+        struct period_t
+        {
+            std::chrono::sys_seconds    begin;
+            std::chrono::sys_seconds    end;
+            std::chrono::seconds        offset;
+        };
+
+        // Past these many days or periods they are dropped all at once.
+        static constexpr size_t max_days = 4096;
+        static constexpr size_t max_periods = 1024;
+
+        std::chrono::seconds utc_offset(std::chrono::sys_seconds time);
+        const std::string& day_text(std::chrono::local_days day);
+        std::string format_slow(file_time time) const;
+
+        std::string                             format_;
+        // the text of the format, with room for every field
+        std::string                             pattern_;
+        std::vector<field_t>                    date_fields_;
+        std::vector<field_t>                    time_fields_;
+        bool                                    fast_{true};
+        // sorted by begin, they don't overlap
+        std::vector<period_t>                   periods_;
+        std::unordered_map<int32_t, std::string> days_;
+    };
+}
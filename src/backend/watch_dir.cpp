@@ -1,157 +1,566 @@
 #include "watch_dir.h"
+#include "io_executor.h"
+#include "list_dir.h"
 
 #include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include <filesystem>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <chrono>
+#include <utility>
 
-#include <fmt/format.h>
-#include <fmt/chrono.h>
-
-#ifndef _IMC_MAC
-#include <date/tz.h>
+#ifdef _IMC_NIX
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+#ifdef _IMC_MAC
+#include <sys/mount.h>
+#include <sys/param.h>
 #endif
-
-#include "utils/string_utils.h"
 
 using namespace std::chrono_literals;
 
 namespace {
 
 using namespace imc::backend;
-using namespace imc::string_utils;
 
-std::string permissions_to_string(fs::perms p)
-{
-    return fmt::format("{}{}{}{}{}{}{}{}{}",
-        ((p & fs::perms::owner_read) != fs::perms::none ? "r" : "-"),
-        ((p & fs::perms::owner_write) != fs::perms::none ? "w" : "-"),
-        ((p & fs::perms::owner_exec) != fs::perms::none ? "x" : "-"),
-        ((p & fs::perms::group_read) != fs::perms::none ? "r" : "-"),
-        ((p & fs::perms::group_write) != fs::perms::none ? "w" : "-"),
-        ((p & fs::perms::group_exec) != fs::perms::none ? "x" : "-"),
-        ((p & fs::perms::others_read) != fs::perms::none ? "r" : "-"),
-        ((p & fs::perms::others_write) != fs::perms::none ? "w" : "-"),
-        ((p & fs::perms::others_exec) != fs::perms::none ? "x" : "-")
-    );
-}
+//how long the directory has to stay quiet before we rescan it
+constexpr auto settle_time = 50ms;
+//upper bound on how long a steady stream of events can delay a rescan
+constexpr auto max_settle_time = 250ms;
+constexpr auto poll_interval = 1000ms;
+//on a network file system the directory's own times are looked at, at first
+//this often and less often the longer they stay the same
+constexpr auto remote_poll_min = 1000ms;
+constexpr auto remote_poll_max = 10000ms;
+//a file rewritten in place doesn't touch the directory, its entries get a look this often anyway
+constexpr auto remote_full_pass = 120000ms;
 
-TableRowData create_imaginary_up_dir()
+table_row_data_t create_imaginary_up_dir()
 {
     table_row_data_t row_data;
-    row_data.absolute_path = "..";
     row_data.name = "..";
     row_data.is_imaginary = true;
     row_data.is_directory = true;
     row_data.ext = "";
-    row_data.size_display = fmt::format("{:>10}", "<DIR>");
-    row_data.id = std::hash<std::string>{}(row_data.absolute_path);
-    return std::make_unique<table_row_data_t>(row_data);
+    row_data.id = entry_id("..");
+    return row_data;
 }
 
-std::tuple<size_t, std::vector<fs::directory_entry>> hash_dir(const fs::path& cur)
+//any of these changing shall cause the row to be rebuilt.
+dir_state_t::stamp_t row_stamp(const table_row_data_t& row)
 {
-    std::vector<fs::directory_entry> entries;
-    entries.reserve(2048);
-    size_t newHash = 0ULL;
-    std::error_code ec;
-    for(const auto& entry : fs::directory_iterator(cur)) {
-        //any of these items below shall cause a reload.
-        auto rowid = fs::hash_value(entry.path());
-        newHash ^= (rowid << 1);
-        if (size_t sz = entry.file_size(ec); !ec)
-            newHash ^= (sz << 1);
-        if (auto file_time = entry.last_write_time(ec); !ec)
-            newHash ^= (file_time.time_since_epoch().count() << 1);
-        entries.push_back(entry);
+    dir_state_t::stamp_t stamp;
+    stamp.size = row.size;
+    stamp.modified = row.modified.time_since_epoch().count();
+    stamp.is_directory = row.is_directory;
+    return stamp;
+}
+
+}
+
+imc::backend::dir_state_t imc::backend::dir_state_of(const dir_snapshot_t& listing)
+{
+    dir_state_t state;
+    state.entries.reserve(listing.live_size());
+    for(size_t i = 0; i < listing.size(); i++) {
+        if (listing.is_removed(i) || listing.is_imaginary(i))
+            continue;
+        dir_state_t::stamp_t stamp;
+        //list_dir has no size for directories, a calculated one isn't a change
+        stamp.size = listing.has(i, entry_flags::SizeKnown) ? 0U : listing.sizes[i];
+        stamp.modified = listing.modified[i].time_since_epoch().count();
+        stamp.is_directory = listing.is_directory(i);
+        state.entries.emplace(listing.ids[i], stamp);
     }
-    return std::make_tuple(newHash, entries);
+    state.loaded = true;
+    state.stale = true;
+    return state;
 }
 
-TableRowData entry_to_table_row(const fs::directory_entry& entry)
+imc::backend::DirSnapshotPtr imc::backend::empty_listing(const fs::path& cur)
 {
-    table_row_data_t row_data;
-    std::error_code ec;
-    row_data.name = entry.path().stem().generic_string();
-    row_data.is_regular_file = entry.is_regular_file();
-    row_data.is_directory = entry.is_directory();
-    row_data.is_block_file = entry.is_block_file();
-    row_data.is_character_file = entry.is_character_file();
-    row_data.is_fifo = entry.is_fifo();
-    row_data.is_other = entry.is_other();
-    row_data.is_socket = entry.is_socket();
-    row_data.is_symlink = entry.is_symlink();
-    row_data.size = 0U;
-    if (entry.is_directory())
-    {
-        row_data.ext = "";
-        if (entry.path().has_extension())
-            row_data.name += entry.path().extension();
-
-        row_data.size_display = fmt::format("{:>10}", "<DIR>");
-    } else {
-        row_data.ext = entry.path().extension().generic_string();
-        if (size_t try_size = entry.file_size(ec); !ec) {
-            row_data.size = try_size;
+    auto data = std::make_shared<dir_snapshot_t>();
+    data->directory = cur;
+    if (cur.has_parent_path())
+        data->push_back(create_imaginary_up_dir());
+    return data;
+}
+
+imc::backend::DirSnapshotPtr imc::backend::read_listing(const fs::path& cur, std::stop_token stop)
+{
+    auto data = std::make_shared<dir_snapshot_t>();
+    data->directory = cur;
+    data->reserve(2048);
+    if (cur.has_parent_path())
+        data->push_back(create_imaginary_up_dir());
+    auto ec = list_dir(cur, [&](const table_row_data_t& row) {
+        data->push_back(row);
+    }, stop);
+    return ec ? nullptr : data;
+}
+
+int imc::backend::watch_dir(const fs::path& cur, dir_state_t& state, FNUpdate callback, FNDelta deltaCallback, FNError errorCallback, std::stop_token stop)
+{
+    if (!state.loaded) {
+        auto data = std::make_shared<dir_snapshot_t>();
+        data->directory = cur;
+        data->reserve(2048);
+        if (cur.has_parent_path())
+            data->push_back(create_imaginary_up_dir());
+
+        auto ec = list_dir(cur, [&](const table_row_data_t& row) {
+            state.entries.emplace(row.id, row_stamp(row));
+            data->push_back(row);
+        }, stop);
+        if (ec == std::errc::operation_canceled) {
+            state.entries.clear();
+            return 1;
         }
-        row_data.size_display = size_to_display(row_data.size);
+        if (ec) {
+            errorCallback(error_message_t(ec.message(), 5000ms));
+            return 1;
+        }
+        state.loaded = true;
+        callback(std::move(data));
+        return 0;
+    }
+
+    //only rows that are new or changed get copied out, everything we didn't see again is gone.
+    table_delta_t delta;
+    decltype(state.entries) seen;
+    seen.reserve(state.entries.size());
+    auto ec = list_dir(cur, [&](const table_row_data_t& row) {
+        auto stamp = row_stamp(row);
+        if (auto old = state.entries.find(row.id); old == state.entries.end()) {
+            delta.added.push_back(row);
+        } else if (old->second != stamp) {
+            delta.modified.push_back(row);
+        }
+        seen.emplace(row.id, stamp);
+    }, stop);
+    if (ec == std::errc::operation_canceled)
+        return 1;
+    if (ec) {
+        errorCallback(error_message_t(ec.message(), 5000ms));
+        return 1;
     }
-    if (entry.is_symlink()) {
-        if (auto try_last_write_time = fs::directory_entry(fs::read_symlink(entry.path())).last_write_time(ec); !ec) {
-            row_data.modified = try_last_write_time;
+    for(const auto& [id, stamp] : state.entries) {
+        if (!seen.contains(id))
+            delta.removed.push_back(id);
+    }
+    state.entries = std::move(seen);
+
+    if (!delta.empty())
+        deltaCallback(std::move(delta));
+
+    return 0;
+}
+
+int imc::backend::watch_dir_entries(const fs::path& cur, const std::vector<std::string>& names, dir_state_t& state, FNDelta deltaCallback, FNError errorCallback, std::stop_token stop)
+{
+    table_delta_t delta;
+    table_row_data_t row;
+    std::error_code ec;
+    std::error_code failed;
+    for(const auto& name : names) {
+        //the watcher is gone, nobody wants the delta
+        if (stop.stop_requested())
+            return 1;
+        const auto id = entry_id(name);
+        const auto old = state.entries.find(id);
+        if (!stat_entry(cur, name, row, ec)) {
+            //only gone if nothing is there by that name, otherwise the row stays as it was
+            if (ec != std::errc::no_such_file_or_directory && ec != std::errc::not_a_directory) {
+                failed = ec;
+            } else if (old != state.entries.end()) {
+                delta.removed.push_back(id);
+                state.entries.erase(old);
+            }
+            continue;
         }
-    } else {
-        if (auto try_last_write_time = entry.last_write_time(ec); !ec) {
-            row_data.modified = try_last_write_time;
+        auto stamp = row_stamp(row);
+        if (old == state.entries.end()) {
+            delta.added.push_back(row);
+            state.entries.emplace(id, stamp);
+        } else if (old->second != stamp) {
+            delta.modified.push_back(row);
+            old->second = stamp;
         }
     }
 
-#ifdef _IMC_MAC
-    //for now utc only on macs..
-    row_data.modified_display = fmt::format("{:%m-%d-%y %I:%M %p}", std::chrono::file_clock::to_sys(row_data.modified));
+    if (!delta.empty())
+        deltaCallback(std::move(delta));
+    //once a pass, the same reason is likely behind every name that failed
+    if (failed) {
+        errorCallback(error_message_t(failed.message(), 5000ms));
+        return 1;
+    }
+
+    return 0;
+}
+
+//what a watcher shares with the tasks doing its passes, they may outlive it
+struct imc::backend::dir_watch_t
+{
+    fs::path            cur;
+    watch_callbacks_t   callbacks;
+    std::stop_source    stop;
+    //callbacks are only made holding this, stop() takes it so nothing reaches the pane afterwards
+    std::mutex          deliver_mutex;
+    //one pass at a time
+    std::mutex          scan_mutex;
+    dir_state_t         state;
+    //what inotify said since the last pass
+    std::mutex          mutex;
+    std::unordered_set<std::string> changed_names;
+    bool                rescan{false};
+    bool                gone{false};
+    bool                scheduled{false};
+    std::chrono::steady_clock::time_point first_event;
+    std::chrono::steady_clock::time_point last_event;
+    int                 wd{-1};
+    //polling a network file system: the directory's times at the last pass, only the poll task uses them
+    int64_t             dir_modified{0};
+    int64_t             dir_changed{0};
+    std::chrono::steady_clock::duration poll_interval{remote_poll_min};
+    std::chrono::steady_clock::time_point last_pass;
+};
+
+namespace {
+
+using WatchPtr = std::shared_ptr<dir_watch_t>;
+using clock = std::chrono::steady_clock;
+
+//a pass over every entry, or just over names
+void scan(dir_watch_t& watch, const std::vector<std::string>* names)
+{
+    std::lock_guard scan_lock(watch.scan_mutex);
+    if (watch.stop.stop_requested())
+        return;
+    auto update = [&watch](DirSnapshotPtr data) {
+        std::lock_guard lock(watch.deliver_mutex);
+        if (!watch.stop.stop_requested())
+            watch.callbacks.update(std::move(data));
+    };
+    auto delta = [&watch](table_delta_t changes) {
+        std::lock_guard lock(watch.deliver_mutex);
+        if (!watch.stop.stop_requested())
+            watch.callbacks.delta(std::move(changes));
+    };
+    auto error = [&watch](const error_message_t& message) {
+        std::lock_guard lock(watch.deliver_mutex);
+        if (!watch.stop.stop_requested())
+            watch.callbacks.error(message);
+    };
+    if (names)
+        watch_dir_entries(watch.cur, *names, watch.state, delta, error, watch.stop.get_token());
+    else
+        watch_dir(watch.cur, watch.state, update, delta, error, watch.stop.get_token());
+}
+
+//nfs, smb, fuse (sshfs and the like): inotify there only sees what this machine does
+bool is_remote_fs(const fs::path& dir)
+{
+#if defined(_IMC_NIX)
+    struct statfs st;
+    if (statfs(dir.c_str(), &st) != 0)
+        return false;
+    switch (static_cast<uint32_t>(st.f_type)) {
+    case 0x6969U:       //NFS_SUPER_MAGIC
+    case 0x65735546U:   //FUSE_SUPER_MAGIC
+    case 0x517bU:       //SMB_SUPER_MAGIC
+    case 0xff534d42U:   //CIFS_MAGIC_NUMBER
+    case 0xfe534d42U:   //SMB2_MAGIC_NUMBER
+    case 0x01021997U:   //V9FS_MAGIC
+    case 0x00c36400U:   //CEPH_SUPER_MAGIC
+    case 0x6b414653U:   //AFS_FS_MAGIC
+    case 0x73757245U:   //CODA_SUPER_MAGIC
+        return true;
+    default:
+        return false;
+    }
+#elif defined(_IMC_MAC)
+    struct statfs st;
+    return statfs(dir.c_str(), &st) == 0 && (st.f_flags & MNT_LOCAL) == 0;
 #else
-    auto t = make_zoned(date::current_zone(), std::chrono::file_clock::to_sys(row_data.modified));
-    row_data.modified_display = date::format("%m-%d-%y %I:%M %p", t);
+    (void)dir;
+    return false;
 #endif
-    if (entry.is_symlink()) {
-        row_data.permissions = fs::symlink_status(entry.path()).permissions();
-    } else {
-        row_data.permissions = fs::status(entry).permissions();
+}
+
+//adding, removing or renaming an entry moves the directory's mtime and ctime
+bool dir_times(const fs::path& dir, int64_t& modified, int64_t& changed)
+{
+#ifdef _IMC_NIX
+    struct stat st;
+    if (::stat(dir.c_str(), &st) != 0)
+        return false;
+    modified = int64_t{st.st_mtim.tv_sec} * 1000000000 + st.st_mtim.tv_nsec;
+    changed = int64_t{st.st_ctim.tv_sec} * 1000000000 + st.st_ctim.tv_nsec;
+    return true;
+#else
+    std::error_code ec;
+    modified = fs::last_write_time(dir, ec).time_since_epoch().count();
+    changed = 0;
+    return !ec;
+#endif
+}
+
+//a stat of the directory while it stays the same, a pass over its entries once it doesn't
+void poll_remote(dir_watch_t& watch)
+{
+    int64_t modified = 0;
+    int64_t changed = 0;
+    const auto now = clock::now();
+    const bool known = dir_times(watch.cur, modified, changed);
+    const bool moved = known && (modified != watch.dir_modified || changed != watch.dir_changed);
+    //an unreadable directory gets its pass too, that is what reports the error
+    if (moved || !known || now - watch.last_pass >= remote_full_pass) {
+        //taken before the pass, a change during it shows up in the next one
+        watch.dir_modified = modified;
+        watch.dir_changed = changed;
+        watch.last_pass = now;
+        scan(watch, nullptr);
     }
-    row_data.permissions_display = permissions_to_string(row_data.permissions);
-    row_data.absolute_path = entry.path().generic_string();
-    row_data.id = fs::hash_value(entry.path());
-    return std::make_unique<table_row_data_t>(std::move(row_data));
+    watch.poll_interval = moved ? clock::duration(remote_poll_min) :
+        std::min<clock::duration>(watch.poll_interval * 2, remote_poll_max);
 }
 
+void schedule_remote_poll(const WatchPtr& watch)
+{
+    io_executor().submit_blocking_at(clock::now() + watch->poll_interval, [watch](std::stop_token stop) {
+        poll_remote(*watch);
+        if (!stop.stop_requested())
+            schedule_remote_poll(watch);
+    }, watch->stop.get_token());
 }
 
-int imc::backend::watch_dir(const fs::path& cur, size_t oldHash, FNUpdate callback, FNError errorCallback)
+void schedule_poll(const WatchPtr& watch)
 {
-    std::error_code ec;
-    auto beg = fs::directory_iterator(cur, ec);
-    if (ec) {
-        errorCallback(error_message_t(ec.message(), 5000ms));
-        return 1;
+    io_executor().submit_blocking_at(clock::now() + poll_interval, [watch](std::stop_token stop) {
+        scan(*watch, nullptr);
+        if (!stop.stop_requested())
+            schedule_poll(watch);
+    }, watch->stop.get_token());
+}
+
+#ifdef _IMC_NIX
+constexpr uint32_t inotify_mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+//One inotify instance for every watcher, read by an executor task whenever
+//it has events. Two watchers of the same directory share its watch descriptor.
+class inotify_hub_t
+{
+public:
+    static inotify_hub_t& get()
+    {
+        static inotify_hub_t hub;
+        return hub;
     }
 
-    auto [newHash, entries] = hash_dir(cur);
-    if (newHash == oldHash) {
-        return 0;
+    ~inotify_hub_t()
+    {
+        if (fd_ != -1) {
+            io_executor().unwatch_fd(fd_);
+            close(fd_);
+        }
     }
 
-    size_t all_data_size = entries.size() + (cur.has_parent_path() ? 1 : 0);
+    //false if inotify can't watch it, the watcher has to poll then
+    bool add(const WatchPtr& watch)
+    {
+        std::lock_guard lock(mutex_);
+        if (fd_ == -1)
+            return false;
+        //stopped before it got here, remove() had nothing to do
+        if (watch->stop.stop_requested())
+            return true;
+        const int wd = inotify_add_watch(fd_, watch->cur.c_str(), inotify_mask);
+        if (wd == -1)
+            return false;
+        watch->wd = wd;
+        watches_[wd].push_back(watch);
+        return true;
+    }
 
-    TableRowDataVector data;
-    data.reserve(all_data_size);
-    if (cur.has_parent_path())
-        data.push_back(create_imaginary_up_dir());
+    void remove(dir_watch_t& watch)
+    {
+        std::lock_guard lock(mutex_);
+        const auto it = watches_.find(watch.wd);
+        if (watch.wd == -1 || it == watches_.end())
+            return;
+        std::erase_if(it->second, [&watch](const std::weak_ptr<dir_watch_t>& other) {
+            const auto locked = other.lock();
+            return !locked || locked.get() == &watch;
+        });
+        if (it->second.empty()) {
+            inotify_rm_watch(fd_, watch.wd);
+            watches_.erase(it);
+        }
+        watch.wd = -1;
+    }
 
-    std::transform(entries.begin(), entries.end(), std::back_inserter(data), [](const auto& entry) {
-        return entry_to_table_row(entry);
-    });
+private:
+    inotify_hub_t()
+    : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    {
+        if (fd_ != -1)
+            io_executor().watch_fd(fd_, [this]() { drain(); });
+    }
 
-    callback(std::make_shared<TableRowDataVector>(std::move(data)), newHash);
+    void drain()
+    {
+        alignas(inotify_event) char buffer[16 * 1024];
+        for(;;) {
+            const ssize_t len = read(fd_, buffer, sizeof(buffer));
+            if (len <= 0)
+                break;
+            std::lock_guard lock(mutex_);
+            for(ssize_t pos = 0; pos < len;) {
+                const auto* ev = reinterpret_cast<const inotify_event*>(buffer + pos);
+                pos += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+                //the kernel dropped events, nobody knows what changed
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    for(auto& [wd, watches] : watches_)
+                        for(const auto& watch : watches)
+                            note(watch.lock(), nullptr, true, false);
+                    continue;
+                }
+                const auto it = watches_.find(ev->wd);
+                if (it == watches_.end())
+                    continue;
+                const bool gone = (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT)) != 0;
+                for(const auto& watch : it->second)
+                    note(watch.lock(), ev->len > 0 ? ev->name : nullptr, false, gone);
+            }
+        }
+    }
 
-    return 0;
-}
\ No newline at end of file
+    //merges a burst: the pass runs once the directory stayed quiet for
+    //settle_time, but no later than max_settle_time after the first event
+    static void note(const WatchPtr& watch, const char* name, bool rescan, bool gone)
+    {
+        if (!watch)
+            return;
+        const auto now = clock::now();
+        std::lock_guard lock(watch->mutex);
+        if (name)
+            watch->changed_names.emplace(name);
+        watch->rescan |= rescan;
+        watch->gone |= gone;
+        watch->last_event = now;
+        if (watch->scheduled)
+            return;
+        watch->scheduled = true;
+        watch->first_event = now;
+        io_executor().submit_blocking_at(now + settle_time, [watch](std::stop_token) { settle(watch); }, watch->stop.get_token());
+    }
+
+    static void settle(const WatchPtr& watch)
+    {
+        std::vector<std::string> names;
+        bool full = false;
+        bool gone = false;
+        {
+            std::lock_guard lock(watch->mutex);
+            const auto due = std::min(watch->last_event + settle_time, watch->first_event + max_settle_time);
+            if (clock::now() < due) {
+                io_executor().submit_blocking_at(due, [watch](std::stop_token) { settle(watch); }, watch->stop.get_token());
+                return;
+            }
+            names.assign(watch->changed_names.begin(), watch->changed_names.end());
+            watch->changed_names.clear();
+            full = watch->rescan || watch->gone;
+            gone = watch->gone;
+            watch->rescan = watch->gone = false;
+            watch->scheduled = false;
+        }
+        scan(*watch, full ? nullptr : &names);
+        //the last pass told the pane, there is nothing left to watch
+        if (gone)
+            get().remove(*watch);
+    }
+
+    int                 fd_;
+    std::mutex          mutex_;
+    std::unordered_map<int, std::vector<std::weak_ptr<dir_watch_t>>> watches_;
+};
+#endif
+
+}
+
+imc::backend::dir_watcher_t::dir_watcher_t()
+{
+    //stop() needs the hub and the executor. Built before the watcher they are destroyed
+    //after it, so a watcher that is a static itself (a pane's) still finds them at exit.
+#ifdef _IMC_NIX
+    inotify_hub_t::get();
+#else
+    io_executor();
+#endif
+}
+
+imc::backend::dir_watcher_t::~dir_watcher_t()
+{
+    stop();
+}
+
+void imc::backend::dir_watcher_t::start(const fs::path& cur, dir_state_t state, FNUpdate callback, FNDelta deltaCallback, FNError errorCallback)
+{
+    stop();
+    auto watch = std::make_shared<dir_watch_t>();
+    watch->cur = cur;
+    watch->state = std::move(state);
+    watch->callbacks = watch_callbacks_t{std::move(callback), std::move(deltaCallback), std::move(errorCallback)};
+    watch_ = watch;
+    //even adding the inotify watch looks the path up, which may hang on a dead mount
+    io_executor().submit_blocking([watch](std::stop_token) {
+        //a listing shown again is looked at once, one never sent is sent whole
+        const bool stale = std::exchange(watch->state.stale, false) || !watch->state.loaded;
+        if (is_remote_fs(watch->cur)) {
+#ifdef _IMC_NIX
+            //what this machine does there still shows right away
+            inotify_hub_t::get().add(watch);
+#endif
+            //the first look finds no times to compare with and makes a pass
+            if (stale)
+                poll_remote(*watch);
+            schedule_remote_poll(watch);
+            return;
+        }
+#ifdef _IMC_NIX
+        //watched from here on, whatever changed before shows up in the first pass
+        if (inotify_hub_t::get().add(watch)) {
+            if (stale)
+                scan(*watch, nullptr);
+            return;
+        }
+#endif
+        if (stale)
+            scan(*watch, nullptr);
+        schedule_poll(watch);
+    }, watch->stop.get_token());
+}
+
+void imc::backend::dir_watcher_t::stop()
+{
+    if (!watch_)
+        return;
+    {
+        std::lock_guard lock(watch_->deliver_mutex);
+        watch_->stop.request_stop();
+    }
+#ifdef _IMC_NIX
+    inotify_hub_t::get().remove(*watch_);
+#endif
+    watch_.reset();
+}
@@ -3,6 +3,10 @@
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "table_data.h"
 #include "error_message.h"
@@ -11,9 +15,82 @@ namespace imc::backend {
 
 namespace fs = std::filesystem;
 
-using FNUpdate = std::function<void(TableRowDataVectorPtr, size_t)>;
+using FNUpdate = std::function<void(DirSnapshotPtr)>;
+using FNDelta = std::function<void(table_delta_t)>;
 using FNError = std::function<void(const error_message_t&)>;
 
-int watch_dir(const fs::path& cur, size_t oldHash, FNUpdate callback, FNError errorCallback);
+// What watch_dir remembers about the listing it last sent, so the next
+// pass only has to send the rows that changed.
+struct dir_state_t
+{
+    struct stamp_t
+    {
+        size_t              size{0U};
+        file_time::rep      modified{0};
+        bool                is_directory{false};
+        bool operator==(const stamp_t&) const = default;
+    };
 
-}
\ No newline at end of file
+    std::unordered_map<size_t, stamp_t> entries;
+    bool loaded{false};
+    //made from a listing sent a while ago, the watcher looks at the directory again first thing
+    bool stale{false};
+};
+
+// The state watch_dir would be in after sending listing, for watching a
+// listing that is shown again (stale, since it may be behind the directory).
+dir_state_t dir_state_of(const dir_snapshot_t& listing);
+
+struct watch_callbacks_t
+{
+    FNUpdate    update;
+    FNDelta     delta;
+    FNError     error;
+};
+
+// What a pane shows of cur until its listing arrives, just "..".
+DirSnapshotPtr empty_listing(const fs::path& cur);
+
+// The whole listing of cur as watch_dir first sends it, nullptr if cur
+// can't be read or stop was requested first.
+DirSnapshotPtr read_listing(const fs::path& cur, std::stop_token stop = {});
+
+// First call sends the whole listing through callback, every call after
+// that sends only the added/modified/removed rows through deltaCallback.
+// A stop request ends the pass early and nothing is sent.
+int watch_dir(const fs::path& cur, dir_state_t& state, FNUpdate callback, FNDelta deltaCallback, FNError errorCallback, std::stop_token stop = {});
+// Like watch_dir, but only looks at the given entries of cur (from inotify).
+// An entry that can't be looked at keeps its row and goes to errorCallback.
+int watch_dir_entries(const fs::path& cur, const std::vector<std::string>& names, dir_state_t& state, FNDelta deltaCallback, FNError errorCallback, std::stop_token stop = {});
+
+// What a watcher shares with the tasks doing its passes.
+struct dir_watch_t;
+
+// Re-runs watch_dir in the background whenever the directory changes, as
+// blocking tasks on the shared io_executor_t. Started with a state that isn't loaded
+// the first task sends the whole listing, nothing is listed by start(). On linux all watchers share one
+// inotify instance and a burst of events is merged into a single pass over
+// just the touched entries, everywhere else (or when inotify can't be used)
+// the directory is polled every second. On network file systems (nfs, smb,
+// fuse), where inotify misses what other machines do, only the directory's
+// own times are polled, less and less often while they stay the same, and
+// its entries are listed again when they moved.
+class dir_watcher_t
+{
+public:
+    dir_watcher_t();
+    ~dir_watcher_t();
+
+    dir_watcher_t(const dir_watcher_t&) = delete;
+    dir_watcher_t& operator=(const dir_watcher_t&) = delete;
+
+    void start(const fs::path& cur, dir_state_t state, FNUpdate callback, FNDelta deltaCallback, FNError errorCallback);
+    // Returns right away, nothing waits for a pass under way: it just
+    // can't reach the callbacks any more once this returned.
+    void stop();
+
+private:
+    std::shared_ptr<dir_watch_t> watch_;
+};
+
+}
@@ -0,0 +1,216 @@
+#include "watch_file.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+
+#ifdef _IMC_NIX
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace std::chrono_literals;
+
+namespace {
+
+//a log written non stop never settles, it still gets looked at this often
+constexpr auto settle_time = 10ms;
+constexpr auto max_settle_time = 50ms;
+constexpr auto poll_interval = 1000ms;
+
+}
+
+imc::backend::file_watcher_t::~file_watcher_t()
+{
+    stop();
+}
+
+void imc::backend::file_watcher_t::start(const fs::path& file, uint64_t size)
+{
+    stop();
+    end_ = false;
+    change_ = file_change::None;
+    size_ = size;
+    device_ = inode_ = 0U;
+#ifdef _IMC_NIX
+    if (struct stat st; stat(file.c_str(), &st) == 0) {
+        device_ = st.st_dev;
+        inode_ = st.st_ino;
+    }
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    thread_ = std::thread(&file_watcher_t::run, this, file, size);
+}
+
+void imc::backend::file_watcher_t::stop()
+{
+    if (!thread_.joinable())
+        return;
+    {
+        std::lock_guard lock(mutex_);
+        end_ = true;
+    }
+    wake_.notify_all();
+#ifdef _IMC_NIX
+    if (wake_fd_ != -1) {
+        uint64_t one = 1;
+        [[maybe_unused]] auto written = write(wake_fd_, &one, sizeof(one));
+    }
+#endif
+    thread_.join();
+#ifdef _IMC_NIX
+    if (wake_fd_ != -1) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+#endif
+}
+
+int imc::backend::file_watcher_t::changes(uint64_t& size)
+{
+    const int change = change_.exchange(file_change::None);
+    size = size_;
+    return change;
+}
+
+void imc::backend::file_watcher_t::report(int change, uint64_t size)
+{
+    size_ = size;
+    int current = change_;
+    while (current < change && !change_.compare_exchange_weak(current, change)) {
+    }
+}
+
+bool imc::backend::file_watcher_t::check(const fs::path& file, uint64_t& size)
+{
+#ifdef _IMC_NIX
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || st.st_dev != device_ || st.st_ino != inode_) {
+        report(file_change::Replaced, 0U);
+        return false;
+    }
+    const auto now = static_cast<uint64_t>(st.st_size);
+#else
+    std::error_code ec;
+    const auto now = static_cast<uint64_t>(fs::file_size(file, ec));
+    if (ec) {
+        report(file_change::Replaced, 0U);
+        return false;
+    }
+#endif
+    if (now > size)
+        report(file_change::Grew, now);
+    else if (now < size)
+        report(file_change::Truncated, now);
+    size = now;
+    return true;
+}
+
+void imc::backend::file_watcher_t::run(fs::path file, uint64_t size)
+{
+    if (run_inotify(file, size))
+        return;
+    run_polling(file, size);
+}
+
+bool imc::backend::file_watcher_t::run_inotify(const fs::path& file, uint64_t& size)
+{
+#ifdef _IMC_NIX
+    if (wake_fd_ == -1)
+        return false;
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    constexpr uint32_t file_mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF;
+    //a rotated log shows up as a new file under the same name
+    constexpr uint32_t dir_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    const auto parent = file.has_parent_path() ? file.parent_path() : fs::path(".");
+    const int file_wd = inotify_add_watch(fd, file.c_str(), file_mask);
+    if (file_wd == -1 || inotify_add_watch(fd, parent.c_str(), dir_mask) == -1) {
+        close(fd);
+        return false;
+    }
+    const auto name = file.filename().string();
+
+    //returns true when something happened to the file
+    alignas(inotify_event) char buffer[16 * 1024];
+    auto drain = [&]() {
+        bool changed = false;
+        for(;;) {
+            const ssize_t len = read(fd, buffer, sizeof(buffer));
+            if (len <= 0)
+                break;
+            const auto got = static_cast<size_t>(len);
+            for(size_t pos = 0; pos < got;) {
+                const auto* ev = reinterpret_cast<const inotify_event*>(buffer + pos);
+                //everything else happening in the directory is none of our business
+                if (ev->wd == file_wd || (ev->mask & IN_Q_OVERFLOW) || (ev->len > 0 && name == ev->name))
+                    changed = true;
+                pos += sizeof(inotify_event) + ev->len;
+            }
+        }
+        return changed;
+    };
+
+    std::array<pollfd, 2> fds = {{
+        { fd, POLLIN, 0 },
+        { wake_fd_, POLLIN, 0 },
+    }};
+
+    //it may have changed between being read and being watched
+    bool watching = check(file, size);
+    while(!end_ && watching) {
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (end_ || fds[1].revents)
+            break;
+        if (!drain())
+            continue;
+
+        //merge the burst of writes, but not forever
+        const auto first_event = std::chrono::steady_clock::now();
+        while(!end_) {
+            const auto waited = std::chrono::steady_clock::now() - first_event;
+            if (waited >= max_settle_time)
+                break;
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(max_settle_time - waited);
+            const int timeout = static_cast<int>(std::min<std::chrono::milliseconds>(settle_time, remaining).count());
+            if (poll(fds.data(), fds.size(), timeout) <= 0 || fds[1].revents)
+                break;
+            drain();
+        }
+        if (!end_)
+            watching = check(file, size);
+    }
+
+    close(fd);
+    return true;
+#else
+    (void)file; (void)size;
+    return false;
+#endif
+}
+
+void imc::backend::file_watcher_t::run_polling(const fs::path& file, uint64_t& size)
+{
+    std::unique_lock lock(mutex_);
+    while(!end_) {
+        if (wake_.wait_for(lock, poll_interval, [this] { return end_.load(); }))
+            break;
+        lock.unlock();
+        const bool watching = check(file, size);
+        lock.lock();
+        if (!watching)
+            break;
+    }
+}
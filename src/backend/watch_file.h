@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace imc::backend {
+
+namespace fs = std::filesystem;
+
+// Worst first, a later change never hides a worse one that wasn't picked up yet.
+namespace file_change {
+    constexpr int None = 0;
+    // Same file, more bytes at the end.
+    constexpr int Grew = 1;
+    // Same file, shorter than before: what was read may have changed.
+    constexpr int Truncated = 2;
+    // Another file under the same name (log rotation, an editor's save) or gone.
+    constexpr int Replaced = 3;
+}
+
+// Watches a single file in the background so nobody has to stat it every
+// frame. On linux it sleeps on inotify (the file, and its directory for a
+// new file appearing under its name) and merges a burst of writes into one
+// look at the file, everywhere else it polls every second.
+class file_watcher_t
+{
+public:
+    file_watcher_t() = default;
+    ~file_watcher_t();
+
+    file_watcher_t(const file_watcher_t&) = delete;
+    file_watcher_t& operator=(const file_watcher_t&) = delete;
+
+    // size is how much of it the caller already has.
+    void start(const fs::path& file, uint64_t size);
+    void stop();
+    // What happened since the last call, size is the file's latest size.
+    // Just two atomics, meant to be called every frame.
+    int changes(uint64_t& size);
+
+private:
+    void run(fs::path file, uint64_t size);
+    bool run_inotify(const fs::path& file, uint64_t& size);
+    void run_polling(const fs::path& file, uint64_t& size);
+    //stats file and records what changed, false once it is replaced or gone
+    bool check(const fs::path& file, uint64_t& size);
+    void report(int change, uint64_t size);
+
+    std::thread thread_;
+    std::atomic_bool end_{false};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    //eventfd used to interrupt the inotify wait
+    int wake_fd_{-1};
+
+    std::atomic<int> change_{file_change::None};
+    std::atomic<uint64_t> size_{0U};
+    //st_dev/st_ino of the file being watched, to tell a replacement from a write
+    uint64_t device_{0U};
+    uint64_t inode_{0U};
+};
+
+}
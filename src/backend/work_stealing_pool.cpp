@@ -0,0 +1,96 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+imc::backend::work_stealing_pool_t::work_stealing_pool_t(size_t threads)
+{
+    if (threads == 0)
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    for(size_t i = 0; i < threads; i++)
+        queues_.push_back(std::make_unique<queue_t>());
+}
+
+void imc::backend::work_stealing_pool_t::push(size_t worker, FNTask task)
+{
+    pending_++;
+    {
+        auto& queue = *queues_[worker];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        queued_++;
+    }
+    //taking the mutex orders this against a worker between checking and waiting
+    { std::lock_guard lock(idle_mutex_); }
+    idle_.notify_one();
+}
+
+bool imc::backend::work_stealing_pool_t::pop(size_t worker, FNTask& task)
+{
+    auto& queue = *queues_[worker];
+    std::lock_guard lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    queued_--;
+    return true;
+}
+
+bool imc::backend::work_stealing_pool_t::steal(size_t worker, FNTask& task)
+{
+    //start with the neighbour so thieves don't all pile onto queue 0
+    for(size_t i = 1; i < queues_.size(); i++) {
+        auto& queue = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued_--;
+        return true;
+    }
+    return false;
+}
+
+void imc::backend::work_stealing_pool_t::work(size_t worker)
+{
+    FNTask task;
+    while (pending_ > 0) {
+        if (pop(worker, task) || steal(worker, task)) {
+            try {
+                task(worker);
+            } catch (...) {
+                std::lock_guard lock(idle_mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+            task = nullptr;
+            if (--pending_ == 0) {
+                //the last one out lets everyone else leave
+                { std::lock_guard lock(idle_mutex_); }
+                idle_.notify_all();
+            }
+        } else {
+            //someone is still running and may push more
+            std::unique_lock lock(idle_mutex_);
+            idle_.wait(lock, [this]() { return pending_ == 0 || queued_ > 0; });
+        }
+    }
+}
+
+void imc::backend::work_stealing_pool_t::run(FNTask first)
+{
+    error_ = nullptr;
+    push(0, std::move(first));
+    {
+        std::vector<std::jthread> threads;
+        for(size_t worker = 1; worker < queues_.size(); worker++)
+            threads.emplace_back([this, worker]() { work(worker); });
+        //the caller is worker 0
+        work(0);
+    }
+    if (error_)
+        std::rethrow_exception(std::exchange(error_, nullptr));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace imc::backend {
+
+    // Runs a tree of tasks on a fixed number of threads. Every worker keeps
+    // its own deque: tasks it pushes go to the back and it takes from the
+    // back (depth first, what it just touched is still warm), a worker that
+    // runs dry steals from the front of the others (the biggest subtrees).
+    class work_stealing_pool_t
+    {
+    public:
+        // Gets the index of the worker running it, for pushing more work.
+        using FNTask = std::function<void(size_t worker)>;
+
+        // 0 picks the hardware concurrency.
+        explicit work_stealing_pool_t(size_t threads = 0);
+
+        size_t size() const { return queues_.size(); }
+        // Only from inside a task running on worker.
+        void push(size_t worker, FNTask task);
+        // Blocks until first and everything it pushed, transitively, finished.
+        // The first exception a task threw is rethrown here, the tasks still
+        // queued behind it run regardless.
+        void run(FNTask first);
+
+    private:
+        struct queue_t
+        {
+            std::mutex          mutex;
+            std::deque<FNTask>  tasks;
+        };
+
+        bool pop(size_t worker, FNTask& task);
+        bool steal(size_t worker, FNTask& task);
+        void work(size_t worker);
+
+        std::vector<std::unique_ptr<queue_t>>   queues_;
+        // pushed but not finished, a task's children are counted before it is done
+        std::atomic<size_t>                     pending_{0U};
+        // pushed but not taken yet, what an idle worker waits for
+        std::atomic<size_t>                     queued_{0U};
+        std::mutex                              idle_mutex_;
+        std::condition_variable                 idle_;
+        std::exception_ptr                      error_;
+    };
+}
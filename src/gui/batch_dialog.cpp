@@ -0,0 +1,167 @@
+#include "batch_dialog.h"
+
+#include "imgui.h"
+
+#include "backend/batch.h"
+#include "backend/io_executor.h"
+#include "types/op_file.h"
+#include "types/errors.h"
+#include "utils/string_utils.h"
+
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using namespace imc::errors;
+using namespace imc::string_utils;
+using namespace imc::backend;
+
+namespace {
+    //where the io_executor task leaves its result, outlives the dialog's interest in it
+    struct pending_preflight_t
+    {
+        std::mutex mutex;
+        std::optional<preflight_t> result;
+    };
+
+    struct batch_state_t
+    {
+        //the destination the pre-flight ran against
+        std::string dst;
+        std::vector<batch_item_t> items;
+        std::shared_ptr<pending_preflight_t> pending;
+        //stops the pre-flight under way
+        std::stop_source cancel;
+        std::optional<preflight_t> result;
+        bool can_override{false};
+    };
+    //one per batch_kind
+    std::array<batch_state_t, 3> states;
+
+    void start_preflight(batch_state_t& state, const std::vector<fs::path>& sources, const std::string& dst)
+    {
+        state.dst = dst;
+        state.items = batch_items(sources, fs::path(dst));
+        state.result.reset();
+        state.cancel.request_stop();
+        state.cancel = std::stop_source();
+        state.pending = std::make_shared<pending_preflight_t>();
+        io_executor().submit([pending = state.pending, items = state.items](std::stop_token stop) {
+            auto result = preflight(items, stop);
+            std::lock_guard lock(pending->mutex);
+            if (!stop.stop_requested())
+                pending->result = std::move(result);
+        }, state.cancel.get_token());
+    }
+
+    //false while it is still running
+    bool poll_preflight(batch_state_t& state)
+    {
+        if (state.result)
+            return true;
+        if (!state.pending)
+            return false;
+        {
+            std::lock_guard lock(state.pending->mutex);
+            if (!state.pending->result)
+                return false;
+            state.result = std::move(state.pending->result);
+        }
+        state.pending.reset();
+        return true;
+    }
+
+    void draw_preflight(int kind, batch_state_t& state)
+    {
+        if (!poll_preflight(state)) {
+            ImGui::TextDisabled("Checking %zu items...", state.items.size());
+            return;
+        }
+        const auto& result = *state.result;
+        ImGui::Text("%zu files, %zu directories, %s", result.files, result.directories,
+                    size_to_display_no_padding(result.total_bytes).c_str());
+        if (!result.errors.empty()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%zu can't be read, e.g. %s: %s", result.errors.size(),
+                               state.items[result.errors.front().first].src.filename().generic_string().c_str(),
+                               result.errors.front().second.message().c_str());
+        }
+        if (kind != batch_kind::Delete && !result.conflicts.empty()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%zu already exist in the destination, e.g. %s", result.conflicts.size(),
+                               state.items[result.conflicts.front()].dst.filename().generic_string().c_str());
+            if (result.inner_conflicts > 0)
+                ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.0f, 1.0f), "%zu more inside directories that are merged into", result.inner_conflicts);
+            ImGui::Checkbox("Overwrite them (otherwise they are skipped)", &state.can_override);
+        }
+        if (result.unreadable > 0)
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%zu directories inside can't be read, they aren't counted", result.unreadable);
+    }
+
+    //what actually gets queued: conflicts drop out unless they may be overwritten
+    std::vector<batch_item_t> items_to_run(const batch_state_t& state, uint64_t& total_bytes)
+    {
+        const auto& result = *state.result;
+        const bool skip_conflicts = !state.can_override && !result.conflicts.empty();
+        std::vector<batch_item_t> items;
+        items.reserve(state.items.size());
+        total_bytes = 0;
+        auto conflict = result.conflicts.begin();
+        for(size_t i = 0; i < state.items.size(); i++) {
+            if (skip_conflicts && conflict != result.conflicts.end() && *conflict == i) {
+                ++conflict;
+                continue;
+            }
+            items.push_back(state.items[i]);
+            //copy_tree adds what is under a directory itself, as it gets there
+            total_bytes += result.own_sizes[i];
+        }
+        return items;
+    }
+}
+
+int imc::gui::draw_batch_dialog(int kind, types::op_file_t& op_file, backend::job_queue_t& jobs, std::shared_ptr<backend::job_t>& job)
+{
+    auto& state = states[kind];
+    //deletes have no destination, file only describes them
+    const std::string dst = kind == batch_kind::Delete ? std::string() : std::string(op_file.file.data());
+    if (!state.pending && !state.result)
+        start_preflight(state, op_file.old_files, dst);
+
+    draw_preflight(kind, state);
+
+    int ret = didnt_do_nothin;
+    const bool ready = state.result.has_value();
+    const bool stale = ready && state.dst != dst;
+    ImGui::BeginDisabled(!ready);
+    if (stale) {
+        //the destination was edited after the check
+        if (ImGui::Button("Check"))
+            start_preflight(state, op_file.old_files, dst);
+    } else if (ImGui::Button(kind == batch_kind::Delete ? "Delete" : "OK")) {
+        uint64_t total_bytes = 0;
+        auto items = items_to_run(state, total_bytes);
+        job = jobs.push(make_batch_job(kind, std::move(items), state.can_override, total_bytes));
+        reset_batch_dialog(kind);
+        ret = success;
+    }
+    ImGui::EndDisabled();
+    return ret;
+}
+
+void imc::gui::reset_batch_dialog(int kind)
+{
+    auto& state = states[kind];
+    state.dst.clear();
+    state.items.clear();
+    state.result.reset();
+    //a pre-flight still running stops on its own, nothing waits for it
+    state.cancel.request_stop();
+    state.pending.reset();
+    state.can_override = false;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+
+namespace imc::types {
+    struct op_file_t;
+}
+
+namespace imc::backend {
+    class job_queue_t;
+    struct job_t;
+}
+
+namespace imc::gui {
+    // Inside the copy/move/delete popup when more than one item is selected:
+    // pre-flights the selection in the background, shows what it found and
+    // queues the whole selection as one job into job. Returns success the
+    // frame the job gets queued.
+    int draw_batch_dialog(int kind, types::op_file_t& op_file, backend::job_queue_t& jobs, std::shared_ptr<backend::job_t>& job);
+    // Forgets the pre-flight, for when the popup closes.
+    void reset_batch_dialog(int kind);
+}
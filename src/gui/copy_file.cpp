@@ -3,8 +3,12 @@
 #include "imgui.h"
 
 #include "backend/file_operations.h"
+#include "backend/job_queue.h"
 #include "types/op_file.h"
 #include "types/errors.h"
+#include "job_progress.h"
+#include "batch_dialog.h"
+#include "backend/batch.h"
 
 #include <vector>
 #include <string>
@@ -13,13 +17,15 @@
 
 namespace {
     std::string last_error = "";
+    //the copy runs in the job queue, the popup shows it until it is done or sent to the background
+    imc::backend::JobPtr job;
 }
 
 namespace fs = std::filesystem;
 
 using namespace imc::errors;
 
-int imc::gui::ask_copy(types::op_file_t& copy_file)
+int imc::gui::ask_copy(types::op_file_t& copy_file, backend::job_queue_t& jobs)
 {
     int ret = didnt_do_nothin;
     if (std::strlen(copy_file.file.data()) == 0)
@@ -28,28 +34,61 @@ int imc::gui::ask_copy(types::op_file_t& copy_file)
     ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
     ImGui::SetNextWindowSize(ImVec2(4.0 * 150.0f, 0.0f));
     if (ImGui::BeginPopupModal("Copy File", nullptr, ImGuiWindowFlags_NoResize)) {
-        ImGui::Text("Copy %s to:", copy_file.old_file.filename().generic_string().c_str());
+        if (job) {
+            if (copy_file.old_files.empty())
+                ImGui::Text("Copying %s to %s", copy_file.old_file.filename().generic_string().c_str(), copy_file.file.data());
+            else
+                ImGui::Text("Copying %zu items to %s", copy_file.old_files.size(), copy_file.file.data());
+            draw_job_progress(*job);
+            if (job->finished()) {
+                std::error_code ec = job->ec;
+                const auto message = job_error_message(*job);
+                job.reset();
+                if (ec) {
+                    last_error = message;
+                    ret = failed_to_copy;
+                } else {
+                    ret = success;
+                    last_error.clear();
+                    ImGui::CloseCurrentPopup();
+                }
+            } else {
+                if (ImGui::Button("Background")) {
+                    //it carries on in the jobs panel
+                    job.reset();
+                    ret = success;
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::SameLine();
+                if (job && ImGui::Button("Cancel")) {
+                    //the copy removes what it wrote so far, finished follows shortly
+                    jobs.cancel(job);
+                }
+            }
+            ImGui::EndPopup();
+            return ret;
+        }
+        const bool batch = !copy_file.old_files.empty();
+        if (batch)
+            ImGui::Text("Copy %zu items to:", copy_file.old_files.size());
+        else
+            ImGui::Text("Copy %s to:", copy_file.old_file.filename().generic_string().c_str());
         ImGui::SetNextItemWidth(-1.0f);
         bool do_ok = false;
         if (ImGui::InputText("##copyfile",  copy_file.file.data(), copy_file.file.size(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue)) {
             do_ok = true;
         }
         ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", last_error.c_str());
-        if (ImGui::Button("OK") || do_ok) {
-            std::error_code ec = backend::copy(copy_file.old_file, fs::path(copy_file.file.data()));
-            if (ec) {
-                //hey there was an error
-                last_error = ec.message();
-                ret = failed_to_copy;
-            } else {
-                ret = success;
+        if (batch) {
+            if (draw_batch_dialog(backend::batch_kind::Copy, copy_file, jobs, job) == success)
                 last_error.clear();
-                ImGui::CloseCurrentPopup();
-            }
+        } else if (ImGui::Button("OK") || do_ok) {
+            job = jobs.push(backend::make_copy_job(copy_file.old_file, fs::path(copy_file.file.data()), true));
         }
         ImGui::SameLine();
         if (ImGui::Button("Cancel")) {
             last_error.clear();
+            reset_batch_dialog(backend::batch_kind::Copy);
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
@@ -4,6 +4,10 @@ namespace imc::types {
     struct op_file_t;
 }
 
+namespace imc::backend {
+    class job_queue_t;
+}
+
 namespace imc::gui {
-    int ask_copy(types::op_file_t& copy_file);
+    int ask_copy(types::op_file_t& copy_file, backend::job_queue_t& jobs);
 }
@@ -3,8 +3,11 @@
 #include "imgui.h"
 
 #include "backend/file_operations.h"
+#include "backend/job_queue.h"
 #include "types/op_file.h"
 #include "types/errors.h"
+#include "batch_dialog.h"
+#include "backend/batch.h"
 
 #include <vector>
 #include <string>
@@ -13,14 +16,13 @@
 
 namespace {
     std::string last_error = "";
-    std::error_code last_ec;
 }
 
 namespace fs = std::filesystem;
 
 using namespace imc::errors;
 
-int imc::gui::ask_delete(types::op_file_t& delete_file)
+int imc::gui::ask_delete(types::op_file_t& delete_file, backend::job_queue_t& jobs)
 {
     int ret = didnt_do_nothin;
     if (std::strlen(delete_file.file.data()) == 0)
@@ -30,27 +32,41 @@ int imc::gui::ask_delete(types::op_file_t& delete_file)
     ImGui::SetNextWindowSize(ImVec2(4.0 * 150.0f, 0.0f));
     if (ImGui::BeginPopupModal("Delete File", nullptr, ImGuiWindowFlags_NoResize)) {
         ImGui::TextUnformatted("Do you really want to delete the items below?");
+        const bool batch = !delete_file.old_files.empty();
         if (ImGui::BeginListBox("##delete-list-1", ImVec2(-1.0f, 0.0f))) {
-            ImGui::TextUnformatted(delete_file.file.data());
+            if (batch) {
+                //could be thousands, only the visible ones get submitted
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(delete_file.old_files.size()));
+                while (clipper.Step()) {
+                    for(int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                        ImGui::TextUnformatted(delete_file.old_files[i].filename().generic_string().c_str());
+                }
+            } else {
+                ImGui::TextUnformatted(delete_file.file.data());
+            }
             ImGui::EndListBox();
         }
         ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", last_error.c_str());
-        if (ImGui::Button("Delete")) {
-            std::error_code ec = backend::delete_(delete_file.old_file);
-            last_ec = ec;
-            if (ec) {
-                //hey there was an error
-                last_error = ec.message();
-                ret = failed_to_remove;
-            } else {
+        if (batch) {
+            backend::JobPtr job;
+            if (draw_batch_dialog(backend::batch_kind::Delete, delete_file, jobs, job) == success) {
+                //failures show up in the jobs panel, as one report
                 ret = success;
                 last_error.clear();
                 ImGui::CloseCurrentPopup();
             }
+        } else if (ImGui::Button("Delete")) {
+            //failures show up in the jobs panel
+            jobs.push(backend::make_delete_job(delete_file.old_file));
+            ret = success;
+            last_error.clear();
+            ImGui::CloseCurrentPopup();
         }
         ImGui::SameLine();
         if (ImGui::Button("Cancel")) {
             last_error.clear();
+            reset_batch_dialog(backend::batch_kind::Delete);
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
@@ -4,6 +4,10 @@ namespace imc::types {
     struct op_file_t;
 }
 
+namespace imc::backend {
+    class job_queue_t;
+}
+
 namespace imc::gui {
-    int ask_delete(types::op_file_t& delete_file);
+    int ask_delete(types::op_file_t& delete_file, backend::job_queue_t& jobs);
 }
@@ -0,0 +1,64 @@
+#include "find_file.h"
+
+#include "imgui.h"
+
+#include "backend/name_index.h"
+#include "types/op_file.h"
+#include "types/errors.h"
+
+#include <fmt/format.h>
+#include <fmt/chrono.h>
+
+#include <chrono>
+#include <string>
+
+using namespace imc::errors;
+
+int imc::gui::ask_find_file(types::op_file_t& find, backend::name_indexes_t& indexes)
+{
+    int ret = didnt_do_nothin;
+    ImVec2 center = ImGui::GetMainViewport()->GetCenter();
+    ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(4.0 * 150.0f, 0.0f));
+    if (ImGui::BeginPopupModal("Find File", nullptr, ImGuiWindowFlags_NoResize)) {
+        const auto root = indexes.root_of(find.old_file);
+        const auto index = root.empty() ? nullptr : indexes.index(root);
+        const bool building = !root.empty() && indexes.building(root);
+        if (root.empty()) {
+            ImGui::Text("%s isn't indexed yet.", find.old_file.generic_string().c_str());
+        } else if (index) {
+            const auto built = std::chrono::floor<std::chrono::seconds>(index->built());
+            ImGui::Text("%zu names under %s, indexed %s", index->size(), root.generic_string().c_str(),
+                fmt::format("{:%Y-%m-%d %H:%M}", built).c_str());
+        } else {
+            ImGui::Text("Indexing %s...", root.generic_string().c_str());
+        }
+
+        bool do_ok = false;
+        ImGui::SetNextItemWidth(-1.0f);
+        if (ImGui::IsWindowAppearing())
+            ImGui::SetKeyboardFocusHere();
+        if (ImGui::InputText("##findname", find.file.data(), find.file.size(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue)) {
+            do_ok = true;
+        }
+        ImGui::BeginDisabled(!index);
+        if ((ImGui::Button("Find") || do_ok) && index && find.file[0] != '\0') {
+            ret = success;
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        ImGui::BeginDisabled(building);
+        //a new root is the pane's directory, an indexed one is refreshed whole
+        if (ImGui::Button(root.empty() ? "Index this directory" : "Rebuild index")) {
+            indexes.rebuild(root.empty() ? find.old_file : root);
+        }
+        ImGui::EndDisabled();
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+    return ret;
+}
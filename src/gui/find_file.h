@@ -0,0 +1,16 @@
+#pragma once
+
+namespace imc::types {
+    struct op_file_t;
+}
+
+namespace imc::backend {
+    class name_indexes_t;
+}
+
+namespace imc::gui {
+    // find.old_file is the directory the pane is in, find.file the part of
+    // a name to look for in the index covering it. Returns success once
+    // the search is asked for; indexing the directory is done from here too.
+    int ask_find_file(types::op_file_t& find, backend::name_indexes_t& indexes);
+}
@@ -0,0 +1,37 @@
+#include "find_in_files.h"
+
+#include "imgui.h"
+
+#include "types/op_file.h"
+#include "types/errors.h"
+
+using namespace imc::errors;
+
+int imc::gui::ask_find_in_files(types::op_file_t& find, bool& match_case)
+{
+    int ret = didnt_do_nothin;
+    ImVec2 center = ImGui::GetMainViewport()->GetCenter();
+    ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(4.0 * 150.0f, 0.0f));
+    if (ImGui::BeginPopupModal("Find in Files", nullptr, ImGuiWindowFlags_NoResize)) {
+        ImGui::Text("Find in %s and below:", find.old_file.generic_string().c_str());
+        bool do_ok = false;
+        ImGui::SetNextItemWidth(-1.0f);
+        if (ImGui::IsWindowAppearing())
+            ImGui::SetKeyboardFocusHere();
+        if (ImGui::InputText("##findtext", find.file.data(), find.file.size(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue)) {
+            do_ok = true;
+        }
+        ImGui::Checkbox("Match case", &match_case);
+        if ((ImGui::Button("Find") || do_ok) && find.file[0] != '\0') {
+            ret = success;
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Cancel")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+    return ret;
+}
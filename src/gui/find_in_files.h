@@ -0,0 +1,11 @@
+#pragma once
+
+namespace imc::types {
+    struct op_file_t;
+}
+
+namespace imc::gui {
+    // find.old_file is where to search from, find.file what to search for.
+    // Returns success once the search is asked for.
+    int ask_find_in_files(types::op_file_t& find, bool& match_case);
+}
@@ -0,0 +1,68 @@
+#include "job_progress.h"
+
+#include "imgui.h"
+
+#include "backend/job_queue.h"
+#include "utils/string_utils.h"
+
+#include <fmt/format.h>
+
+#include <string>
+
+using namespace imc::string_utils;
+
+namespace {
+    const char* copy_method_name(int method)
+    {
+        using namespace imc::backend::copy_method;
+        switch(method) {
+            case Reflink: return "reflink";
+            case CopyFileRange: return "copy_file_range";
+            case ReadWrite: return "read/write";
+            case Rename: return "rename";
+            default: return "";
+        }
+    }
+
+    std::string eta_to_display(double seconds)
+    {
+        if (seconds < 0.0)
+            return "--:--";
+        const auto s = static_cast<long long>(seconds + 0.5);
+        if (s >= 3600)
+            return fmt::format("{}:{:02}:{:02}", s / 3600, (s / 60) % 60, s % 60);
+        return fmt::format("{:02}:{:02}", s / 60, s % 60);
+    }
+}
+
+void imc::gui::draw_job_progress(const backend::job_t& job)
+{
+    const auto& progress = job.progress;
+    const uint64_t total = progress.total;
+    const uint64_t copied = progress.copied;
+    const size_t files_total = progress.files_total;
+    const size_t files_done = progress.files_done;
+    float fraction = 0.0f;
+    if (total > 0)
+        fraction = static_cast<float>(static_cast<double>(copied) / static_cast<double>(total));
+    else if (files_total > 0)
+        //nothing to count in bytes, deletes for one
+        fraction = static_cast<float>(files_done) / static_cast<float>(files_total);
+    auto overlay = fmt::format("{} / {}, {}/s, {} left {}", size_to_display_no_padding(copied), size_to_display_no_padding(total),
+                               size_to_display_no_padding(progress.bytes_per_second), eta_to_display(job.eta()),
+                               copy_method_name(progress.method));
+    if (files_total > 1)
+        overlay = fmt::format("{} / {} files, {}", files_done, files_total, overlay);
+    ImGui::ProgressBar(fraction, ImVec2(-1.0f, 0.0f), overlay.c_str());
+}
+
+std::string imc::gui::job_error_message(const backend::job_t& job)
+{
+    if (!job.ec)
+        return {};
+    if (job.progress.files_total > 1 && !job.failures.empty()) {
+        return fmt::format("{} of {} failed, {}: {}", job.failures.size(), job.progress.files_total.load(),
+                           job.failures.front().first.filename().generic_string(), job.failures.front().second.message());
+    }
+    return job.ec.message();
+}
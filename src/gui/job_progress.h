@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+namespace imc::backend {
+    struct job_t;
+}
+
+namespace imc::gui {
+    // Progress bar with done/total, throughput and time left.
+    void draw_job_progress(const backend::job_t& job);
+    // One line for a finished job that went wrong, batches say how many items failed.
+    std::string job_error_message(const backend::job_t& job);
+}
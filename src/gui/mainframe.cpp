@@ -9,8 +9,18 @@
 
 #include "utils/string_utils.h"
 #include "backend/file_operations.h"
+#include "backend/job_queue.h"
+#include "backend/batch.h"
 #include "backend/watch_dir.h"
+#include "backend/row_display.h"
+#include "backend/table_sort.h"
 #include "backend/error_message.h"
+#include "backend/find_in_files.h"
+#include "backend/list_dir.h"
+#include "backend/name_index.h"
+#include "backend/dir_size.h"
+#include "backend/listing_cache.h"
+#include "backend/prefetch.h"
 #include "types/op_file.h"
 #include "types/errors.h"
 #include <fmt/format.h>
@@ -21,22 +31,27 @@
 #include "move_file.h"
 #include "delete_file.h"
 #include "make_directory.h"
+#include "job_progress.h"
+#include "batch_dialog.h"
+#include "find_in_files.h"
+#include "find_file.h"
 
 #include <filesystem>
 #include <functional>
+#include <optional>
 #include <array>
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <ctime>
 #include <string>
+#include <string_view>
 #include <atomic>
+#include <mutex>
 #include <set>
 #include <unordered_map>
-#include <thread>
-
-#if !(__cpp_lib_atomic_shared_ptr >= 201711L)
-#include <shared_mutex>
-#endif
+#include <unordered_set>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -47,6 +62,23 @@ using namespace std::chrono_literals;
 
 
 namespace {
+    //indexes of the names under the roots the user picked, fed what the panes see change
+    name_indexes_t name_indexes;
+    bool name_indexes_loaded = false;
+    //what listing directories for their sizes found, shared by both panes
+    dir_size_cache_t dir_size_cache;
+    //listings of the directories the panes left, for going back to them
+    listing_cache_t listing_cache;
+
+    //what a pane lists instead of a directory
+    namespace results_kind {
+        constexpr int None = 0;
+        //files containing a string, found by find_in_files_t as the pane shows them
+        constexpr int Contents = 1;
+        //paths from a name index
+        constexpr int Names = 2;
+    }
+
     struct selected_file_t
     {
         selected_file_t()
@@ -68,49 +100,46 @@ namespace {
             move_to(fs::current_path());
         }
 
-        ~pane_data_t()
+        //Nothing here touches to_path, a dead mount would hang the ui. Whether it
+        //can be read at all comes out of the watcher's first pass, if it can't
+        //receive_table_data takes the pane back to previous_path.
+        void move_to(const fs::path& to_path)
         {
-            if (dir_watcher.joinable()) {
-                end_watcher = true;
-                dir_watcher.join();
-            }
-        }
+            //the listing we leave is kept, going back to it shows it right away
+            stash_listing();
+            if (to_path != current_path)
+                previous_path = current_path;
 
-        int move_to(const fs::path& to_path)
-        {
-            std::error_code ec;
-            auto beg = fs::directory_iterator(to_path, ec);
-            if (ec) {
-                last_error = error_message_t(ec.message(), 5000ms);
-                return 1;
-            }
-            //if we are here, we have access, proceed normally.
+            //a listing takes over from find results
+            finder.cancel();
+            name_search.cancel();
+            results = results_kind::None;
+            sizer.cancel();
 
-            //Step 1: Stop any running thread for this pane.
-            if (dir_watcher.joinable()) {
-                end_watcher = true;
-                dir_watcher.join();
-            }
+            //Step 1: Stop watching the old directory.
+            dir_watcher.stop();
 
             //Step 2: Setup data & callbacks
 
             current_path = to_path;
 
-            auto updateCallback = [this](TableRowDataVectorPtr data, size_t newHash) {
-#if __cpp_lib_atomic_shared_ptr >= 201711L
-                table_data.store(data);
-#else
-                std::unique_lock lock(mutex_);
-                table_data = data;
-#endif
+            auto updateCallback = [this](DirSnapshotPtr data) {
+                std::lock_guard lock(incoming.mutex);
+                incoming.table = data;
+                //any queued delta was made against the listing this one replaces
+                incoming.deltas.clear();
+            };
 
-                dir_dirty = true;
-                dir_hash = newHash;
+            auto deltaCallback = [this, dir = to_path](table_delta_t delta) {
+                name_indexes.apply(dir, delta);
+                std::lock_guard lock(incoming.mutex);
+                incoming.deltas.push_back(std::move(delta));
             };
 
             auto errorCallback = [this](const error_message_t& errorMsg)
             {
-                last_error = errorMsg;
+                std::lock_guard lock(incoming.mutex);
+                incoming.error = errorMsg;
             };
 
             //Step 3: Setup UI data.
@@ -118,24 +147,59 @@ namespace {
             auto curDir = to_path.generic_string();
             std::copy(curDir.begin(), curDir.end(), dir.begin());
 
-            //Step 4: Execute watch dir logic (Should be immediate results)
-            watch_dir(current_path, dir_hash, updateCallback, errorCallback);
-
-            //Step 5: Setup background thread that will watch the directory
-            end_watcher = false;
-            dir_watcher = std::thread([updateCallback = updateCallback, errorCallback = errorCallback](const std::atomic_bool& endme, fs::path cur, size_t oldHash) {
-                auto last_frame_time = std::chrono::high_resolution_clock::now();
-                while(!endme) {
-                    const auto this_frame_time = std::chrono::high_resolution_clock::now();
-                    if (std::chrono::duration_cast<std::chrono::milliseconds>(this_frame_time - last_frame_time).count() > 1000) {
-                        watch_dir(cur, oldHash, updateCallback, errorCallback);
-                        last_frame_time = this_frame_time;
-                    }
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                }
-            }, std::ref(end_watcher), to_path, dir_hash);
+            //Step 4: Show the listing we had or prefetched (the watcher brings it up to
+            //date first thing) or just ".." until the watcher's first pass lists it
+            if (auto ready = prefetcher.take())
+                listing_cache.put(std::move(*ready));
+            prefetcher.drop();
+            {
+                std::lock_guard lock(incoming.mutex);
+                incoming.table.reset();
+                incoming.deltas.clear();
+                //about the directory we left, it mustn't send this one back
+                incoming.error.reset();
+            }
+            dir_state_t dir_state;
+            if (auto cached = listing_cache.take(to_path)) {
+                cached->listing->directory = to_path;
+                dir_state = dir_state_of(*cached->listing);
+                //the orderings it had still fit it, the pane picks one up when it redraws the directory
+                table_data = std::move(cached->listing);
+                sorter = std::move(cached->sorter);
+                order.clear();
+                display_cache.clear();
+                listing_pending = false;
+            } else {
+                table_data = empty_listing(to_path);
+                sorter = {};
+                order.clear();
+                display_cache.clear();
+                listing_pending = true;
+            }
+
+            //Step 5: Watch the directory in the background
+            dir_watcher.start(current_path, std::move(dir_state), updateCallback, deltaCallback, errorCallback);
+        }
 
-            return 0;
+        //what the pane shows goes to the listing cache, find results don't
+        void stash_listing()
+        {
+            if (results != results_kind::None)
+                return;
+            cached_listing_t cached{ table_data, std::exchange(sorter, {}) };
+            {
+                std::lock_guard lock(incoming.mutex);
+                //a new listing the pane didn't pick up yet, the orderings are of the old one
+                if (incoming.table) {
+                    cached.listing = incoming.table;
+                    cached.sorter.invalidate();
+                } else if (listing_pending) {
+                    //only ".." so far, nothing worth going back to
+                    return;
+                }
+            }
+            if (cached.listing && cached.listing->directory == current_path)
+                listing_cache.put(std::move(cached));
         }
 
         int id;
@@ -164,18 +228,25 @@ namespace {
         navigate_state_t navigate;*/
 
         fs::path current_path;
+        //where the pane was before current_path, it goes back there when current_path can't be listed
+        fs::path previous_path;
         std::array<char, 1024> dir = {0};
-#if __cpp_lib_atomic_shared_ptr >= 201711L
-        std::atomic<TableRowDataVectorPtr> table_data;
-#else
-        mutable std::shared_mutex mutex_;
-        TableRowDataVectorPtr table_data;
-#endif
+        //only touched by the ui thread, the watcher hands over changes through incoming.
+        DirSnapshotPtr table_data;
+        //table_data row indices in display order
+        std::vector<uint32_t> order;
+        table_sorter_t sorter;
+        row_display_cache_t display_cache;
+        struct incoming_t
+        {
+            std::mutex mutex;
+            DirSnapshotPtr table;
+            std::vector<table_delta_t> deltas;
+            std::optional<error_message_t> error;
+        } incoming;
+        //table_data is the stand in empty_listing() until the first listing arrives
+        bool listing_pending{false};
         std::set<size_t> selection;
-        //quick access to selection data, could have literally all files in directory here..is that good?
-        //maybe we just pull dynamically ?
-        //or maintain a index for id sorted list.
-        std::unordered_map<size_t, table_row_data_t*> selection_data;
         //We could probably collapse these into mode + state
         //rename state
         selected_file_t rename;
@@ -198,141 +269,367 @@ namespace {
         fs::path move_to_path;
         std::atomic_bool dir_dirty{false};
         //Directory update thread data
-        std::atomic_bool end_watcher{false};
-        std::thread dir_watcher;
-        size_t dir_hash{0};
+        dir_watcher_t dir_watcher;
+        //find in files and find file, the pane lists what they found instead of a directory
+        int results{results_kind::None};
+        find_in_files_t finder;
+        std::string find_needle;
+        op_file_t find_file;
+        bool find_match_case{false};
+        op_file_t find_name_file;
+        //name index matches, stat'ed in the background, and what was searched
+        name_search_t name_search;
+        std::string results_status;
+        //sizes of the directories listed, filled in as they finish
+        dir_sizer_t sizer;
+        //the directory the mouse or the selection rests on, and since when
+        fs::path prefetch_candidate;
+        std::chrono::steady_clock::time_point prefetch_since;
+        listing_prefetcher_t prefetcher;
+        //from asking for a directory to its rows sorted (its listing, not the stand in), the last time
+        std::chrono::steady_clock::time_point navigation_started;
+        std::chrono::duration<double, std::milli> navigation_time{0.0};
 
         error_message_t last_error;
     };
 
     //global mainframe state
     pane_data_t ldata(0), rdata(1);
+    //copies, moves and deletes run here, never on the ui thread
+    job_queue_t job_queue;
+    bool show_jobs = false;
+    size_t last_job_count = 0;
     bool force_dir_always_before = true;
     int selected_panel = 0;
     std::string hover_text = "";
     bool rename_mode = false;
     bool view_mode = false;
+    bool find_requested = false;
+    bool find_name_requested = false;
+    bool sizes_requested = false;
+    //how long the mouse or the selection has to stay on a directory before it gets listed
+    constexpr auto prefetch_dwell = 100ms;
+    //the Modified column's formats to pick from, strftime like
+    constexpr std::array<std::pair<const char*, const char*>, 3> date_formats{{
+        { "MM-DD-YY 12h", "%m-%d-%y %I:%M %p" },
+        { "YYYY-MM-DD 24h", "%Y-%m-%d %H:%M" },
+        { "DD.MM.YYYY 24h", "%d.%m.%Y %H:%M" },
+    }};
+    //every match of a name query gets a stat, on the executor
+    constexpr size_t max_name_results = 5000;
     bool should_close = false;
 
-    int sort_by_name(const TableRowData& lhs, const TableRowData& rhs)
-    {
-        const bool lhs_is_directory = lhs->is_directory;
-        const bool rhs_is_directory = rhs->is_directory;
-        if (lhs_is_directory) {
-            if (rhs_is_directory) {
-                if (lhs->is_imaginary)
-                    return -1;
-                if (rhs->is_imaginary)
-                    return +1;
-                return icompare(lhs->name, rhs->name);
-            }
-            return -1;
-        } else {
-            if (rhs_is_directory)
-                return +1;
-            return icompare(lhs->name, rhs->name);
+    using row_index_t = uint32_t;
+
+    table_sort_specs_t to_table_sort_specs(const ImGuiTableSortSpecs* sort_specs)
+    {
+        table_sort_specs_t specs;
+        specs.dirs_first = force_dir_always_before;
+        for(int n = 0; n < sort_specs->SpecsCount; n++) {
+            const ImGuiTableColumnSortSpecs& spec = sort_specs->Specs[n];
+            specs.columns.push_back({ static_cast<int>(spec.ColumnUserID), spec.SortDirection == ImGuiSortDirection_Ascending });
         }
+        return specs;
     }
 
-    int sort_by_ext(const TableRowData& lhs, const TableRowData& rhs)
+    //Sorts rows that aren't in the order (new or taken out) and merges them in.
+    //Going from the back, each one's place is found by binary search and the
+    //rows after it move up once, so only what comes after the first of them moves.
+    template<typename FNLess>
+    void merge_into_order(pane_data_t& data, std::vector<row_index_t>& merge, FNLess less)
     {
-        const bool lhs_is_directory = lhs->is_directory;
-        const bool rhs_is_directory = rhs->is_directory;
-        if (lhs_is_directory) {
-            if (rhs_is_directory) {
-                if (lhs->is_imaginary)
-                    return true;
-                if (rhs->is_imaginary)
-                    return false;
-                return icompare(lhs->name, rhs->name);
+        if (merge.empty())
+            return;
+        std::sort(merge.begin(), merge.end(), less);
+        auto& order = data.order;
+        const auto old_size = static_cast<std::ptrdiff_t>(order.size());
+        order.resize(order.size() + merge.size());
+        auto end = order.begin() + old_size;
+        auto out = order.end();
+        for(auto it = merge.rbegin(); it != merge.rend(); ++it) {
+            const auto place = std::upper_bound(order.begin(), end, *it, less);
+            out = std::move_backward(place, end, out);
+            *--out = *it;
+            end = place;
+        }
+    }
+
+    //Takes rows out of the order, which is sorted by less. Each one is found by
+    //binary search, only what comes after the first of them moves.
+    template<typename FNLess>
+    void take_out_of_order(pane_data_t& data, const std::vector<row_index_t>& leaving, FNLess less)
+    {
+        auto& order = data.order;
+        std::vector<std::ptrdiff_t> positions;
+        positions.reserve(leaving.size());
+        for(const auto row : leaving) {
+            auto it = std::lower_bound(order.begin(), order.end(), row, less);
+            //the order was sorted some other way, never expected
+            if (it == order.end() || *it != row)
+                it = std::find(order.begin(), order.end(), row);
+            if (it != order.end())
+                positions.push_back(it - order.begin());
+        }
+        if (positions.empty())
+            return;
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+        //what lies between two leaving rows slides down over the first of them
+        auto out = order.begin() + positions.front();
+        for(size_t i = 0; i < positions.size(); i++) {
+            const auto next = i + 1 < positions.size() ? order.begin() + positions[i + 1] : order.end();
+            out = std::move(order.begin() + positions[i] + 1, next, out);
+        }
+        order.erase(out, order.end());
+    }
+
+    //Applies a delta to the snapshot and its (already sorted) order without resorting:
+    //removed rows are dropped, changed rows are updated in place and then merged
+    //back into the order together with the new ones. The work is in the size of
+    //the delta, not of the listing.
+    void apply_table_delta(pane_data_t& data, dir_snapshot_t& rows, table_delta_t& delta, const table_sort_specs_t& sort_specs)
+    {
+        auto less = [&sort_specs, &rows](row_index_t lhs, row_index_t rhs) {
+            return row_less(rows, sort_specs, lhs, rhs);
+        };
+        //the keys no longer match the rows, orderings for other columns get rebuilt when asked for
+        data.sorter.invalidate();
+        //a row we already have (a rename applied before its delta came) is only changed
+        for(auto it = delta.added.begin(); it != delta.added.end();) {
+            if (rows.find(it->id) != dir_snapshot_t::npos) {
+                delta.modified.push_back(std::move(*it));
+                it = delta.added.erase(it);
+            } else
+                ++it;
+        }
+
+        std::vector<row_index_t> merge;
+        merge.reserve(delta.added.size() + delta.modified.size());
+        if (!delta.removed.empty() || !delta.modified.empty()) {
+            //rows that have to leave the current order, either for good or to be merged back in.
+            //They are found while their keys still are the ones the order was sorted by.
+            std::vector<row_index_t> leaving;
+            leaving.reserve(delta.removed.size() + delta.modified.size());
+            for(const auto id : delta.removed) {
+                if (const auto row = rows.find(id); row != dir_snapshot_t::npos)
+                    leaving.push_back(static_cast<row_index_t>(row));
             }
-            return +1;
-        } else {
-            if (rhs_is_directory)
-                return -1;
-            return icompare(lhs->ext, rhs->ext);
+            for(const auto& modified : delta.modified) {
+                if (const auto row = rows.find(modified.id); row != dir_snapshot_t::npos)
+                    leaving.push_back(static_cast<row_index_t>(row));
+            }
+            take_out_of_order(data, leaving, less);
+
+            for(const auto id : delta.removed) {
+                if (const auto row = rows.find(id); row != dir_snapshot_t::npos) {
+                    rows.remove(row);
+                    data.selection.erase(id);
+                }
+            }
+            for(const auto& modified : delta.modified) {
+                //modified rows we never had are just new rows
+                if (const auto row = rows.find(modified.id); row != dir_snapshot_t::npos) {
+                    rows.update(row, modified);
+                    merge.push_back(static_cast<row_index_t>(row));
+                } else
+                    merge.push_back(static_cast<row_index_t>(rows.push_back(modified)));
+            }
+        }
+        for(const auto& row : delta.added)
+            merge.push_back(static_cast<row_index_t>(rows.push_back(row)));
+
+        merge_into_order(data, merge, less);
+
+        //too many dead slots, give the memory back.
+        if (rows.removed > 1024 && rows.removed > rows.size() / 2) {
+            const auto remap = rows.compact();
+            for(auto& index : data.order)
+                index = remap[index];
         }
     }
 
-    int sort_by_size(const TableRowData& lhs, const TableRowData& rhs)
+    //Calculated directory sizes go into their rows, which move to where the new size sorts them.
+    void apply_dir_sizes(pane_data_t& data, dir_snapshot_t& rows, const table_sort_specs_t& sort_specs)
     {
-        const bool lhs_is_directory = lhs->is_directory;
-        const bool rhs_is_directory = rhs->is_directory;
-        if (lhs_is_directory) {
-            if (rhs_is_directory) {
-                if (lhs->is_imaginary)
-                    return true;
-                if (rhs->is_imaginary)
-                    return false;
-                return icompare(lhs->name, rhs->name);
+        auto sizes = data.sizer.take_results();
+        if (sizes.empty())
+            return;
+        auto less = [&sort_specs, &rows](row_index_t lhs, row_index_t rhs) {
+            return row_less(rows, sort_specs, lhs, rhs);
+        };
+        std::vector<row_index_t> merge;
+        merge.reserve(sizes.size());
+        for(const auto& size : sizes) {
+            const auto row = rows.find(entry_id(size.name));
+            if (row != dir_snapshot_t::npos && rows.is_directory(row))
+                merge.push_back(static_cast<row_index_t>(row));
+        }
+        if (merge.empty())
+            return;
+        //a directory sized twice moves once
+        std::sort(merge.begin(), merge.end());
+        merge.erase(std::unique(merge.begin(), merge.end()), merge.end());
+        data.sorter.invalidate();
+        take_out_of_order(data, merge, less);
+        for(const auto& size : sizes) {
+            const auto row = rows.find(entry_id(size.name));
+            if (row != dir_snapshot_t::npos && rows.is_directory(row)) {
+                rows.sizes[row] = size.bytes;
+                rows.flags[row] |= entry_flags::SizeKnown;
             }
-            return +1;
-        } else {
-            if (rhs_is_directory)
-                return -1;
-            if (lhs->size == rhs->size)
-                return 0;
-            else if (lhs->size < rhs->size)
-                return -1;
-            else
-                return +1;
         }
+        merge_into_order(data, merge, less);
     }
 
-    int sort_by_modified(const TableRowData& lhs, const TableRowData& rhs)
+    //Picks up whatever the watcher produced since the last frame, a whole new
+    //listing gets sorted here so the deltas after it can be merged into its order.
+    void receive_table_data(pane_data_t& data, const table_sort_specs_t& sort_specs)
     {
-        const bool lhs_is_directory = lhs->is_directory;
-        const bool rhs_is_directory = rhs->is_directory;
-        if (lhs_is_directory) {
-            if (rhs_is_directory) {
-                if (lhs->is_imaginary)
-                    return true;
-                if (rhs->is_imaginary)
-                    return false;
-                return (lhs->modified - rhs->modified).count();
+        DirSnapshotPtr table;
+        std::vector<table_delta_t> deltas;
+        std::optional<error_message_t> error;
+        {
+            std::lock_guard lock(data.incoming.mutex);
+            table = std::move(data.incoming.table);
+            deltas = std::move(data.incoming.deltas);
+            error = std::move(data.incoming.error);
+            data.incoming.table.reset();
+            data.incoming.deltas.clear();
+            data.incoming.error.reset();
+        }
+        if (error) {
+            data.last_error = std::move(*error);
+            //not even the first listing came, the directory can't be read
+            if (data.listing_pending && data.results == results_kind::None && !data.previous_path.empty()) {
+                //only once, if that fails too the pane stays put
+                const auto back = data.previous_path;
+                data.navigation_started = std::chrono::steady_clock::now();
+                data.move_to(back);
+                data.previous_path.clear();
             }
-            return +1;
+        }
+
+        if (table) {
+            data.table_data = table;
+            data.display_cache.clear();
+            data.sorter.invalidate();
+            data.order = data.sorter.sorted(*table, sort_specs);
+            if (std::exchange(data.listing_pending, false))
+                data.navigation_time = std::chrono::steady_clock::now() - data.navigation_started;
+            //drop whatever is selected but no longer exists.
+            std::unordered_set<size_t> ids(table->ids.begin(), table->ids.end());
+            std::erase_if(data.selection, [&](size_t id) { return !ids.contains(id); });
+        }
+
+        if (data.table_data) {
+            for(auto& delta : deltas)
+                apply_table_delta(data, *data.table_data, delta, sort_specs);
+        }
+
+        //matches arrive like new files in a listing, merged into the current order
+        if (data.results != results_kind::None && data.table_data) {
+            table_delta_t found;
+            found.added = data.results == results_kind::Contents ? data.finder.take_results() : data.name_search.take_results();
+            if (!found.empty())
+                apply_table_delta(data, *data.table_data, found, sort_specs);
+        }
+
+        if (data.table_data)
+            apply_dir_sizes(data, *data.table_data, sort_specs);
+    }
+
+    //The pane lists what a search finds, named relative to root so
+    //everything that works on a listing (view, copy, open...) works on it too.
+    void show_results(pane_data_t& data, const fs::path& root, int kind)
+    {
+        //"Back" brings the listing back from the cache
+        data.stash_listing();
+        data.dir_watcher.stop();
+        {
+            std::lock_guard lock(data.incoming.mutex);
+            data.incoming.table.reset();
+            data.incoming.deltas.clear();
+        }
+        auto results = std::make_shared<dir_snapshot_t>();
+        results->directory = root;
+        data.table_data = results;
+        data.listing_pending = false;
+        data.order.clear();
+        data.selection.clear();
+        data.display_cache.clear();
+        data.sorter.invalidate();
+        data.sizer.cancel();
+        data.name_search.cancel();
+        data.results = kind;
+    }
+
+    void start_find_in_files(pane_data_t& data)
+    {
+        show_results(data, data.current_path, results_kind::Contents);
+        data.find_needle = data.find_file.file.data();
+        data.finder.start(data.current_path, data.find_needle, !data.find_match_case);
+    }
+
+    //The index answers with paths, the rows come from a stat of each so what is
+    //gone since the index was written doesn't show up. Both run on the executor.
+    void start_find_file(pane_data_t& data)
+    {
+        const auto root = name_indexes.root_of(data.current_path);
+        const auto index = root.empty() ? nullptr : name_indexes.index(root);
+        if (!index)
+            return;
+        show_results(data, root, results_kind::Names);
+        data.find_needle = data.find_name_file.file.data();
+        data.results_status = fmt::format("{} names indexed under {}{}", index->size(), root.generic_string(),
+            index->changes() ? fmt::format(" (+{} changes)", index->changes()) : "");
+        data.name_search.start(index, data.find_needle, max_name_results);
+    }
+
+    void draw_name_status(pane_data_t& data)
+    {
+        const auto& search = data.name_search;
+        if (search.running() && search.matches() == 0) {
+            ImGui::TextDisabled("'%s': searching %s", data.find_needle.c_str(), data.results_status.c_str());
         } else {
-            if (rhs_is_directory)
-                return -1;
-            return (lhs->modified - rhs->modified).count();
-        }
-    }
-
-    void sort_data_by(ImGuiTableSortSpecs* sort_specs, TableRowDataVector& table_data)
-    {
-        std::sort(table_data.begin(), table_data.end(), [&](const TableRowData& lhs, const TableRowData& rhs) -> bool {
-            for(int n = 0; n < sort_specs->SpecsCount; n++) {
-                int delta = 0;
-                const ImGuiTableColumnSortSpecs* sort_spec = &sort_specs->Specs[n];
-                switch(sort_spec->ColumnUserID) {
-                    using namespace sortable_columns;
-                    case Name: delta = sort_by_name(lhs, rhs); break;
-                    case Ext:  delta = sort_by_ext(lhs, rhs);  break;
-                    case Size: delta = sort_by_size(lhs, rhs); break;
-                    case Modified: delta = sort_by_modified(lhs, rhs); break;
-                    case Permissions: delta = icompare(lhs->permissions_display, rhs->permissions_display);
-                    default: assert(false); break;
-                }
+            const auto matches = search.matches();
+            ImGui::TextDisabled("'%s': %zu%s names in %.2f ms, %s", data.find_needle.c_str(), matches,
+                matches == max_name_results ? "+" : "", search.searched().count(), data.results_status.c_str());
+        }
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Back"))
+            data.dir_dirty = true;
+    }
 
-                if (force_dir_always_before && (lhs->is_directory || rhs->is_directory) && !(lhs->is_directory && rhs->is_directory)) {
-                    if (lhs->is_directory)
-                        return true;
-                    return false;
-                }
-                if (force_dir_always_before && lhs->is_directory && rhs->is_directory) {
-                    if (lhs->is_imaginary)
-                        return true;
-                    if (rhs->is_imaginary)
-                        return false;
-                }
-                if (delta > 0)
-                    return (sort_spec->SortDirection == ImGuiSortDirection_Ascending) ? false : true;
-                if (delta < 0)
-                    return (sort_spec->SortDirection == ImGuiSortDirection_Ascending) ? true: false;
-            }
-            return sort_by_name(lhs, rhs) < 0;
-        });
+    void draw_find_status(pane_data_t& data)
+    {
+        const auto& stats = data.finder.stats();
+        const double seconds = std::max(data.finder.elapsed().count(), 0.001);
+        const auto status = fmt::format("'{}': {} of {} files ({} binary), {} in {:.1f}s, {:.0f} files/s, {}/s",
+            data.find_needle, stats.matched.load(), stats.files.load(), stats.binary.load(),
+            size_to_display_no_padding(stats.bytes), seconds, static_cast<double>(stats.files) / seconds,
+            size_to_display_no_padding(static_cast<size_t>(static_cast<double>(stats.bytes) / seconds)));
+        ImGui::TextDisabled("%s", status.c_str());
+        ImGui::SameLine();
+        if (data.finder.running()) {
+            if (ImGui::SmallButton("Stop"))
+                data.finder.cancel();
+        } else if (ImGui::SmallButton("Back")) {
+            //back to listing the directory the search started from
+            data.dir_dirty = true;
+        }
+    }
+
+    void draw_sizer_status(pane_data_t& data)
+    {
+        const auto& stats = data.sizer.stats();
+        const auto status = fmt::format("sizing {} of {} directories: {} directories ({} listed), {} files in {:.1f}s",
+            stats.finished.load(), stats.requested.load(), stats.directories.load(), stats.listed.load(),
+            stats.files.load(), data.sizer.elapsed().count());
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", status.c_str());
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Stop"))
+            data.sizer.cancel();
     }
 
     void pre_draw_pane(pane_data_t& data)
@@ -344,96 +641,109 @@ namespace {
         }
     }
 
-    void process_change_dir(pane_data_t& data, bool& dir_dirty)
+    //typed: the path comes from the edit box, keystroke by keystroke, it is only
+    //gone to once it exists. Rows and refreshes name a directory that was there,
+    //they don't stat it on the ui thread.
+    void process_change_dir(pane_data_t& data, bool& dir_dirty, bool typed)
     {
         fs::path changeTo = data.dir.data();
-        if (fs::exists(changeTo)) {
-            if (0 != data.move_to(changeTo)) {
-                auto undo = data.current_path.generic_string();
-                data.dir.fill('\0');
-                std::copy(undo.begin(), undo.end(), data.dir.begin());
-                //if you were trying to move, now you are not.
-                data.im_moving = false;
-                return;
-            }
+        if (!typed || fs::exists(changeTo)) {
+            data.navigation_started = std::chrono::steady_clock::now();
+            data.move_to(changeTo);
             data.selection.clear();
-            data.selection_data.clear();
             dir_dirty = true;
             data.im_moving = false;
             data.dir_dirty = false;
         }
     }
 
-    void process_navigate(pane_data_t& data, const table_row_data_t* row)
+    void process_navigate(pane_data_t& data, const dir_snapshot_t& rows, row_index_t row)
     {
-        if (row->is_directory) {
+        if (rows.is_directory(row)) {
             data.im_moving = true;
-            data.move_to_path = row->is_imaginary ?
-                data.current_path.parent_path() :
-                data.current_path / row->name;
-        } else if (row->is_regular_file) {
-            imc::backend::open(fs::path(row->absolute_path));
+            //a results pane lists rows from many directories, the row knows its own
+            data.move_to_path = rows.absolute_path(row);
+        } else if (rows.has(row, entry_flags::RegularFile)) {
+            imc::backend::open(rows.absolute_path(row));
         }
     }
 
-    void process_selection(pane_data_t& data, table_row_data_t* row, const bool is_selected)
+    void process_selection(pane_data_t& data, size_t rowid, const bool is_selected)
     {
         selected_panel = data.id;
 
         if (data.im_moving)
             return;
 
-        auto rowid = row->id;
-
         if (ImGui::GetIO().KeyCtrl)
         {
             if (is_selected) {
                 data.selection.erase(rowid);
             } else {
                 data.selection.insert(rowid);
-                data.selection_data[rowid] = row;
             }
         } else {
             data.selection.clear();
             data.selection.insert(rowid);
-            data.selection_data[rowid] = row;
         }
     }
 
-    void process_rename_file(pane_data_t& data, table_row_data_t* row)
+    //The renamed row goes through a delta right away: out under its old id and sort keys,
+    //in under the new ones. When the watcher reports the same rename it finds the new id there.
+    void process_rename_file(pane_data_t& data, dir_snapshot_t& rows, row_index_t row, const table_sort_specs_t& sort_specs)
     {
         std::error_code ec;
         fs::path rename_to = data.rename.old_file;
         rename_to.replace_filename(fs::path(data.rename.file.data()));
-        if (fs::rename(data.rename.old_file, rename_to, ec); !ec) {
-            row->absolute_path = rename_to.generic_string();
-            if (rename_to.has_extension())
-                row->ext = rename_to.extension();
-            if (rename_to.has_stem())
-                row->name = rename_to.stem();
-            rename_mode = false;
+        if (fs::rename(data.rename.old_file, rename_to, ec); ec)
+            return;
+        rename_mode = false;
+
+        const size_t old_id = rows.ids[row];
+        table_delta_t delta;
+        delta.removed.push_back(old_id);
+        //named relative to the listing, a result keeps the directory it was found in
+        const auto relative = fs::path(rows.file_name(row)).replace_filename(rename_to.filename());
+        table_row_data_t renamed;
+        if (stat_entry(rename_to.parent_path(), rename_to.filename().generic_string(), renamed)) {
+            if (const auto dir = relative.parent_path().generic_string(); !dir.empty())
+                renamed.name = dir + "/" + renamed.name;
+            renamed.id = entry_id(relative.generic_string());
+            if (data.selection.contains(old_id))
+                data.selection.insert(renamed.id);
+            delta.added.push_back(std::move(renamed));
         }
+        apply_table_delta(data, rows, delta, sort_specs);
     }
 
-    std::string get_hover_text_from_row(const table_row_data_t* row)
+    std::string get_hover_text_from_row(const dir_snapshot_t& rows, row_index_t row)
     {
-        if (row->is_imaginary)
+        if (rows.is_imaginary(row))
             return "";
-        if (row->is_directory)
-            return row->name;
-        if (row->is_regular_file)
-            return fmt::format("{}{} ({}) ({})", row->name, row->ext, size_to_display_no_padding(row->size), row->id);
-        return row->name;
+        if (rows.is_directory(row))
+            return std::string(rows.name(row));
+        if (rows.has(row, entry_flags::RegularFile))
+            return fmt::format("{}{} ({}) ({})", rows.name(row), rows.ext(row), size_to_display_no_padding(rows.sizes[row]), rows.ids[row]);
+        return std::string(rows.name(row));
     }
 
-    auto get_table_data(pane_data_t& data)
+    //A directory the mouse rests on (or the only one selected) is listed in the background
+    //and goes to the listing cache, entering it then finds it there. Moving on drops it.
+    void prefetch_listing(pane_data_t& data, const fs::path& candidate, const table_sort_specs_t& sort_specs)
     {
-#if __cpp_lib_atomic_shared_ptr >= 201711L
-        return data.table_data.load();
-#else
-        std::shared_lock lock(data.mutex_);
-        return data.table_data;
-#endif
+        if (auto ready = data.prefetcher.take())
+            listing_cache.put(std::move(*ready));
+        const auto now = std::chrono::steady_clock::now();
+        if (candidate != data.prefetch_candidate) {
+            data.prefetch_candidate = candidate;
+            data.prefetch_since = now;
+            data.prefetcher.drop();
+            return;
+        }
+        if (candidate.empty() || now - data.prefetch_since < prefetch_dwell ||
+            candidate == data.current_path || listing_cache.contains(candidate))
+            return;
+        data.prefetcher.want(candidate, sort_specs);
     }
 
     void draw_pane(pane_data_t& data)
@@ -441,13 +751,16 @@ namespace {
         bool dir_dirty = false;
         pre_draw_pane(data);
         ImGui::PushItemWidth(-1.0f);
-        if (ImGui::InputText("##[D]", data.dir.data(), data.dir.size()) || data.im_moving || data.dir_dirty) {
-            process_change_dir(data, dir_dirty);
+        const bool typed = ImGui::InputText("##[D]", data.dir.data(), data.dir.size());
+        if (typed || data.im_moving || data.dir_dirty) {
+            process_change_dir(data, dir_dirty, typed && !data.im_moving && !data.dir_dirty);
         }
         ImGui::PopItemWidth();
         if (!data.last_error.last_error.empty() && data.last_error.show_until >= std::chrono::high_resolution_clock::now())
             ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", data.last_error.last_error.c_str());
-        if (ImGui::BeginTable("#file_list", 5, ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti | ImGuiTableFlags_ScrollY)) {
+        //leave room for the status line under the table
+        const ImVec2 table_size(0.0f, -ImGui::GetTextLineHeightWithSpacing());
+        if (ImGui::BeginTable("#file_list", 5, ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti | ImGuiTableFlags_ScrollY, table_size)) {
             ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_PreferSortAscending, 0.0f, sortable_columns::Name);
             ImGui::TableSetupColumn("Ext", ImGuiTableColumnFlags_WidthFixed, 40.0f, sortable_columns::Ext);
             ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthFixed, 80.0f, sortable_columns::Size);
@@ -455,50 +768,92 @@ namespace {
             ImGui::TableSetupColumn("rwx", ImGuiTableColumnFlags_WidthFixed, 80.0f, sortable_columns::Permissions);
             ImGui::TableSetupScrollFreeze(0, 1); // Make row always visible
             ImGui::TableHeadersRow();
-            if (auto rows = get_table_data(data); rows) {
-                if (ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs(); sort_specs->SpecsDirty || dir_dirty) {
-                    sort_data_by(sort_specs, *rows);
+            ImGuiTableSortSpecs* sort_specs = ImGui::TableGetSortSpecs();
+            const auto table_sort_specs = to_table_sort_specs(sort_specs);
+            receive_table_data(data, table_sort_specs);
+            if (auto rows = data.table_data; rows) {
+                if (sort_specs->SpecsDirty || dir_dirty) {
+                    data.order = data.sorter.sorted(*rows, table_sort_specs);
                     sort_specs->SpecsDirty = false;
                 }
+                if (dir_dirty && !data.listing_pending)
+                    data.navigation_time = std::chrono::steady_clock::now() - data.navigation_started;
                 const int ciMaxCol = 5;
-                for(auto& row : *rows) {
-                    ImGui::PushID(row->absolute_path.c_str());
-                    ImGui::TableNextRow();
-                    for(int col = 0; col < ciMaxCol; col++) {
-                        ImGui::TableSetColumnIndex(col);
-                        if (col == 0) {
-                            const bool is_selected = data.selection.contains(row->id);
-                            if (data.id == selected_panel && rename_mode && data.rename.id == row->id) {
-                                if (ImGui::InputText("##edit", data.rename.file.data(), data.rename.file.size(),
-                                    ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll)) {
-                                    process_rename_file(data, row.get());
-                                }
-                            } else {
-                                if (ImGui::Selectable(row->get_column(col).c_str(), is_selected, ImGuiSelectableFlags_SpanAllColumns |
-                                        ImGuiSelectableFlags_AllowDoubleClick)) {
-                                    if (ImGui::IsMouseDoubleClicked(ImGuiPopupFlags_MouseButtonLeft)) {
-                                        process_navigate(data, row.get());
+                data.display_cache.new_frame();
+                fs::path hovered_dir, selected_dir;
+                //renamed once the rows are drawn, the rename moves rows in the order
+                std::optional<row_index_t> renamed_row;
+                //only the rows that are on screen get submitted, frame time doesn't depend on the directory size.
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(data.order.size()));
+                while (clipper.Step()) {
+                    for(int row_n = clipper.DisplayStart; row_n < clipper.DisplayEnd; row_n++) {
+                        const row_index_t row = data.order[row_n];
+                        const size_t rowid = rows->ids[row];
+                        //the id is already a hash of the path, no need to hash the path again.
+                        ImGui::PushID(reinterpret_cast<const void*>(static_cast<uintptr_t>(rowid)));
+                        ImGui::TableNextRow();
+                        for(int col = 0; col < ciMaxCol; col++) {
+                            ImGui::TableSetColumnIndex(col);
+                            const std::string_view text = data.display_cache.get_column(*rows, row, col);
+                            if (col == 0) {
+                                const bool is_selected = data.selection.contains(rowid);
+                                if (data.id == selected_panel && rename_mode && data.rename.id == rowid) {
+                                    if (ImGui::InputText("##edit", data.rename.file.data(), data.rename.file.size(),
+                                        ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll)) {
+                                        renamed_row = row;
+                                    }
+                                } else {
+                                    //Selectable wants a terminated label, the arena isn't.
+                                    char label[512];
+                                    const auto label_len = std::min(text.size(), sizeof(label) - 1);
+                                    std::copy_n(text.data(), label_len, label);
+                                    label[label_len] = '\0';
+                                    if (ImGui::Selectable(label, is_selected, ImGuiSelectableFlags_SpanAllColumns |
+                                            ImGuiSelectableFlags_AllowDoubleClick)) {
+                                        if (ImGui::IsMouseDoubleClicked(ImGuiPopupFlags_MouseButtonLeft)) {
+                                            process_navigate(data, *rows, row);
+                                        }
+                                        process_selection(data, rowid, is_selected);
+                                    }
+                                    if (ImGui::IsItemHovered()) {//"Sample Hover Text.pdf 500B PDF Document";
+                                        hover_text = get_hover_text_from_row(*rows, row);
+                                        if (rows->is_directory(row))
+                                            hovered_dir = rows->absolute_path(row);
+                                    } else if (is_selected && data.selection.size() == 1 && rows->is_directory(row)) {
+                                        selected_dir = rows->absolute_path(row);
                                     }
-                                    process_selection(data, row.get(), is_selected);
-                                }
-                                if (ImGui::IsItemHovered()) {//"Sample Hover Text.pdf 500B PDF Document";
-                                    hover_text = get_hover_text_from_row(row.get());
                                 }
                             }
+                            else
+                                ImGui::TextUnformatted(text.data(), text.data() + text.size());
                         }
-                        else
-                            ImGui::TextUnformatted(row->get_column(col).c_str());
+                        ImGui::PopID();
                     }
-                    ImGui::PopID();
                 }
+                if (renamed_row)
+                    process_rename_file(data, *rows, *renamed_row, table_sort_specs);
+                prefetch_listing(data, hovered_dir.empty() ? selected_dir : hovered_dir, table_sort_specs);
             }
             ImGui::EndTable();
         }
+        if (data.results == results_kind::Contents) {
+            draw_find_status(data);
+        } else if (data.results == results_kind::Names) {
+            draw_name_status(data);
+        } else if (auto rows = data.table_data; rows) {
+            const size_t memory = rows->memory_usage();
+            const size_t entries = rows->live_size();
+            ImGui::TextDisabled("%zu entries, %s (%zu B/entry), entered in %.1f ms", entries,
+                size_to_display_no_padding(memory).c_str(), entries ? memory / entries : 0U, data.navigation_time.count());
+            if (data.sizer.running())
+                draw_sizer_status(data);
+        }
     }
 
     void get_selected_file(pane_data_t& data, selected_file_t& sel, bool& enable_mode)
     {
-        if (!data.selection.empty()) {
+        if (!data.selection.empty() && data.table_data) {
             size_t selected_id;
             if (data.selection.size() == 1) {
                 selected_id = *data.selection.begin();
@@ -506,9 +861,10 @@ namespace {
                 //maybe use vector hmm
                 selected_id = *std::max_element(data.selection.begin(), data.selection.end());
             }
-            auto& selected_data = data.selection_data[selected_id];
-            if (!selected_data->is_imaginary) {
-                auto selected_path = fs::path(selected_data->absolute_path);
+            const auto& rows = *data.table_data;
+            const auto row = rows.find(selected_id);
+            if (row != dir_snapshot_t::npos && !rows.is_imaginary(row)) {
+                auto selected_path = rows.absolute_path(row);
                 auto selected_file = selected_path.filename().generic_string();
                 sel.file.fill('\0');
                 std::copy(selected_file.begin(), selected_file.end(), sel.file.begin());
@@ -519,6 +875,39 @@ namespace {
         }
     }
 
+    //every selected row's path in display order, ".." never counts
+    std::vector<fs::path> get_selected_paths(const pane_data_t& data)
+    {
+        std::vector<fs::path> paths;
+        if (!data.table_data)
+            return paths;
+        const auto& rows = *data.table_data;
+        for(const auto row : data.order) {
+            if (!rows.is_imaginary(row) && data.selection.contains(rows.ids[row]))
+                paths.push_back(rows.absolute_path(row));
+        }
+        return paths;
+    }
+
+    //With more than one row selected the whole selection goes as one batch,
+    //file then holds the destination directory (or just a description for deletes).
+    bool get_batch_files(const pane_data_t& data, const fs::path& to_dir, op_file_t& op, int kind)
+    {
+        op.old_files.clear();
+        if (data.selection.size() < 2)
+            return false;
+        auto paths = get_selected_paths(data);
+        if (paths.size() < 2)
+            return false;
+        imc::gui::reset_batch_dialog(kind);
+        op.old_file = paths.front();
+        op.old_files = std::move(paths);
+        const auto text = to_dir.empty() ? fmt::format("{} items", op.old_files.size()) : to_dir.generic_string();
+        std::fill(op.file.begin(), op.file.end(), '\0');
+        std::copy_n(text.begin(), std::min(text.size(), op.file.size() - 1), op.file.begin());
+        return true;
+    }
+
     void get_rename_file(int pane_selected)
     {
         if (pane_selected == 0)
@@ -538,6 +927,10 @@ namespace {
 
     void get_copy_file(int pane_selected)
     {
+        auto& from = pane_selected == 0 ? ldata : rdata;
+        auto& to = pane_selected == 0 ? rdata : ldata;
+        if (get_batch_files(from, to.current_path, from.copy_file, batch_kind::Copy))
+            return;
         bool enable_view = false;
         if (pane_selected == 0) {
             get_selected_file(ldata, ldata.copy, enable_view);
@@ -560,6 +953,10 @@ namespace {
 
     void get_move_file(int pane_selected)
     {
+        auto& from = pane_selected == 0 ? ldata : rdata;
+        auto& to = pane_selected == 0 ? rdata : ldata;
+        if (get_batch_files(from, to.current_path, from.move_file, batch_kind::Move))
+            return;
         bool enable_view = false;
         if (pane_selected == 0) {
             get_selected_file(ldata, ldata.move, enable_view);
@@ -582,6 +979,9 @@ namespace {
 
     void get_delete_file(int pane_selected)
     {
+        auto& from = pane_selected == 0 ? ldata : rdata;
+        if (get_batch_files(from, fs::path(), from.delete_file, batch_kind::Delete))
+            return;
         bool enable_view = false;
         if (pane_selected == 0) {
             get_selected_file(ldata, ldata.delete_, enable_view);
@@ -659,6 +1059,38 @@ namespace {
         ImGui::OpenPopup("Delete File");
     }
 
+    void do_find_in_files(int pane_selected)
+    {
+        auto& data = pane_selected == 0 ? ldata : rdata;
+        data.find_file.old_file = data.current_path;
+        ImGui::OpenPopup("Find in Files");
+    }
+
+    void do_find_file(int pane_selected)
+    {
+        auto& data = pane_selected == 0 ? ldata : rdata;
+        data.find_name_file.old_file = data.current_path;
+        ImGui::OpenPopup("Find File");
+    }
+
+    //The selected directories, or every one listed when none is selected.
+    void do_calculate_sizes(int pane_selected)
+    {
+        auto& data = pane_selected == 0 ? ldata : rdata;
+        if (!data.table_data)
+            return;
+        const auto& rows = *data.table_data;
+        std::vector<std::string> selected, all;
+        for(const auto row : data.order) {
+            if (!rows.is_directory(row) || rows.is_imaginary(row))
+                continue;
+            all.emplace_back(rows.file_name(row));
+            if (data.selection.contains(rows.ids[row]))
+                selected.emplace_back(rows.file_name(row));
+        }
+        data.sizer.start(rows.directory, selected.empty() ? std::move(all) : std::move(selected), dir_size_cache);
+    }
+
     void draw_bottom_menu(int pane_selected)
     {
         float item_width = (ImGui::GetWindowWidth() / 9.0f) - 1.0f;
@@ -709,6 +1141,18 @@ namespace {
         if (ImGui::Button("F10 Quit", ImVec2(item_width, 0.0f))) {
             should_close = true;
         }
+        if (find_requested || (ImGui::GetIO().KeyAlt && ImGui::IsKeyPressed(ImGuiKey_F7, false))) {
+            find_requested = false;
+            do_find_in_files(pane_selected);
+        }
+        if (find_name_requested || (ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_P, false))) {
+            find_name_requested = false;
+            do_find_file(pane_selected);
+        }
+        if (sizes_requested || (ImGui::GetIO().KeyAlt && ImGui::GetIO().KeyShift && ImGui::IsKeyPressed(ImGuiKey_Enter, false))) {
+            sizes_requested = false;
+            do_calculate_sizes(pane_selected);
+        }
         ImGui::TextUnformatted(hover_text.c_str());
     }
 
@@ -718,18 +1162,18 @@ namespace {
     void draw_popups(int pane_selected)
     {
         view_file(pane_selected == 0 ? ldata.view.old_file : rdata.view.old_file);
-        int ret = ask_copy(pane_selected == 0 ? ldata.copy_file : rdata.copy_file);
+        int ret = ask_copy(pane_selected == 0 ? ldata.copy_file : rdata.copy_file, job_queue);
         if (ret == success) {
             if (pane_selected == 0)
                 rdata.dir_dirty = true;
             else
                 ldata.dir_dirty = true;
         }
-        ret = ask_move(pane_selected == 0 ? ldata.move_file : rdata.move_file);
+        ret = ask_move(pane_selected == 0 ? ldata.move_file : rdata.move_file, job_queue);
         if (ret == success) {
             rdata.dir_dirty = ldata.dir_dirty = true;
         }
-        ret = ask_delete(pane_selected == 0 ? ldata.delete_file : rdata.delete_file);
+        ret = ask_delete(pane_selected == 0 ? ldata.delete_file : rdata.delete_file, job_queue);
         if (ret == success) {
             if (ldata.current_path == rdata.current_path) {
                 ldata.dir_dirty = rdata.dir_dirty = true;
@@ -739,6 +1183,11 @@ namespace {
             else
                 rdata.dir_dirty = true;
         }
+        auto& finding = pane_selected == 0 ? ldata : rdata;
+        if (ask_find_in_files(finding.find_file, finding.find_match_case) == success)
+            start_find_in_files(finding);
+        if (ask_find_file(finding.find_name_file, name_indexes) == success)
+            start_find_file(finding);
         ret = ask_make_directory(pane_selected == 0 ? ldata.make_directory_file : rdata.make_directory_file);
         if (ret == success) {
             if (ldata.current_path == rdata.current_path) {
@@ -750,10 +1199,93 @@ namespace {
                 rdata.dir_dirty = true;
         }
     }
+
+    const char* job_state_name(int state)
+    {
+        switch(state) {
+            case job_state::Queued: return "Queued";
+            case job_state::Running: return "Running";
+            case job_state::Paused: return "Paused";
+            case job_state::Done: return "Done";
+            case job_state::Failed: return "Failed";
+            case job_state::Canceled: return "Canceled";
+            default: return "";
+        }
+    }
+
+    void draw_jobs_panel()
+    {
+        const auto jobs = job_queue.jobs();
+        //pops up whenever something new gets queued
+        if (jobs.size() > last_job_count)
+            show_jobs = true;
+        last_job_count = jobs.size();
+        if (!show_jobs)
+            return;
+
+        ImGui::SetNextWindowSize(ImVec2(700.0f, 200.0f), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Jobs", &show_jobs)) {
+            if (ImGui::Button("Clear finished")) {
+                job_queue.clear_finished();
+            }
+            if (ImGui::BeginTable("#jobs", 4, ImGuiTableFlags_ScrollY)) {
+                ImGui::TableSetupColumn("Job", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableSetupColumn("Progress", ImGuiTableColumnFlags_WidthFixed, 300.0f);
+                ImGui::TableSetupColumn("State", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+                ImGui::TableSetupColumn("##actions", ImGuiTableColumnFlags_WidthFixed, 110.0f);
+                ImGui::TableHeadersRow();
+                for(const auto& job : jobs) {
+                    const int state = job->state;
+                    ImGui::PushID(reinterpret_cast<const void*>(static_cast<uintptr_t>(job->id)));
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::TextUnformatted(job->description.c_str());
+                    if (state == job_state::Failed) {
+                        ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", job_error_message(*job).c_str());
+                        //the whole report of a batch, capped so the tooltip stays on screen
+                        if (job->failures.size() > 1 && ImGui::IsItemHovered()) {
+                            constexpr size_t max_listed = 20;
+                            std::string report;
+                            for(size_t i = 0; i < std::min(job->failures.size(), max_listed); i++)
+                                report += fmt::format("{}: {}\n", job->failures[i].first.generic_string(), job->failures[i].second.message());
+                            if (job->failures.size() > max_listed)
+                                report += fmt::format("... and {} more", job->failures.size() - max_listed);
+                            ImGui::SetTooltip("%s", report.c_str());
+                        }
+                    }
+                    ImGui::TableSetColumnIndex(1);
+                    if (state == job_state::Running || state == job_state::Paused)
+                        draw_job_progress(*job);
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::TextUnformatted(job_state_name(state));
+                    ImGui::TableSetColumnIndex(3);
+                    if (!job->finished()) {
+                        if (state == job_state::Paused) {
+                            if (ImGui::SmallButton("Resume"))
+                                job_queue.resume(job);
+                        } else if (ImGui::SmallButton("Pause")) {
+                            job_queue.pause(job);
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::SmallButton("Cancel"))
+                            job_queue.cancel(job);
+                    }
+                    ImGui::PopID();
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
 }
 
 bool imc::gui::draw_mainframe(int width, int height)
 {
+    if (!name_indexes_loaded) {
+        //only maps what is there, stale indexes are rebuilt in the background
+        name_indexes.load();
+        name_indexes_loaded = true;
+    }
     ImGui::SetNextWindowSize(ImVec2(width, height));
     ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
     if (ImGui::Begin("ImCommander", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_MenuBar | ImGuiWindowFlags_NoTitleBar)) {
@@ -774,6 +1306,32 @@ bool imc::gui::draw_mainframe(int width, int height)
                 if (ImGui::MenuItem("View File", "F3")) {
                     do_viewfile(pane_selected);
                 }
+                if (ImGui::MenuItem("Find in Files", "Alt+F7")) {
+                    find_requested = true;
+                }
+                if (ImGui::MenuItem("Find File by Name", "Ctrl+P")) {
+                    find_name_requested = true;
+                }
+                if (ImGui::MenuItem("Calculate Directory Sizes", "Alt+Shift+Enter")) {
+                    sizes_requested = true;
+                }
+                if (ImGui::MenuItem("Jobs")) {
+                    show_jobs = true;
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("View")) {
+                if (ImGui::BeginMenu("Date Format")) {
+                    for(const auto& [label, format] : date_formats) {
+                        if (ImGui::MenuItem(label, nullptr, modified_format() == format)) {
+                            set_modified_format(format);
+                            //the rows on screen were formatted the old way
+                            ldata.display_cache.clear();
+                            rdata.display_cache.clear();
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
                 ImGui::EndMenu();
             }
             ImGui::EndMenuBar();
@@ -816,6 +1374,7 @@ bool imc::gui::draw_mainframe(int width, int height)
         }
     }
     ImGui::End();
+    draw_jobs_panel();
 
     return should_close;
 }
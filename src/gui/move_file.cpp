@@ -3,8 +3,12 @@
 #include "imgui.h"
 
 #include "backend/file_operations.h"
+#include "backend/job_queue.h"
 #include "types/op_file.h"
 #include "types/errors.h"
+#include "job_progress.h"
+#include "batch_dialog.h"
+#include "backend/batch.h"
 
 #include <vector>
 #include <string>
@@ -13,15 +17,16 @@
 
 namespace {
     std::string last_error = "";
-    std::pair<std::error_code, std::error_code> last_ec;
     bool can_override = false;
+    //the move runs in the job queue, the popup shows it until it is done or sent to the background
+    imc::backend::JobPtr job;
 }
 
 namespace fs = std::filesystem;
 
 using namespace imc::errors;
 
-int imc::gui::ask_move(types::op_file_t& move_file)
+int imc::gui::ask_move(types::op_file_t& move_file, backend::job_queue_t& jobs)
 {
     int ret = didnt_do_nothin;
     if (std::strlen(move_file.file.data()) == 0)
@@ -30,33 +35,62 @@ int imc::gui::ask_move(types::op_file_t& move_file)
     ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
     ImGui::SetNextWindowSize(ImVec2(4.0 * 150.0f, 0.0f));
     if (ImGui::BeginPopupModal("Move File", nullptr, ImGuiWindowFlags_NoResize)) {
-        ImGui::Text("Move %s to:", move_file.old_file.filename().generic_string().c_str());
+        if (job) {
+            if (move_file.old_files.empty())
+                ImGui::Text("Moving %s to %s", move_file.old_file.filename().generic_string().c_str(), move_file.file.data());
+            else
+                ImGui::Text("Moving %zu items to %s", move_file.old_files.size(), move_file.file.data());
+            draw_job_progress(*job);
+            if (job->finished()) {
+                std::error_code ec = job->ec;
+                const auto message = job_error_message(*job);
+                job.reset();
+                if (ec) {
+                    last_error = message;
+                    ret = failed_to_copy;
+                } else {
+                    ret = success;
+                    last_error.clear();
+                    ImGui::CloseCurrentPopup();
+                }
+            } else {
+                if (ImGui::Button("Background")) {
+                    //it carries on in the jobs panel
+                    job.reset();
+                    ret = success;
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::SameLine();
+                if (job && ImGui::Button("Cancel")) {
+                    jobs.cancel(job);
+                }
+            }
+            ImGui::EndPopup();
+            return ret;
+        }
+        const bool batch = !move_file.old_files.empty();
+        if (batch)
+            ImGui::Text("Move %zu items to:", move_file.old_files.size());
+        else
+            ImGui::Text("Move %s to:", move_file.old_file.filename().generic_string().c_str());
         ImGui::SetNextItemWidth(-1.0f);
         bool do_ok = false;
         if (ImGui::InputText("##movefile",  move_file.file.data(), move_file.file.size(), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue)) {
             do_ok = true;
         }
-        ImGui::Checkbox("Can overwrite?", &can_override);
+        if (!batch)
+            ImGui::Checkbox("Can overwrite?", &can_override);
         ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", last_error.c_str());
-        if (ImGui::Button("OK") || do_ok) {
-            std::pair<std::error_code, std::error_code> ec = backend::move(move_file.old_file, fs::path(move_file.file.data()), can_override);
-            last_ec = ec;
-            if (ec.first) {
-                //hey there was an error
-                last_error = ec.first.message();
-                ret = failed_to_copy;
-            } else if (ec.second) {
-                last_error = ec.second.message();
-                ret = failed_to_remove;
-            } else {
-                ret = success;
+        if (batch) {
+            if (draw_batch_dialog(backend::batch_kind::Move, move_file, jobs, job) == success)
                 last_error.clear();
-                ImGui::CloseCurrentPopup();
-            }
+        } else if (ImGui::Button("OK") || do_ok) {
+            job = jobs.push(backend::make_move_job(move_file.old_file, fs::path(move_file.file.data()), can_override));
         }
         ImGui::SameLine();
         if (ImGui::Button("Cancel")) {
             last_error.clear();
+            reset_batch_dialog(backend::batch_kind::Move);
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
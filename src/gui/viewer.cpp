@@ -2,15 +2,398 @@
 
 #include "imgui.h"
 
+#include "backend/hex_dump.h"
+#include "backend/line_index.h"
+#include "backend/mapped_file.h"
+#include "backend/text_search.h"
+#include "backend/watch_file.h"
+
 #include <fmt/format.h>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace {
-    constexpr size_t MAX_VIEW_FILESIZE = 10ULL * 1024ULL * 1024ULL;
+    //ImGui measures every character it is given, a line of a few GB would stall the frame
+    constexpr size_t MAX_LINE_DISPLAY = 4096;
     std::filesystem::path last_file;
-    std::filesystem::file_time_type old_file_time;
-    std::string file_data;
+    imc::backend::mapped_file_t mapped;
+    //declared after the mapping so it goes first, it reads from it
+    std::unique_ptr<imc::backend::line_index_t> line_index;
+    std::unique_ptr<imc::backend::match_index_t> matches;
+    //the mapping is read front to back until the index is done
+    bool sequential = false;
+    //a read of the mapping hit a page a truncation took away
+    bool read_failed = false;
+    //the lines on screen, copied out of the mapping under a guard before ImGui sees them
+    struct visible_line_t
+    {
+        size_t      line;
+        uint64_t    offset;
+        size_t      begin;
+        size_t      size;
+    };
+    std::string visible_text;
+    std::vector<visible_line_t> visible_lines;
+    std::string error;
+    //tells us when the file changes instead of a stat every frame
+    imc::backend::file_watcher_t watcher;
+    //keep the end of the file in view as it grows, like tail -f
+    bool follow = false;
+
+    //a NUL this early means it isn't text
+    constexpr size_t BINARY_SNIFF_SIZE = 8192;
+    bool hex_mode = false;
+    //rows are tracked by number, not scroll position: a float can't address every row of a few GB
+    uint64_t hex_top_row = 0;
+    uint64_t hex_visible_rows = 1;
+    //the byte jumped to, its row stands out
+    uint64_t hex_mark = UINT64_MAX;
+    //the text view goes by line number the same way
+    uint64_t text_top_line = 0;
+    uint64_t text_visible_lines = 1;
+    std::array<char, 32> goto_offset{};
+    bool goto_failed = false;
+
+    constexpr size_t NO_MATCH = std::string_view::npos;
+    std::array<char, 256> find_text{};
+    bool match_case = false;
+    //what the running search looks for, the box may have changed since
+    std::string needle;
+    bool needle_match_case = false;
+    size_t current_match = NO_MATCH;
+    //line and byte of the current match, the line is only known once the index got there
+    size_t match_line = NO_MATCH;
+    uint64_t match_offset = 0;
+    bool scroll_to_match = false;
+
+    void unload()
+    {
+        watcher.stop();
+        matches.reset();
+        line_index.reset();
+        mapped.close();
+        last_file.clear();
+        error.clear();
+        read_failed = false;
+    }
+
+    void load(const std::filesystem::path& file)
+    {
+        unload();
+        last_file = file;
+        if (auto ec = mapped.open(file)) {
+            error = fmt::format("Can't open '{}': {}\n", file.generic_string(), ec.message());
+            return;
+        }
+        mapped.advise_sequential(true);
+        sequential = true;
+        line_index = std::make_unique<imc::backend::line_index_t>(mapped.data());
+        watcher.start(file, mapped.size());
+    }
+
+    void search()
+    {
+        matches.reset();
+        current_match = NO_MATCH;
+        match_line = NO_MATCH;
+        scroll_to_match = false;
+        if (!needle.empty() && line_index)
+            matches = std::make_unique<imc::backend::match_index_t>(mapped.data(), needle, !needle_match_case);
+    }
+
+    //once this returns nothing but the ui thread reads the mapping
+    void stop_workers()
+    {
+        if (matches)
+            matches->stop();
+        if (line_index)
+            line_index->stop();
+    }
+
+    //only new bytes get mapped, indexed and searched, a shorter or different file starts over
+    void apply_changes(const std::filesystem::path& file)
+    {
+        using namespace imc::backend;
+        uint64_t size = 0;
+        auto change = watcher.changes(size);
+        //a read that ran into the truncation knows before the watcher does
+        if (read_failed || (line_index && line_index->truncated()) || (matches && matches->truncated()))
+            change = file_change::Truncated;
+        switch(change) {
+            case file_change::Grew:
+                if (line_index) {
+                    //the mapping may move, nothing may be reading it then
+                    stop_workers();
+                    if (!mapped.grow(size)) {
+                        line_index->extend(mapped.data());
+                        if (matches)
+                            matches->extend(mapped.data());
+                        break;
+                    }
+                }
+                load(file);
+                search();
+                break;
+            case file_change::Truncated:
+            case file_change::Replaced:
+                //the workers go first, up to here they read under a guard, then
+                //the file is mapped again before anything draws from it
+                stop_workers();
+                load(file);
+                search();
+                break;
+            default:
+                break;
+        }
+    }
+
+    void reset_view()
+    {
+        const auto head = mapped.data().substr(0, BINARY_SNIFF_SIZE);
+        hex_mode = false;
+        read_failed |= !imc::backend::guarded_read([&head]() {
+            hex_mode = memchr(head.data(), '\0', head.size()) != nullptr;
+        });
+        hex_top_row = 0;
+        hex_mark = UINT64_MAX;
+        text_top_line = 0;
+        goto_failed = false;
+        needle.clear();
+        search();
+    }
+
+    //the wheel and the keys move top by rows (lines in the text view), never past max_top
+    void scroll_rows(uint64_t& top, uint64_t visible, uint64_t max_top)
+    {
+        int64_t delta = 0;
+        if (ImGui::IsWindowHovered())
+            delta -= static_cast<int64_t>(ImGui::GetIO().MouseWheel * 3.0f);
+        if (ImGui::IsWindowFocused()) {
+            const auto page = static_cast<int64_t>(visible);
+            if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) delta -= 1;
+            if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) delta += 1;
+            if (ImGui::IsKeyPressed(ImGuiKey_PageUp)) delta -= page;
+            if (ImGui::IsKeyPressed(ImGuiKey_PageDown)) delta += page;
+            if (ImGui::IsKeyPressed(ImGuiKey_Home)) top = 0;
+            if (ImGui::IsKeyPressed(ImGuiKey_End)) top = max_top;
+        }
+        if (delta < 0)
+            top -= std::min(top, static_cast<uint64_t>(-delta));
+        else
+            top += static_cast<uint64_t>(delta);
+        if (follow || top > max_top)
+            top = max_top;
+    }
+
+    //top of the file at the top, the slider's max is its top end. x is where it goes on the line
+    void draw_row_scrollbar(const char* id, float x, float height, uint64_t& top, uint64_t max_top)
+    {
+        const float width = ImGui::GetTextLineHeight();
+        ImGui::SameLine(std::max(0.0f, x - width));
+        uint64_t position = max_top - std::min(top, max_top);
+        const uint64_t zero = 0;
+        if (ImGui::VSliderScalar(id, ImVec2(width, height), ImGuiDataType_U64, &position, &zero, &max_top, ""))
+            top = max_top - std::min(position, max_top);
+    }
+
+    //only the rows on screen get formatted, whatever the size of the file
+    void draw_hex()
+    {
+        using namespace imc::backend;
+        const auto data = mapped.data();
+        const uint64_t rows = (data.size() + hex_bytes_per_row - 1) / hex_bytes_per_row;
+        const ImVec2 avail = ImGui::GetContentRegionAvail();
+        hex_visible_rows = std::max<uint64_t>(1, static_cast<uint64_t>(avail.y / ImGui::GetTextLineHeightWithSpacing()));
+        const uint64_t max_top = rows > hex_visible_rows ? rows - hex_visible_rows : 0;
+        scroll_rows(hex_top_row, hex_visible_rows, max_top);
+
+        const int digits = hex_offset_digits(data.size());
+        std::array<char, hex_row_capacity> row;
+        ImGui::BeginGroup();
+        for(uint64_t r = hex_top_row; r < std::min(rows, hex_top_row + hex_visible_rows); r++) {
+            const uint64_t offset = r * hex_bytes_per_row;
+            size_t len = 0;
+            if (!guarded_read([&]() { len = format_hex_row(data.substr(static_cast<size_t>(offset), hex_bytes_per_row), offset, digits, row.data()); })) {
+                read_failed = true;
+                break;
+            }
+            if (hex_mark / hex_bytes_per_row == r)
+                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.8f, 0.2f, 1.0f));
+            ImGui::TextUnformatted(row.data(), row.data() + len);
+            if (hex_mark / hex_bytes_per_row == r)
+                ImGui::PopStyleColor();
+        }
+        ImGui::EndGroup();
+        draw_row_scrollbar("##HexScroll", avail.x, avail.y, hex_top_row, max_top);
+    }
+
+    void draw_goto()
+    {
+        using namespace imc::backend;
+        ImGui::SetNextItemWidth(ImGui::GetTextLineHeight() * 10.0f);
+        bool go = ImGui::InputText("##GotoOffset", goto_offset.data(), goto_offset.size(), ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SameLine();
+        go |= ImGui::Button("Go to offset");
+        if (go) {
+            uint64_t offset = 0;
+            goto_failed = !parse_offset(goto_offset.data(), offset) || offset >= mapped.size();
+            if (!goto_failed) {
+                //a few rows of what comes before it stay in view
+                const uint64_t row = offset / hex_bytes_per_row;
+                hex_top_row = row - std::min(row, hex_visible_rows / 4);
+                hex_mark = offset;
+                follow = false;
+            }
+        }
+        if (goto_failed) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "not in the file");
+        }
+    }
+
+    void show_match(size_t n)
+    {
+        current_match = n;
+        match_offset = matches->offset(n);
+        match_line = NO_MATCH;
+        scroll_to_match = true;
+        follow = false;
+        //a few rows of what comes before it stay in view
+        const uint64_t row = match_offset / imc::backend::hex_bytes_per_row;
+        hex_top_row = row - std::min(row, hex_visible_rows / 4);
+        hex_mark = match_offset;
+    }
+
+    //the next match after the current one, or the one before it, wrapping around once all are known
+    void step_match(bool forward)
+    {
+        if (!matches || matches->stored() == 0)
+            return;
+        const size_t stored = matches->stored();
+        if (current_match == NO_MATCH)
+            show_match(0);
+        else if (forward && current_match + 1 < stored)
+            show_match(current_match + 1);
+        else if (!forward && current_match > 0)
+            show_match(current_match - 1);
+        else if (matches->done())
+            show_match(forward ? 0 : stored - 1);
+    }
+
+    void draw_find()
+    {
+        ImGui::SetNextItemWidth(ImGui::GetTextLineHeight() * 16.0f);
+        ImGui::SetNextItemShortcut(ImGuiMod_Ctrl | ImGuiKey_F);
+        bool find = ImGui::InputText("##Find", find_text.data(), find_text.size(), ImGuiInputTextFlags_EnterReturnsTrue);
+        ImGui::SameLine();
+        ImGui::Checkbox("Match case", &match_case);
+        ImGui::SameLine();
+        ImGui::SetNextItemShortcut(ImGuiKey_F3);
+        find |= ImGui::Button("Find next");
+        ImGui::SameLine();
+        ImGui::SetNextItemShortcut(ImGuiMod_Shift | ImGuiKey_F3);
+        const bool previous = ImGui::Button("Find previous");
+        if (find || previous) {
+            //a new search shows its first match as soon as there is one
+            if (needle != find_text.data() || needle_match_case != match_case) {
+                needle = find_text.data();
+                needle_match_case = match_case;
+                search();
+            } else
+                step_match(!previous);
+        }
+        if (matches && current_match == NO_MATCH && matches->stored() > 0)
+            show_match(0);
+        if (matches) {
+            ImGui::SameLine();
+            if (current_match != NO_MATCH)
+                ImGui::TextDisabled("%zu of %zu%s", current_match + 1, matches->count(), matches->done() ? "" : "...");
+            else
+                ImGui::TextDisabled(matches->done() ? "not found" : "searching...");
+        }
+    }
+
+    //the current match in a line of text stands out, the rest as usual. begin is
+    //where text was in the file, text itself is a copy
+    void draw_line(size_t line, uint64_t begin, std::string_view text)
+    {
+        if (line != match_line || match_offset < begin || match_offset >= begin + text.size()) {
+            ImGui::TextUnformatted(text.data(), text.data() + text.size());
+            return;
+        }
+        const auto column = static_cast<size_t>(match_offset - begin);
+        const auto hit = text.substr(column, matches ? matches->needle_size() : 0);
+        ImGui::TextUnformatted(text.data(), hit.data());
+        ImGui::SameLine(0.0f, 0.0f);
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.8f, 0.2f, 1.0f));
+        ImGui::TextUnformatted(hit.data(), hit.data() + hit.size());
+        ImGui::PopStyleColor();
+        ImGui::SameLine(0.0f, 0.0f);
+        ImGui::TextUnformatted(hit.data() + hit.size(), text.data() + text.size());
+    }
+
+    void draw_lines()
+    {
+        if (!error.empty()) {
+            ImGui::TextUnformatted(error.c_str());
+            return;
+        }
+        if (!line_index)
+            return;
+        if (hex_mode) {
+            draw_hex();
+            return;
+        }
+        if (current_match != NO_MATCH && match_line == NO_MATCH)
+            read_failed |= !imc::backend::guarded_read([]() { match_line = line_index->line_of(match_offset); });
+        //made once, not under the guard: nothing with a destructor may be made there
+        const imc::backend::line_index_t::FNLine copy_line = [](size_t line, std::string_view text) {
+            text = text.substr(0, MAX_LINE_DISPLAY);
+            //room was reserved, this never allocates
+            visible_lines.push_back({ line, static_cast<uint64_t>(text.data() - mapped.data().data()), visible_text.size(), text.size() });
+            visible_text.append(text);
+            return true;
+        };
+        //Only the lines on screen get drawn, frame time doesn't depend on the file size. They are
+        //tracked by number like hex rows: a float scroll offset can't reach every line of a few GB.
+        const uint64_t lines = line_index->lines();
+        const ImVec2 avail = ImGui::GetContentRegionAvail();
+        text_visible_lines = std::max<uint64_t>(1, static_cast<uint64_t>(avail.y / ImGui::GetTextLineHeightWithSpacing()));
+        const uint64_t max_top = lines > text_visible_lines ? lines - text_visible_lines : 0;
+        if (scroll_to_match && match_line != NO_MATCH) {
+            //a few lines of what comes before it stay in view
+            text_top_line = std::min<uint64_t>(match_line - std::min<uint64_t>(match_line, text_visible_lines / 4), max_top);
+            scroll_to_match = false;
+        }
+        scroll_rows(text_top_line, text_visible_lines, max_top);
+
+        const size_t first = text_top_line;
+        const size_t last = std::min(lines, text_top_line + text_visible_lines);
+        visible_lines.clear();
+        visible_lines.reserve(last - first);
+        visible_text.clear();
+        visible_text.reserve((last - first) * MAX_LINE_DISPLAY);
+        //a line cut short by a truncation is dropped, the file is reloaded anyway
+        if (!imc::backend::guarded_read([first, last, &copy_line]() { line_index->visit(first, last, copy_line); })) {
+            read_failed = true;
+            if (!visible_lines.empty())
+                visible_lines.pop_back();
+        }
+        //a scroll to the side moves the lines, the scrollbar stays at the right edge
+        const float right = ImGui::GetScrollX() + avail.x;
+        ImGui::BeginGroup();
+        for(const auto& visible : visible_lines)
+            draw_line(visible.line, visible.offset, std::string_view(visible_text).substr(visible.begin, visible.size));
+        ImGui::EndGroup();
+        draw_row_scrollbar("##TextScroll", right, avail.y, text_top_line, max_top);
+    }
 }
 
 int imc::gui::view_file(const fs::path& file)
@@ -18,25 +401,39 @@ int imc::gui::view_file(const fs::path& file)
     ImVec2 center = ImGui::GetMainViewport()->GetCenter();
     ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
     if (ImGui::BeginPopupModal("View File", nullptr, ImGuiWindowFlags_None)) {
-        if (last_file != file || fs::last_write_time(file) > old_file_time) {
-            auto sz = fs::file_size(file);
-            if (sz > MAX_VIEW_FILESIZE) {
-                file_data = fmt::format("File '{}' is too large ({})\n", file.generic_string(), sz);
-            } else {
-                //re-read file
-                std::fstream f(file);
-                file_data.resize(sz);
-                f.read(file_data.data(), sz);
-            }
+        if (last_file != file) {
+            load(file);
+            reset_view();
+        } else
+            apply_changes(file);
+        if (sequential && line_index && line_index->done()) {
+            mapped.advise_sequential(false);
+            sequential = false;
         }
         float height = ImGui::GetWindowHeight();
-        if (ImGui::BeginChild("ViewFileData", ImVec2(0.0f, height - 62.0f), 0, ImGuiWindowFlags_HorizontalScrollbar))
+        if (ImGui::BeginChild("ViewFileData", ImVec2(0.0f, height - 88.0f), 0, ImGuiWindowFlags_HorizontalScrollbar))
         {
-            ImGui::TextUnformatted(file_data.c_str());
+            draw_lines();
         }
         ImGui::EndChild();
         ImGui::Separator();
-        if (ImGui::Button("Close", ImVec2(120, 0))) { ImGui::CloseCurrentPopup(); }
+        if (ImGui::Button("Close", ImVec2(120, 0))) {
+            unload();
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Follow", &follow);
+        ImGui::SameLine();
+        ImGui::Checkbox("Hex", &hex_mode);
+        if (hex_mode) {
+            ImGui::SameLine();
+            draw_goto();
+        }
+        if (line_index) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("%zu lines%s", line_index->lines(), line_index->done() ? "" : "...");
+        }
+        draw_find();
         ImGui::EndPopup();
     }
 
@@ -12,5 +12,7 @@ namespace imc::types
         op_file_t();
         std::vector<char> file;
         fs::path old_file;
+        //every selected path when there is more than one, file is then the destination directory
+        std::vector<fs::path> old_files;
     };
 }
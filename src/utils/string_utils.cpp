@@ -92,6 +92,11 @@ int imc::string_utils::icompare(const std::string& lhs, const std::string& rhs)
     return traits_cast<ci_char_traits>(lhs).compare(traits_cast<ci_char_traits>(rhs));
 }
 
+int imc::string_utils::icompare(std::string_view lhs, std::string_view rhs)
+{
+    return traits_cast<ci_char_traits>(lhs).compare(traits_cast<ci_char_traits>(rhs));
+}
+
 std::string imc::string_utils::size_to_display(size_t sz)
 {
     return fmt::format("{:>10}", size_to_string(sz));
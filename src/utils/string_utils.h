@@ -1,9 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 namespace imc::string_utils {
     int icompare(const std::string& lhs, const std::string& rhs);
+    int icompare(std::string_view lhs, std::string_view rhs);
     std::string size_to_display(size_t sz);
     std::string size_to_display_no_padding(size_t sz);
 }
@@ -0,0 +1,151 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "backend/batch.h"
+#include "tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+namespace {
+
+struct selection_t
+{
+    fs::path                    src;
+    fs::path                    dst;
+    std::vector<batch_item_t>   items;
+    uint64_t                    bytes{0U};
+    std::vector<size_t>         conflicts;
+    std::vector<size_t>         missing;
+    size_t                      directories{0U};
+    size_t                      files{0U};
+};
+
+//every 10th item a directory, every 7th already in dst, every 50th gone before the scan
+selection_t make_selection(const char* name, size_t count)
+{
+    selection_t selection;
+    selection.src = fs::temp_directory_path() / (std::string(name) + "_src");
+    selection.dst = fs::temp_directory_path() / (std::string(name) + "_dst");
+    remove_tree(selection.src);
+    remove_tree(selection.dst);
+    fs::create_directories(selection.src);
+    fs::create_directories(selection.dst);
+
+    std::vector<fs::path> sources;
+    for(size_t i = 0; i < count; i++) {
+        const auto path = selection.src / ("item" + std::to_string(i));
+        sources.push_back(path);
+        if (i % 50 == 49) {
+            selection.missing.push_back(i);
+            continue;
+        }
+        if (i % 10 == 0) {
+            fs::create_directory(path);
+            generated_tree_t::write_file(path / "inside.txt", "inside\n");
+            selection.directories++;
+            selection.files++;
+            selection.bytes += 7;
+        } else {
+            const std::string content(i % 100, 'x');
+            generated_tree_t::write_file(path, content);
+            selection.files++;
+            selection.bytes += content.size();
+        }
+        if (i % 7 == 0) {
+            generated_tree_t::write_file(selection.dst / path.filename(), "there\n");
+            selection.conflicts.push_back(i);
+        }
+    }
+    selection.items = batch_items(sources, selection.dst);
+    return selection;
+}
+
+}
+
+TEST_CASE("preflight counts, sizes and finds conflicts over several threads", "[batch]")
+{
+    //enough items for more than one thread
+    auto selection = make_selection("imc_preflight", 1000);
+    const auto result = preflight(selection.items);
+
+    CHECK(result.total_bytes == selection.bytes);
+    CHECK(result.directories == selection.directories);
+    CHECK(result.files == selection.files);
+    CHECK(result.inner_conflicts == 0);
+    CHECK(result.unreadable == 0);
+    CHECK(result.conflicts == selection.conflicts);
+    std::vector<size_t> errors;
+    for(const auto& [index, ec] : result.errors) {
+        errors.push_back(index);
+        CHECK(ec == std::errc::no_such_file_or_directory);
+    }
+    CHECK(errors == selection.missing);
+    REQUIRE(result.sizes.size() == selection.items.size());
+    CHECK(result.sizes[1] == 1);
+    CHECK(result.own_sizes[1] == 1);
+    //a directory's size is what is under it
+    CHECK(result.sizes[10] == 7);
+    CHECK(result.own_sizes[10] == 0);
+    remove_tree(selection.src);
+    remove_tree(selection.dst);
+}
+
+TEST_CASE("preflight walks selected directories and what they merge into", "[batch]")
+{
+    const auto src = fs::temp_directory_path() / "imc_preflight_tree_src";
+    const auto dst = fs::temp_directory_path() / "imc_preflight_tree_dst";
+    remove_tree(src);
+    remove_tree(dst);
+    fs::create_directories(src / "tree" / "sub" / "deeper");
+    generated_tree_t::write_file(src / "tree" / "a.txt", "aaaa");
+    generated_tree_t::write_file(src / "tree" / "sub" / "b.txt", "bb");
+    generated_tree_t::write_file(src / "tree" / "sub" / "deeper" / "c.txt", "c");
+    //neither followed nor counted as a directory
+    fs::create_directory_symlink(src / "tree" / "sub", src / "tree" / "link");
+    generated_tree_t::write_file(src / "file.txt", "12345");
+    //tree goes onto an existing tree: a.txt and sub/deeper/c.txt are in the way
+    fs::create_directories(dst / "tree" / "sub" / "deeper");
+    generated_tree_t::write_file(dst / "tree" / "a.txt", "old");
+    generated_tree_t::write_file(dst / "tree" / "sub" / "deeper" / "c.txt", "old");
+    generated_tree_t::write_file(dst / "tree" / "other.txt", "old");
+
+    const auto result = preflight(batch_items({ src / "tree", src / "file.txt" }, dst));
+    CHECK(result.errors.empty());
+    CHECK(result.directories == 3);
+    CHECK(result.files == 5);
+    CHECK(result.total_bytes == 12);
+    CHECK(result.sizes == std::vector<uint64_t>{ 7, 5 });
+    CHECK(result.own_sizes == std::vector<uint64_t>{ 0, 5 });
+    CHECK(result.conflicts == std::vector<size_t>{ 0 });
+    CHECK(result.inner_conflicts == 2);
+    remove_tree(src);
+    remove_tree(dst);
+}
+
+TEST_CASE("a batch job copies what it can and collects what failed", "[batch]")
+{
+    auto selection = make_selection("imc_batch_job", 120);
+    const auto scan = preflight(selection.items);
+    //like the dialog: copy_tree adds what is under the directories as it finds it
+    uint64_t own_bytes = 0;
+    for(const auto size : scan.own_sizes)
+        own_bytes += size;
+    auto job = make_batch_job(batch_kind::Copy, selection.items, false, own_bytes);
+    CHECK(job->progress.files_total == selection.items.size());
+
+    CHECK(job->run(*job));
+    //the files inside the directories were counted as they were found
+    CHECK(job->progress.files_done == job->progress.files_total);
+    //every conflict and every missing source failed, nothing else
+    CHECK(job->failures.size() == selection.conflicts.size() + selection.missing.size());
+    CHECK(read_file(selection.dst / "item1") == "x");
+    CHECK(read_file(selection.dst / "item7") == "there\n");
+    CHECK(read_file(selection.dst / "item20" / "inside.txt") == "inside\n");
+    remove_tree(selection.src);
+    remove_tree(selection.dst);
+}
@@ -0,0 +1,36 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+#include "backend/copy_tree.h"
+#include "../tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+#ifdef _IMC_NIX
+TEST_CASE("copying a tree of 100k small files", "[.][bench]")
+{
+    generated_tree_t tree(fs::temp_directory_path() / "imc_bench_tree_src", 100'000);
+    const auto dst = fs::temp_directory_path() / "imc_bench_tree_dst";
+
+    //one thread is the old, sequential copy
+    for(const size_t threads : { size_t{1}, size_t{0} }) {
+        remove_tree(dst);
+        copy_progress_t progress;
+        failures_t failures;
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(!copy_tree(tree.root, dst, false, progress, {}, failures, threads));
+        const auto took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("copy_tree, %s: %zu files in %.2f s\n", threads == 1 ? "1 thread" : "default threads",
+               progress.files_done.load(), took);
+
+        CHECK(failures.size() == (tree.has_loop ? 1U : 0U));
+        CHECK(compare_trees(tree.root, dst) > tree.files);
+    }
+    remove_tree(dst);
+}
+#endif
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "backend/row_display.h"
+#include "backend/watch_dir.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+
+namespace {
+
+constexpr size_t entries = 100'000;
+//about what fits in a pane
+constexpr size_t screen_rows = 60;
+
+//made once for all the benchmarks, gone when they are done
+struct big_directory_t
+{
+    fs::path path = fs::temp_directory_path() / "imc_bench_100k";
+
+    big_directory_t()
+    {
+        fs::remove_all(path);
+        fs::create_directories(path);
+        for(size_t i = 0; i < entries; i++) {
+            if (FILE* file = fopen((path / ("file_" + std::to_string(i) + ".txt")).string().c_str(), "wb"))
+                fclose(file);
+        }
+    }
+    ~big_directory_t()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+};
+
+const fs::path& big_directory()
+{
+    static big_directory_t directory;
+    return directory.path;
+}
+
+}
+
+TEST_CASE("listing a directory of 100k entries", "[.][bench]")
+{
+    const auto& dir = big_directory();
+    const auto listing = read_listing(dir);
+    REQUIRE(listing);
+    REQUIRE(listing->live_size() >= entries);
+
+    BENCHMARK("read_listing")
+    {
+        return read_listing(dir);
+    };
+
+    //what every listing paid before the display text was made on draw
+    BENCHMARK("format every row up front (before)")
+    {
+        size_t bytes = 0;
+        for(size_t i = 0; i < listing->size(); i++) {
+            bytes += format_size(listing->sizes[i], listing->is_directory(i)).size();
+            bytes += format_modified(listing->modified[i]).size();
+            bytes += format_permissions(listing->permissions[i]).size();
+        }
+        return bytes;
+    };
+
+    //a new listing's first frame, nothing cached yet
+    BENCHMARK("format one screen on draw (after)")
+    {
+        row_display_cache_t cache;
+        size_t bytes = 0;
+        for(size_t i = 0; i < screen_rows; i++) {
+            bytes += cache.get_column(*listing, i, sortable_columns::Size).size();
+            bytes += cache.get_column(*listing, i, sortable_columns::Modified).size();
+            bytes += cache.get_column(*listing, i, sortable_columns::Permissions).size();
+        }
+        return bytes;
+    };
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef _IMC_MAC
+#include <date/tz.h>
+#endif
+
+#include "backend/timestamp_format.h"
+
+using namespace imc::backend;
+
+namespace {
+
+//mtimes of a typical directory: mostly the last few years, a few on the same day
+std::vector<file_time> modified_times(size_t count)
+{
+    std::mt19937_64 random(42);
+    const auto now = std::chrono::file_clock::now();
+    std::uniform_int_distribution<int64_t> seconds_back(0, 3 * 365 * 24 * 3600);
+    std::vector<file_time> times;
+    times.reserve(count);
+    for(size_t i = 0; i < count; i++)
+        times.push_back(now - std::chrono::seconds(seconds_back(random)));
+    return times;
+}
+
+#ifndef _IMC_MAC
+//what format_modified did per row before timestamp_formatter_t
+std::string format_with_date(file_time time, const char* format)
+{
+    const auto utc = std::chrono::floor<std::chrono::seconds>(std::chrono::file_clock::to_sys(time));
+    return date::format(format, date::make_zoned(date::current_zone(), utc));
+}
+#endif
+
+}
+
+TEST_CASE("formatting modified times", "[.][bench]")
+{
+    const auto times = modified_times(10'000);
+    const auto format = std::string(timestamp_formatter_t::default_format);
+
+#ifndef _IMC_MAC
+    BENCHMARK("date::current_zone + date::format, 10k times (before)")
+    {
+        size_t bytes = 0;
+        for(const auto time : times)
+            bytes += format_with_date(time, format.c_str()).size();
+        return bytes;
+    };
+#endif
+
+    BENCHMARK("timestamp_formatter_t, 10k times (after)")
+    {
+        timestamp_formatter_t formatter(format);
+        size_t bytes = 0;
+        for(const auto time : times)
+            bytes += formatter(time).size();
+        return bytes;
+    };
+
+    //a format it leaves to date::format, the floor of what it costs
+    BENCHMARK("timestamp_formatter_t, 10k times, slow format")
+    {
+        timestamp_formatter_t formatter("%a %b %d %Y %H:%M");
+        size_t bytes = 0;
+        for(const auto time : times)
+            bytes += formatter(time).size();
+        return bytes;
+    };
+}
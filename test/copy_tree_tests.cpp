@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "backend/copy_tree.h"
+#include "tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+#ifdef _IMC_NIX
+TEST_CASE("copy_tree copies every kind of entry and stops at a bind loop", "[copy_tree]")
+{
+    generated_tree_t tree(fs::temp_directory_path() / "imc_copy_tree_src", 2500);
+    const auto dst = fs::temp_directory_path() / "imc_copy_tree_dst";
+    remove_tree(dst);
+
+    copy_progress_t progress;
+    failures_t failures;
+    REQUIRE(!copy_tree(tree.root, dst, false, progress, {}, failures));
+
+    //files + 3 links + kept.txt + the fifo
+    CHECK(progress.files_total == tree.files + 5);
+    CHECK(progress.files_done == progress.files_total);
+    CHECK(compare_trees(tree.root, dst) > tree.files);
+    if (tree.has_loop) {
+        REQUIRE(failures.size() == 1);
+        CHECK(failures.front().first == tree.root / "loop");
+        CHECK(!fs::exists(dst / "loop"));
+    } else {
+        CHECK(failures.empty());
+    }
+    remove_tree(dst);
+}
+
+TEST_CASE("copy_tree into an existing directory merges only when it may override", "[copy_tree]")
+{
+    const auto src = fs::temp_directory_path() / "imc_copy_merge_src";
+    const auto dst = fs::temp_directory_path() / "imc_copy_merge_dst";
+    remove_tree(src);
+    remove_tree(dst);
+    fs::create_directories(src / "sub");
+    generated_tree_t::write_file(src / "sub" / "new.txt", "new\n");
+    fs::create_directories(dst / "sub");
+    generated_tree_t::write_file(dst / "sub" / "old.txt", "old\n");
+
+    copy_progress_t progress;
+    failures_t failures;
+    CHECK(copy_tree(src, dst, false, progress, {}, failures) == std::errc::file_exists);
+    CHECK(!fs::exists(dst / "sub" / "new.txt"));
+
+    REQUIRE(!copy_tree(src, dst, true, progress, {}, failures));
+    CHECK(failures.empty());
+    CHECK(read_file(dst / "sub" / "new.txt") == "new\n");
+    CHECK(read_file(dst / "sub" / "old.txt") == "old\n");
+    remove_tree(src);
+    remove_tree(dst);
+}
+
+TEST_CASE("a top level symlink is copied and moved as a link", "[copy_tree]")
+{
+    const auto dir = fs::temp_directory_path() / "imc_copy_symlink";
+    remove_tree(dir);
+    fs::create_directories(dir / "target_dir");
+    generated_tree_t::write_file(dir / "target.txt", "target\n");
+    fs::create_symlink("target.txt", dir / "to_file");
+    fs::create_symlink("target_dir", dir / "to_dir");
+
+    REQUIRE(!imc::backend::copy(dir / "to_file", dir / "to_file_copy"));
+    REQUIRE(!imc::backend::copy(dir / "to_dir", dir / "to_dir_copy"));
+    CHECK(fs::is_symlink(fs::symlink_status(dir / "to_file_copy")));
+    CHECK(fs::read_symlink(dir / "to_file_copy") == "target.txt");
+    CHECK(fs::is_symlink(fs::symlink_status(dir / "to_dir_copy")));
+    CHECK(fs::read_symlink(dir / "to_dir_copy") == "target_dir");
+
+    const auto [moved, removed] = imc::backend::move(dir / "to_file", dir / "to_file_moved");
+    REQUIRE(!moved);
+    REQUIRE(!removed);
+    CHECK(fs::read_symlink(dir / "to_file_moved") == "target.txt");
+    CHECK(read_file(dir / "target.txt") == "target\n");
+    remove_tree(dir);
+}
+#endif
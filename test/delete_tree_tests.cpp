@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <stop_token>
+
+#include "backend/delete_tree.h"
+#include "tree_fixture.h"
+
+#ifdef _IMC_NIX
+#include <sys/mount.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+#ifdef _IMC_NIX
+TEST_CASE("delete_tree removes the tree without following its links", "[delete_tree]")
+{
+    const auto outside = fs::temp_directory_path() / "imc_delete_outside";
+    remove_tree(outside);
+    fs::create_directories(outside);
+    generated_tree_t::write_file(outside / "stays.txt", "stays\n");
+
+    generated_tree_t tree(fs::temp_directory_path() / "imc_delete_tree", 2500, false);
+    fs::create_symlink(outside, tree.root / "links" / "outside");
+
+    copy_progress_t progress;
+    failures_t failures;
+    REQUIRE(!delete_tree(tree.root, progress, {}, failures));
+    CHECK(read_file(outside / "stays.txt") == "stays\n");
+    if (geteuid() == 0) {
+        CHECK(failures.empty());
+        CHECK(!fs::exists(tree.root));
+        CHECK(progress.files_done == progress.files_total);
+    } else {
+        //nothing can be unlinked from the 0555 directory, it and what is above it stay
+        for(const auto& [path, ec] : failures)
+            CHECK(path.string().find("readonly") != std::string::npos);
+        CHECK(!fs::exists(tree.root / "d0"));
+        CHECK(fs::exists(tree.root / "readonly" / "kept.txt"));
+    }
+    remove_tree(outside);
+}
+
+TEST_CASE("delete_tree leaves what is mounted inside the tree alone", "[delete_tree]")
+{
+    generated_tree_t tree(fs::temp_directory_path() / "imc_delete_mount", 10, false);
+    const auto mounted = tree.root / "mnt";
+    fs::create_directory(mounted);
+    if (mount("tmpfs", mounted.c_str(), "tmpfs", 0, nullptr) != 0)
+        return; //only root can mount
+    generated_tree_t::write_file(mounted / "other_fs.txt", "other\n");
+
+    copy_progress_t progress;
+    failures_t failures;
+    REQUIRE(!delete_tree(tree.root, progress, {}, failures));
+    const bool kept = fs::exists(mounted / "other_fs.txt");
+    umount2(mounted.c_str(), MNT_DETACH);
+    CHECK(kept);
+    REQUIRE(!failures.empty());
+    CHECK(failures.front().first == mounted);
+    CHECK(failures.front().second == std::errc::cross_device_link);
+    CHECK(!fs::exists(tree.root / "d0"));
+}
+
+TEST_CASE("a canceled delete_tree leaves the tree", "[delete_tree]")
+{
+    generated_tree_t tree(fs::temp_directory_path() / "imc_delete_canceled", 100, false);
+    std::stop_source stop;
+    stop.request_stop();
+
+    copy_progress_t progress;
+    failures_t failures;
+    CHECK(delete_tree(tree.root, progress, stop.get_token(), failures) == std::errc::operation_canceled);
+    CHECK(failures.empty());
+    CHECK(fs::exists(tree.root / "d0" / "f0.txt"));
+}
+
+TEST_CASE("delete_tree refuses what isn't a directory", "[delete_tree]")
+{
+    const auto file = fs::temp_directory_path() / "imc_delete_not_a_dir.txt";
+    generated_tree_t::write_file(file, "file\n");
+    copy_progress_t progress;
+    failures_t failures;
+    CHECK(delete_tree(file, progress, {}, failures) == std::errc::not_a_directory);
+    CHECK(fs::exists(file));
+    fs::remove(file);
+}
+#endif
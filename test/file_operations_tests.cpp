@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+
+#include "backend/file_operations.h"
+#include "tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+namespace {
+
+fs::path fresh_dir(const fs::path& parent, const char* name)
+{
+    const auto dir = parent / name;
+    remove_tree(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+//somewhere on another filesystem than the temp directory, empty if there is none
+fs::path other_device()
+{
+    std::error_code ec;
+    const fs::path shm = "/dev/shm";
+    if (!fs::is_directory(shm, ec))
+        return {};
+    const auto probe = fs::temp_directory_path() / "imc_device_probe";
+    const auto other = shm / "imc_device_probe";
+    generated_tree_t::write_file(probe, "probe\n");
+    //a hard link only works within one filesystem
+    fs::create_hard_link(probe, other, ec);
+    fs::remove(probe);
+    if (!ec) {
+        fs::remove(other);
+        return {};
+    }
+    return ec == std::errc::cross_device_link ? shm : fs::path();
+}
+
+}
+
+TEST_CASE("move renames within a filesystem", "[file_operations]")
+{
+    const auto dir = fresh_dir(fs::temp_directory_path(), "imc_move_rename");
+    generated_tree_t::write_file(dir / "a.txt", "a\n");
+
+    copy_progress_t progress;
+    const auto [moved, removed] = imc::backend::move(dir / "a.txt", dir / "b.txt", false, progress);
+    REQUIRE(!moved);
+    CHECK(!removed);
+    CHECK(progress.method == copy_method::Rename);
+    CHECK(progress.copied == 0);
+    CHECK(!fs::exists(dir / "a.txt"));
+    CHECK(read_file(dir / "b.txt") == "a\n");
+    remove_tree(dir);
+}
+
+TEST_CASE("move doesn't replace what is there unless it may override", "[file_operations]")
+{
+    const auto dir = fresh_dir(fs::temp_directory_path(), "imc_move_no_override");
+    generated_tree_t::write_file(dir / "a.txt", "a\n");
+    generated_tree_t::write_file(dir / "b.txt", "b\n");
+
+    CHECK(imc::backend::move(dir / "a.txt", dir / "b.txt", false).first == std::errc::file_exists);
+    CHECK(read_file(dir / "a.txt") == "a\n");
+    CHECK(read_file(dir / "b.txt") == "b\n");
+
+    const auto [moved, removed] = imc::backend::move(dir / "a.txt", dir / "b.txt", true);
+    REQUIRE(!moved);
+    CHECK(!removed);
+    CHECK(!fs::exists(dir / "a.txt"));
+    CHECK(read_file(dir / "b.txt") == "a\n");
+    remove_tree(dir);
+}
+
+TEST_CASE("moving a directory onto a non empty one merges into it", "[file_operations]")
+{
+    const auto dir = fresh_dir(fs::temp_directory_path(), "imc_move_merge");
+    fs::create_directories(dir / "src" / "sub");
+    generated_tree_t::write_file(dir / "src" / "sub" / "new.txt", "new\n");
+    fs::create_directories(dir / "dst" / "sub");
+    generated_tree_t::write_file(dir / "dst" / "sub" / "old.txt", "old\n");
+
+    CHECK(imc::backend::move(dir / "src", dir / "dst", false).first);
+    CHECK(fs::exists(dir / "src" / "sub" / "new.txt"));
+
+    const auto [moved, removed] = imc::backend::move(dir / "src", dir / "dst", true);
+    REQUIRE(!moved);
+    CHECK(!removed);
+    CHECK(!fs::exists(dir / "src"));
+    CHECK(read_file(dir / "dst" / "sub" / "new.txt") == "new\n");
+    CHECK(read_file(dir / "dst" / "sub" / "old.txt") == "old\n");
+    remove_tree(dir);
+}
+
+TEST_CASE("move copies and removes across filesystems", "[file_operations]")
+{
+    const auto other = other_device();
+    if (other.empty())
+        return; //nothing mounted elsewhere to move to
+    const auto src = fresh_dir(fs::temp_directory_path(), "imc_move_cross_src");
+    const auto dst = fresh_dir(other, "imc_move_cross_dst");
+    generated_tree_t::write_file(src / "a.txt", "a\n");
+    fs::create_directories(src / "tree" / "sub");
+    generated_tree_t::write_file(src / "tree" / "sub" / "b.txt", "b\n");
+    fs::create_symlink("a.txt", src / "link");
+
+    for(const char* name : { "a.txt", "tree", "link" }) {
+        copy_progress_t progress;
+        const auto [moved, removed] = imc::backend::move(src / name, dst / name, false, progress);
+        INFO(name);
+        REQUIRE(!moved);
+        CHECK(!removed);
+        CHECK(progress.method != copy_method::Rename);
+        CHECK(!fs::exists(fs::symlink_status(src / name)));
+    }
+    CHECK(read_file(dst / "a.txt") == "a\n");
+    CHECK(read_file(dst / "tree" / "sub" / "b.txt") == "b\n");
+    CHECK(fs::read_symlink(dst / "link") == "a.txt");
+    remove_tree(src);
+    remove_tree(dst);
+}
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stop_token>
+#include <thread>
+
+#include "backend/io_executor.h"
+
+using namespace imc::backend;
+using namespace std::chrono_literals;
+
+TEST_CASE("blocking tasks don't hold up the shared threads", "[io_executor]")
+{
+    io_executor_t executor(2);
+    std::promise<void> release;
+    const auto released = release.get_future().share();
+    std::atomic_int blocked{0};
+    //more stuck tasks than there are shared threads
+    for(int i = 0; i < 6; i++) {
+        executor.submit_blocking([released, &blocked](std::stop_token) {
+            blocked++;
+            released.wait();
+        });
+    }
+
+    std::promise<void> ran;
+    executor.submit([&ran](std::stop_token) { ran.set_value(); });
+    const auto shared_ran = ran.get_future().wait_for(10s);
+
+    std::promise<void> timed;
+    executor.submit_blocking_at(io_executor_t::clock::now() + 10ms, [&timed](std::stop_token) { timed.set_value(); });
+    const auto timed_ran = timed.get_future().wait_for(10s);
+
+    const auto give_up = std::chrono::steady_clock::now() + 10s;
+    while (blocked < 6 && std::chrono::steady_clock::now() < give_up)
+        std::this_thread::sleep_for(1ms);
+    //released before checking, the executor joins its threads
+    release.set_value();
+    CHECK(shared_ran == std::future_status::ready);
+    CHECK(timed_ran == std::future_status::ready);
+    CHECK(blocked == 6);
+}
+
+TEST_CASE("a blocking task cancelled before it is due is dropped", "[io_executor]")
+{
+    io_executor_t executor(1);
+    std::stop_source stop;
+    std::atomic_bool ran{false};
+    executor.submit_blocking_at(io_executor_t::clock::now() + 20ms, [&ran](std::stop_token) { ran = true; }, stop.get_token());
+    stop.request_stop();
+    std::promise<void> later;
+    executor.submit_blocking_at(io_executor_t::clock::now() + 50ms, [&later](std::stop_token) { later.set_value(); });
+    REQUIRE(later.get_future().wait_for(10s) == std::future_status::ready);
+    CHECK(!ran);
+}
@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <system_error>
+
+#include "backend/list_dir.h"
+#include "tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+TEST_CASE("list_dir shows links with their own permissions and their target's type", "[list_dir]")
+{
+    const auto dir = fs::temp_directory_path() / "imc_list_dir_links";
+    remove_tree(dir);
+    fs::create_directories(dir / "sub");
+    generated_tree_t::write_file(dir / "file.txt", "12345\n");
+    fs::create_symlink("file.txt", dir / "to_file");
+    fs::create_directory_symlink("sub", dir / "to_dir");
+    fs::create_symlink("nowhere", dir / "dangling");
+
+    std::map<std::string, table_row_data_t> rows;
+    REQUIRE(!list_dir(dir, [&](const table_row_data_t& row) { rows[row.name + row.ext] = row; }));
+    REQUIRE(rows.size() == 5);
+    for(const auto& [name, row] : rows)
+        CHECK(row.id == entry_id(name));
+
+    CHECK(!rows["file.txt"].is_symlink);
+    const auto& to_file = rows["to_file"];
+    CHECK(to_file.is_symlink);
+    CHECK(to_file.is_regular_file);
+    CHECK(to_file.size == 6);
+    CHECK(to_file.permissions == fs::symlink_status(dir / "to_file").permissions());
+    const auto& to_dir = rows["to_dir"];
+    CHECK(to_dir.is_symlink);
+    CHECK(to_dir.is_directory);
+    const auto& dangling = rows["dangling"];
+    CHECK(dangling.is_symlink);
+    CHECK(!dangling.is_regular_file);
+    CHECK(dangling.size == 0);
+
+    //the single entry version has no d_type to go by
+    table_row_data_t row;
+    REQUIRE(stat_entry(dir, "to_file", row));
+    CHECK(row.is_symlink);
+    CHECK(row.permissions == to_file.permissions);
+    CHECK(!stat_entry(dir, "missing", row));
+    std::error_code ec;
+    CHECK(!stat_entry(dir, "missing", row, ec));
+    CHECK(ec == std::errc::no_such_file_or_directory);
+    CHECK(!stat_entry(dir, std::string(300, 'x'), row, ec));
+    CHECK(ec == std::errc::filename_too_long);
+    remove_tree(dir);
+}
@@ -0,0 +1,92 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "backend/line_index.h"
+#include "backend/mapped_file.h"
+#include "backend/text_search.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+
+namespace {
+
+//big enough that indexing it takes a while
+fs::path make_file(const char* name, size_t lines)
+{
+    const auto path = fs::temp_directory_path() / name;
+    FILE* file = fopen(path.string().c_str(), "wb");
+    REQUIRE(file != nullptr);
+    std::string line(99, 'x');
+    line += '\n';
+    for(size_t i = 0; i < lines; i++)
+        fwrite(line.data(), 1, line.size(), file);
+    fclose(file);
+    return path;
+}
+
+template<typename FNDone>
+void wait_for(FNDone done)
+{
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!done() && std::chrono::steady_clock::now() < give_up)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+}
+
+TEST_CASE("a guarded read of an intact mapping succeeds", "[mapped_file]")
+{
+    const auto path = make_file("imc_guard_intact.txt", 1000);
+    mapped_file_t mapped;
+    REQUIRE(!mapped.open(path));
+    size_t breaks = 0;
+    CHECK(guarded_read([&]() {
+        for(char c : mapped.data())
+            breaks += c == '\n';
+    }));
+    CHECK(breaks == 1000);
+    mapped.close();
+    fs::remove(path);
+}
+
+#ifndef _IMC_WINDOWS
+TEST_CASE("truncating a file while it is indexed and searched", "[mapped_file]")
+{
+    const auto path = make_file("imc_guard_truncate.txt", 4'000'000);
+    mapped_file_t mapped;
+    REQUIRE(!mapped.open(path));
+    line_index_t lines(mapped.data());
+    match_index_t matches(mapped.data(), "needle", false);
+    fs::resize_file(path, 4096);
+
+    wait_for([&]() { return (lines.done() || lines.truncated()) && (matches.done() || matches.truncated()); });
+    //either one got to the end before the pages went or it stopped at them
+    CHECK((lines.done() || lines.truncated()));
+    CHECK((matches.done() || matches.truncated()));
+    CHECK(lines.truncated());
+
+    //the mapping still spans the old size, its pages past the new end are gone
+    const auto data = mapped.data();
+    volatile char byte = 0;
+    CHECK(!guarded_read([&]() { byte = data[data.size() / 2]; }));
+    CHECK(guarded_read([&]() { byte = data[0]; }));
+
+    //mapped again the file is indexed to its new end
+    lines.stop();
+    matches.stop();
+    mapped.close();
+    REQUIRE(!mapped.open(path));
+    line_index_t again(mapped.data());
+    wait_for([&]() { return again.done(); });
+    CHECK(again.done());
+    CHECK(!again.truncated());
+    CHECK(again.lines() == 41);
+    mapped.close();
+    fs::remove(path);
+}
+#endif
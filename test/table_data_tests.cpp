@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "backend/table_data.h"
+
+using namespace imc::backend;
+
+namespace {
+
+table_row_data_t make_row(const std::string& name)
+{
+    table_row_data_t row;
+    row.id = entry_id(name);
+    row.name = name;
+    row.is_regular_file = true;
+    return row;
+}
+
+}
+
+TEST_CASE("find looks rows up by id through adds, renames, removes and compaction", "[table_data]")
+{
+    dir_snapshot_t rows;
+    //name -> row it should be found at
+    std::unordered_map<std::string, size_t> expected;
+    std::mt19937 random(42);
+
+    auto check_all = [&]() {
+        for(const auto& [name, row] : expected)
+            REQUIRE(rows.find(entry_id(name)) == row);
+    };
+
+    for(size_t step = 0; step < 20'000; step++) {
+        const auto name = "file_" + std::to_string(random() % 3000);
+        const auto row = rows.find(entry_id(name));
+        switch (random() % 4) {
+        case 0:
+        case 1:
+            if (row == dir_snapshot_t::npos)
+                expected[name] = rows.push_back(make_row(name));
+            break;
+        case 2:
+            if (row != dir_snapshot_t::npos) {
+                rows.remove(row);
+                expected.erase(name);
+            }
+            break;
+        case 3:
+            //renamed in place, the row keeps its index under the new id
+            if (row != dir_snapshot_t::npos) {
+                const auto renamed = "renamed_" + std::to_string(step);
+                rows.update(row, make_row(renamed));
+                expected.erase(name);
+                expected[renamed] = row;
+            }
+            break;
+        }
+        if (rows.removed * 2 > rows.size()) {
+            const auto remap = rows.compact();
+            for(auto& [name_, index] : expected)
+                index = remap[index];
+            check_all();
+        }
+    }
+    check_all();
+    CHECK(rows.live_size() == expected.size());
+    CHECK(rows.find(entry_id("never_added")) == dir_snapshot_t::npos);
+}
+
+TEST_CASE("a row added back under a removed id is the one found", "[table_data]")
+{
+    dir_snapshot_t rows;
+    const auto first = rows.push_back(make_row("a.txt"));
+    rows.remove(first);
+    CHECK(rows.find(entry_id("a.txt")) == dir_snapshot_t::npos);
+    const auto second = rows.push_back(make_row("a.txt"));
+    CHECK(rows.find(entry_id("a.txt")) == second);
+    //removing the dead slot again must not drop the live one
+    rows.remove(first);
+    CHECK(rows.find(entry_id("a.txt")) == second);
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "backend/table_sort.h"
+
+using namespace imc::backend;
+
+namespace {
+
+//names that differ only in case, shared extensions, directories, equal sizes and times
+dir_snapshot_t random_snapshot(size_t rows, std::mt19937& random)
+{
+    static const char* exts[] = { "", ".txt", ".TXT", ".cpp", ".h", ".tar.gz" };
+    const auto now = std::chrono::file_clock::now();
+    dir_snapshot_t data;
+    data.directory = "/tmp/somewhere";
+    table_row_data_t up;
+    up.name = "..";
+    up.is_imaginary = true;
+    up.is_directory = true;
+    up.id = entry_id("..");
+    data.push_back(up);
+    for(size_t i = 0; i < rows; i++) {
+        table_row_data_t row;
+        row.name = (random() % 2 ? "File_" : "file_") + std::to_string(random() % (rows / 2 + 1));
+        row.ext = random() % 5 == 0 ? "" : exts[random() % std::size(exts)];
+        row.id = entry_id(row.name + row.ext + std::to_string(i));
+        row.is_directory = random() % 8 == 0;
+        row.is_regular_file = !row.is_directory;
+        row.size = random() % 100;
+        row.modified = now - std::chrono::seconds(random() % 1000);
+        row.permissions = static_cast<file_perm>(random() % 0777);
+        data.push_back(row);
+    }
+    return data;
+}
+
+std::vector<uint32_t> expected_order(const dir_snapshot_t& data, const table_sort_specs_t& specs)
+{
+    std::vector<uint32_t> order;
+    for(size_t i = 0; i < data.size(); i++) {
+        if (!data.is_removed(i))
+            order.push_back(static_cast<uint32_t>(i));
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) { return row_less(data, specs, lhs, rhs); });
+    return order;
+}
+
+std::vector<table_sort_specs_t> all_specs()
+{
+    using namespace sortable_columns;
+    std::vector<table_sort_specs_t> specs;
+    for(const int column : { Name, Ext, Size, Modified, Permissions }) {
+        for(const bool ascending : { true, false }) {
+            for(const bool dirs_first : { true, false })
+                specs.push_back({ { { column, ascending } }, dirs_first });
+        }
+    }
+    specs.push_back({ { { Ext, true }, { Size, false } }, true });
+    specs.push_back({ { { Modified, false }, { Name, true } }, false });
+    return specs;
+}
+
+}
+
+TEST_CASE("table_sorter_t orders rows like row_less for every column", "[table_sort]")
+{
+    std::mt19937 random(7);
+    auto data = random_snapshot(5000, random);
+    for(size_t i = 1; i < data.size(); i += 13)
+        data.remove(i);
+
+    table_sorter_t sorter;
+    for(const auto& specs : all_specs())
+        CHECK(sorter.sorted(data, specs) == expected_order(data, specs));
+}
+
+TEST_CASE("table_sorter_t ranks names on several threads for big listings", "[table_sort]")
+{
+    std::mt19937 random(11);
+    const auto data = random_snapshot(70'000, random);
+    table_sorter_t sorter;
+    const table_sort_specs_t specs{ { { sortable_columns::Name, false } }, true };
+    CHECK(sorter.sorted(data, specs) == expected_order(data, specs));
+}
+
+TEST_CASE("table_sorter_t keeps orderings until it is invalidated", "[table_sort]")
+{
+    std::mt19937 random(3);
+    auto data = random_snapshot(500, random);
+    const table_sort_specs_t by_size{ { { sortable_columns::Size, true } }, false };
+
+    table_sorter_t sorter;
+    const auto first = sorter.sorted(data, by_size);
+    sorter.sorted(data, { { { sortable_columns::Name, true } }, true });
+
+    //a cached ordering comes back as it was, changed rows or not
+    data.sizes[5] = 1'000'000;
+    data.remove(7);
+    CHECK(sorter.sorted(data, by_size) == first);
+
+    sorter.invalidate();
+    const auto& order = sorter.sorted(data, by_size);
+    CHECK(order == expected_order(data, by_size));
+    CHECK(order.back() == 5);
+    CHECK(std::find(order.begin(), order.end(), 7U) == order.end());
+}
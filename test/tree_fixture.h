@@ -0,0 +1,140 @@
+#pragma once
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _IMC_NIX
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A generated directory tree for the copy/move/delete tests and benchmarks:
+// files spread over directories of files_per_dir, plus one of every kind
+// of entry a tree walker has to treat specially.
+namespace imc::test {
+    namespace fs = std::filesystem;
+
+    constexpr size_t files_per_dir = 1000;
+
+    // Directories stay writable when removed, their modes are restored
+    // first so a tree with a read only directory in it can go too.
+    inline void remove_tree(const fs::path& root)
+    {
+        std::error_code ec;
+        if (!fs::exists(fs::symlink_status(root, ec)))
+            return;
+        for(auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec) && !it->is_symlink(ec))
+                fs::permissions(it->path(), fs::perms::owner_all, fs::perm_options::add, ec);
+        }
+        fs::remove_all(root, ec);
+    }
+
+    struct generated_tree_t
+    {
+        fs::path    root;
+        size_t      files;
+        // root/loop is root bind mounted again, only when asked for and it
+        // could be mounted (root user)
+        bool        has_loop{false};
+
+        generated_tree_t(fs::path root_, size_t files_, bool with_loop = true)
+        : root(std::move(root_)), files(files_)
+        {
+#ifdef _IMC_NIX
+            //left over from a run that didn't get to clean up
+            umount2((root / "loop").c_str(), MNT_DETACH);
+#endif
+            remove_tree(root);
+            fs::create_directories(root);
+            for(size_t i = 0; i < files; i++) {
+                const auto dir = root / ("d" + std::to_string(i / files_per_dir));
+                if (i % files_per_dir == 0)
+                    fs::create_directory(dir);
+                write_file(dir / ("f" + std::to_string(i) + ".txt"), "file " + std::to_string(i) + "\n");
+            }
+
+            fs::create_directory(root / "links");
+            fs::create_symlink("../d0/f0.txt", root / "links" / "to_file");
+            fs::create_symlink("../d0", root / "links" / "to_dir");
+            fs::create_symlink("nowhere", root / "links" / "dangling");
+
+            fs::create_directories(root / "readonly" / "inner");
+            write_file(root / "readonly" / "kept.txt", "kept\n");
+            fs::permissions(root / "readonly", static_cast<fs::perms>(0555));
+#ifdef _IMC_NIX
+            REQUIRE(mkfifo((root / "pipe").c_str(), 0644) == 0);
+            if (with_loop) {
+                fs::create_directory(root / "loop");
+                has_loop = mount(root.c_str(), (root / "loop").c_str(), nullptr, MS_BIND, nullptr) == 0;
+            }
+#endif
+        }
+
+        ~generated_tree_t()
+        {
+#ifdef _IMC_NIX
+            if (has_loop)
+                umount2((root / "loop").c_str(), MNT_DETACH);
+#endif
+            remove_tree(root);
+        }
+
+        static void write_file(const fs::path& path, const std::string& content)
+        {
+            FILE* file = fopen(path.string().c_str(), "wb");
+            REQUIRE(file != nullptr);
+            fwrite(content.data(), 1, content.size(), file);
+            fclose(file);
+        }
+    };
+
+    inline std::string read_file(const fs::path& path)
+    {
+        std::string content;
+        if (FILE* file = fopen(path.string().c_str(), "rb")) {
+            char buffer[4096];
+            for(size_t len; (len = fread(buffer, 1, sizeof(buffer), file)) > 0;)
+                content.append(buffer, len);
+            fclose(file);
+        }
+        return content;
+    }
+
+    // Every entry under src has its twin under dst: same kind, same mode,
+    // same content or link target. Entries named skip aren't descended
+    // into (the bind loop). Returns how many entries were compared.
+    inline size_t compare_trees(const fs::path& src, const fs::path& dst, const std::string& skip = "loop")
+    {
+        size_t compared = 0;
+        for(const auto& entry : fs::directory_iterator(src)) {
+            const auto name = entry.path().filename();
+            if (name == skip)
+                continue;
+            const auto twin = dst / name;
+            const auto from = fs::symlink_status(entry.path());
+            const auto to = fs::symlink_status(twin);
+            INFO(entry.path().string());
+            REQUIRE(to.type() == from.type());
+            compared++;
+            if (fs::is_symlink(from)) {
+                CHECK(fs::read_symlink(twin) == fs::read_symlink(entry.path()));
+                continue;
+            }
+            if (fs::is_fifo(from))
+                continue;
+            CHECK(to.permissions() == from.permissions());
+            if (fs::is_regular_file(from))
+                CHECK(read_file(twin) == read_file(entry.path()));
+            else if (fs::is_directory(from))
+                compared += compare_trees(entry.path(), twin, skip);
+        }
+        return compared;
+    }
+}
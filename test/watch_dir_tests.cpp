@@ -0,0 +1,191 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "backend/watch_dir.h"
+#include "tree_fixture.h"
+
+namespace fs = std::filesystem;
+using namespace imc::backend;
+using namespace imc::test;
+
+namespace {
+
+fs::path make_dir(const char* name)
+{
+    const auto dir = fs::temp_directory_path() / name;
+    remove_tree(dir);
+    fs::create_directories(dir);
+    generated_tree_t::write_file(dir / "kept.txt", "kept\n");
+    generated_tree_t::write_file(dir / "grows.txt", "1\n");
+    generated_tree_t::write_file(dir / "goes.txt", "goes\n");
+    return dir;
+}
+
+bool has_row(const TableRowDataVector& rows, const std::string& file_name)
+{
+    return std::any_of(rows.begin(), rows.end(), [&](const table_row_data_t& row) {
+        return row.id == entry_id(file_name) && row.name + row.ext == file_name;
+    });
+}
+
+template<typename FNDone>
+void wait_for(FNDone done)
+{
+    const auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (!done() && std::chrono::steady_clock::now() < give_up)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+}
+
+TEST_CASE("watch_dir sends the listing once, then only what changed", "[watch_dir]")
+{
+    const auto dir = make_dir("imc_watch_dir_delta");
+    dir_state_t state;
+    DirSnapshotPtr listing;
+    std::vector<table_delta_t> deltas;
+    auto on_update = [&](DirSnapshotPtr data) { listing = std::move(data); };
+    auto on_delta = [&](table_delta_t delta) { deltas.push_back(std::move(delta)); };
+    auto on_error = [](const error_message_t& message) { FAIL(message.last_error); };
+
+    REQUIRE(watch_dir(dir, state, on_update, on_delta, on_error) == 0);
+    REQUIRE(listing);
+    //the three files and ".."
+    CHECK(listing->live_size() == 4);
+    CHECK(listing->find(entry_id("..")) != dir_snapshot_t::npos);
+    CHECK(listing->find(entry_id("kept.txt")) != dir_snapshot_t::npos);
+
+    //nothing changed, nothing is sent
+    REQUIRE(watch_dir(dir, state, on_update, on_delta, on_error) == 0);
+    CHECK(deltas.empty());
+
+    generated_tree_t::write_file(dir / "grows.txt", "1234\n");
+    generated_tree_t::write_file(dir / "new.txt", "new\n");
+    fs::remove(dir / "goes.txt");
+    REQUIRE(watch_dir(dir, state, on_update, on_delta, on_error) == 0);
+    REQUIRE(deltas.size() == 1);
+    const auto& delta = deltas.front();
+    CHECK(delta.added.size() == 1);
+    CHECK(has_row(delta.added, "new.txt"));
+    CHECK(delta.modified.size() == 1);
+    CHECK(has_row(delta.modified, "grows.txt"));
+    CHECK(delta.removed == std::vector<size_t>{ entry_id("goes.txt") });
+    remove_tree(dir);
+}
+
+TEST_CASE("watch_dir_entries only looks at the names it is given", "[watch_dir]")
+{
+    const auto dir = make_dir("imc_watch_dir_entries");
+    dir_state_t state;
+    auto on_error = [](const error_message_t& message) { FAIL(message.last_error); };
+    REQUIRE(watch_dir(dir, state, [](DirSnapshotPtr) {}, [](table_delta_t) {}, on_error) == 0);
+
+    generated_tree_t::write_file(dir / "grows.txt", "1234\n");
+    generated_tree_t::write_file(dir / "new.txt", "new\n");
+    fs::remove(dir / "goes.txt");
+    std::vector<table_delta_t> deltas;
+    REQUIRE(watch_dir_entries(dir, { "new.txt", "goes.txt" }, state, [&](table_delta_t delta) { deltas.push_back(std::move(delta)); }, on_error) == 0);
+    REQUIRE(deltas.size() == 1);
+    CHECK(has_row(deltas.front().added, "new.txt"));
+    CHECK(deltas.front().modified.empty());
+    CHECK(deltas.front().removed == std::vector<size_t>{ entry_id("goes.txt") });
+
+    //grows.txt wasn't looked at, a full pass still finds it
+    deltas.clear();
+    REQUIRE(watch_dir(dir, state, [](DirSnapshotPtr) {}, [&](table_delta_t delta) { deltas.push_back(std::move(delta)); }, on_error) == 0);
+    REQUIRE(deltas.size() == 1);
+    CHECK(deltas.front().added.empty());
+    CHECK(has_row(deltas.front().modified, "grows.txt"));
+    CHECK(deltas.front().removed.empty());
+    remove_tree(dir);
+}
+
+TEST_CASE("watch_dir_entries only removes what is gone", "[watch_dir]")
+{
+    const auto dir = make_dir("imc_watch_dir_entries_errors");
+    dir_state_t state;
+    REQUIRE(watch_dir(dir, state, [](DirSnapshotPtr) {}, [](table_delta_t) {}, [](const error_message_t&) {}) == 0);
+
+    //a name that can't be looked at (too long for lstat) isn't gone, the error says why
+    const std::string unreadable(300, 'x');
+    state.entries.emplace(entry_id(unreadable), dir_state_t::stamp_t{});
+    //a file used as a directory is
+    const std::string below_file = "kept.txt/inner";
+    state.entries.emplace(entry_id(below_file), dir_state_t::stamp_t{});
+    fs::remove(dir / "goes.txt");
+
+    std::vector<table_delta_t> deltas;
+    int errors = 0;
+    CHECK(watch_dir_entries(dir, { unreadable, below_file, "goes.txt" }, state, [&](table_delta_t delta) { deltas.push_back(std::move(delta)); }, [&](const error_message_t&) { ++errors; }) == 1);
+    CHECK(errors == 1);
+    REQUIRE(deltas.size() == 1);
+    auto removed = deltas.front().removed;
+    std::sort(removed.begin(), removed.end());
+    std::vector<size_t> expected{ entry_id(below_file), entry_id("goes.txt") };
+    std::sort(expected.begin(), expected.end());
+    CHECK(removed == expected);
+    CHECK(state.entries.contains(entry_id(unreadable)));
+    remove_tree(dir);
+}
+
+TEST_CASE("dir_watcher_t sends the listing, then a delta when the directory changes", "[watch_dir]")
+{
+    const auto dir = make_dir("imc_dir_watcher");
+    std::mutex mutex;
+    DirSnapshotPtr listing;
+    TableRowDataVector added;
+    std::atomic_bool errored{false};
+
+    dir_watcher_t watcher;
+    watcher.start(dir, {}, [&](DirSnapshotPtr data) {
+        std::lock_guard lock(mutex);
+        listing = std::move(data);
+    }, [&](table_delta_t delta) {
+        std::lock_guard lock(mutex);
+        added.insert(added.end(), delta.added.begin(), delta.added.end());
+    }, [&](const error_message_t&) {
+        errored = true;
+    });
+
+    wait_for([&]() { std::lock_guard lock(mutex); return listing != nullptr; });
+    {
+        std::lock_guard lock(mutex);
+        REQUIRE(listing);
+        CHECK(listing->live_size() == 4);
+    }
+    generated_tree_t::write_file(dir / "new.txt", "new\n");
+    wait_for([&]() { std::lock_guard lock(mutex); return has_row(added, "new.txt"); });
+    watcher.stop();
+    std::lock_guard lock(mutex);
+    CHECK(has_row(added, "new.txt"));
+    CHECK(!errored);
+    remove_tree(dir);
+}
+
+TEST_CASE("a stopped watch_dir pass sends nothing", "[watch_dir]")
+{
+    const auto dir = make_dir("imc_watch_dir_stopped");
+    std::stop_source stop;
+    stop.request_stop();
+    dir_state_t state;
+    bool sent = false;
+    auto on_error = [](const error_message_t& message) { FAIL(message.last_error); };
+    CHECK(watch_dir(dir, state, [&](DirSnapshotPtr) { sent = true; }, [&](table_delta_t) { sent = true; }, on_error, stop.get_token()) == 1);
+    CHECK(!state.loaded);
+
+    REQUIRE(watch_dir(dir, state, [](DirSnapshotPtr) {}, [](table_delta_t) {}, on_error) == 0);
+    generated_tree_t::write_file(dir / "new.txt", "new\n");
+    CHECK(watch_dir(dir, state, [](DirSnapshotPtr) {}, [&](table_delta_t) { sent = true; }, on_error, stop.get_token()) == 1);
+    CHECK(watch_dir_entries(dir, { "new.txt" }, state, [&](table_delta_t) { sent = true; }, on_error, stop.get_token()) == 1);
+    CHECK(!sent);
+    remove_tree(dir);
+}